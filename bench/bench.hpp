@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <vector>
+
+// goliath-bench runs one section at a time, every section prints its own table and shares the helpers below
+namespace bench {
+    using clock = std::chrono::steady_clock;
+
+    inline double elapsed_us(clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(clock::now() - start).count();
+    }
+
+    inline double elapsed_ms(clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    }
+
+    // cpu time of the whole process, summed over all of its threads
+    inline double cpu_seconds() {
+        return (double)std::clock() / CLOCKS_PER_SEC;
+    }
+
+    // sections that need a device share one engine, it's created on first use and destroyed once all sections ran
+    void init_engine();
+
+    // sorts `samples` in place
+    inline void print_latency(const char* label, std::vector<double>& samples) {
+        if (samples.empty()) return;
+
+        std::sort(samples.begin(), samples.end());
+        auto at = [&](double fraction) { return samples[(size_t)(fraction * (double)(samples.size() - 1))]; };
+        printf("  %-28s min %9.2fus  median %9.2fus  p99 %9.2fus  max %9.2fus\n", label, samples.front(), at(0.5),
+               at(0.99), samples.back());
+    }
+
+    namespace transport {
+        void run();
+        void run_tickets();
+    }
+
+    namespace models {
+        void run();
+    }
+
+    namespace scheduler {
+        void run();
+    }
+
+    namespace registry {
+        void run();
+    }
+
+    namespace gltf_import {
+        void run();
+    }
+}
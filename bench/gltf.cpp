@@ -0,0 +1,262 @@
+#include "bench.hpp"
+
+#include "gltf.hpp"
+#include "state.hpp"
+#include "textures.hpp"
+
+#include "goliath/dependency_graph.hpp"
+#include "goliath/materials.hpp"
+#include "goliath/scheduler.hpp"
+
+#include "tinygltf/stb_image_write.h"
+#include "tinygltf/tiny_gltf.h"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <span>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+// imports synthetic .gltf files built in memory, every primitive has its own grid and every material its own RGBA
+// albedo and RGB metallic roughness image, so nothing gets deduplicated and every image goes through the widening
+// and the encoder. the textures are dropped after encoding, the material instances stay in a throwaway registry
+namespace bench::gltf_import {
+    static constexpr uint32_t model_count = 16;
+    static constexpr uint32_t primitives_per_model = 8;
+    // vertices per side of each primitive's grid
+    static constexpr uint32_t grid_side = 64;
+    static constexpr uint32_t image_side = 256;
+
+    std::string base64(std::span<const uint8_t> data) {
+        static constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        std::string out{};
+        out.reserve((data.size() + 2) / 3 * 4);
+        for (std::size_t i = 0; i < data.size(); i += 3) {
+            uint32_t chunk = (uint32_t)data[i] << 16;
+            if (i + 1 < data.size()) chunk |= (uint32_t)data[i + 1] << 8;
+            if (i + 2 < data.size()) chunk |= data[i + 2];
+
+            out += alphabet[(chunk >> 18) & 63];
+            out += alphabet[(chunk >> 12) & 63];
+            out += i + 1 < data.size() ? alphabet[(chunk >> 6) & 63] : '=';
+            out += i + 2 < data.size() ? alphabet[chunk & 63] : '=';
+        }
+
+        return out;
+    }
+
+    std::string png_uri(uint32_t channels, uint32_t seed) {
+        std::vector<uint8_t> texels(image_side * image_side * channels);
+        for (uint32_t y = 0; y < image_side; y++) {
+            for (uint32_t x = 0; x < image_side; x++) {
+                for (uint32_t c = 0; c < channels; c++) {
+                    texels[(y * image_side + x) * channels + c] = (uint8_t)(x * (c + 1) + y * 3 + seed * 29);
+                }
+            }
+        }
+
+        std::vector<uint8_t> png{};
+        stbi_write_png_to_func(
+            [](void* context, void* data, int size) {
+                auto& out = *(std::vector<uint8_t>*)context;
+                out.insert(out.end(), (uint8_t*)data, (uint8_t*)data + size);
+            },
+            &png, (int)image_side, (int)image_side, (int)channels, texels.data(), (int)(image_side * channels));
+
+        return "data:image/png;base64," + base64(png);
+    }
+
+    template <typename T> void append(std::vector<uint8_t>& buffer, const std::vector<T>& values) {
+        auto offset = buffer.size();
+        buffer.resize(offset + values.size() * sizeof(T));
+        std::memcpy(buffer.data() + offset, values.data(), values.size() * sizeof(T));
+    }
+
+    std::string make_gltf(uint32_t seed) {
+        std::vector<uint8_t> buffer{};
+        auto views = nlohmann::json::array();
+        auto accessors = nlohmann::json::array();
+        auto meshes = nlohmann::json::array();
+        auto materials = nlohmann::json::array();
+        auto textures = nlohmann::json::array();
+        auto images = nlohmann::json::array();
+        auto nodes = nlohmann::json::array();
+
+        auto add_accessor = [&]<typename T>(const std::vector<T>& values, uint32_t components, int component_type,
+                                            const char* type, nlohmann::json extra) {
+            views.emplace_back(nlohmann::json{
+                {"buffer", 0},
+                {"byteOffset", buffer.size()},
+                {"byteLength", values.size() * sizeof(T)},
+            });
+            append(buffer, values);
+
+            auto accessor = nlohmann::json{
+                {"bufferView", views.size() - 1},
+                {"componentType", component_type},
+                {"count", values.size() / components},
+                {"type", type},
+            };
+            accessor.update(extra);
+            accessors.emplace_back(accessor);
+            return accessors.size() - 1;
+        };
+
+        for (uint32_t p = 0; p < primitives_per_model; p++) {
+            auto prim_seed = seed * primitives_per_model + p;
+
+            std::vector<float> positions{};
+            std::vector<float> normals{};
+            std::vector<float> texcoords{};
+            std::vector<uint32_t> indices{};
+            float max_height = 0.0f;
+            for (uint32_t z = 0; z < grid_side; z++) {
+                for (uint32_t x = 0; x < grid_side; x++) {
+                    auto height = (float)((x * 7 + z * 13 + prim_seed) % 17) / 17.0f;
+                    max_height = std::max(max_height, height);
+
+                    positions.insert(positions.end(), {(float)x, height, (float)z});
+                    normals.insert(normals.end(), {0.0f, 1.0f, 0.0f});
+                    texcoords.insert(texcoords.end(),
+                                     {(float)x / (float)(grid_side - 1), (float)z / (float)(grid_side - 1)});
+                }
+            }
+            for (uint32_t z = 0; z + 1 < grid_side; z++) {
+                for (uint32_t x = 0; x + 1 < grid_side; x++) {
+                    auto i = z * grid_side + x;
+                    indices.insert(indices.end(), {i, i + grid_side, i + 1, i + 1, i + grid_side, i + grid_side + 1});
+                }
+            }
+
+            auto bounds = nlohmann::json{
+                {"min", {0.0f, 0.0f, 0.0f}},
+                {"max", {(float)(grid_side - 1), max_height, (float)(grid_side - 1)}},
+            };
+            auto no_extra = nlohmann::json::object();
+            auto position = add_accessor(positions, 3, TINYGLTF_COMPONENT_TYPE_FLOAT, "VEC3", bounds);
+            auto normal = add_accessor(normals, 3, TINYGLTF_COMPONENT_TYPE_FLOAT, "VEC3", no_extra);
+            auto texcoord = add_accessor(texcoords, 2, TINYGLTF_COMPONENT_TYPE_FLOAT, "VEC2", no_extra);
+            auto index = add_accessor(indices, 1, TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT, "SCALAR", no_extra);
+
+            images.emplace_back(nlohmann::json{{"uri", png_uri(4, prim_seed)}});
+            textures.emplace_back(nlohmann::json{{"source", images.size() - 1}});
+            images.emplace_back(nlohmann::json{{"uri", png_uri(3, prim_seed)}});
+            textures.emplace_back(nlohmann::json{{"source", images.size() - 1}});
+
+            materials.emplace_back(nlohmann::json{
+                {"pbrMetallicRoughness",
+                 {
+                     {"baseColorTexture", {{"index", textures.size() - 2}}},
+                     {"metallicRoughnessTexture", {{"index", textures.size() - 1}}},
+                 }},
+            });
+
+            meshes.emplace_back(nlohmann::json{
+                {"name", std::format("grid {}", p)},
+                {"primitives",
+                 {{
+                     {"attributes", {{"POSITION", position}, {"NORMAL", normal}, {"TEXCOORD_0", texcoord}}},
+                     {"indices", index},
+                     {"material", materials.size() - 1},
+                 }}},
+            });
+            nodes.emplace_back(nlohmann::json{
+                {"mesh", meshes.size() - 1},
+                {"translation", {(float)(p * grid_side), 0.0f, 0.0f}},
+            });
+        }
+
+        auto scene_nodes = nlohmann::json::array();
+        for (uint32_t i = 0; i < nodes.size(); i++) {
+            scene_nodes.emplace_back(i);
+        }
+
+        return nlohmann::json{
+            {"asset", {{"version", "2.0"}}},
+            {"scene", 0},
+            {"scenes", {{{"nodes", scene_nodes}}}},
+            {"nodes", nodes},
+            {"meshes", meshes},
+            {"materials", materials},
+            {"textures", textures},
+            {"images", images},
+            {"accessors", accessors},
+            {"bufferViews", views},
+            {"buffers",
+             {{
+                 {"byteLength", buffer.size()},
+                 {"uri", "data:application/octet-stream;base64," + base64(buffer)},
+             }}},
+        }
+            .dump();
+    }
+
+    std::atomic<uint32_t> encoded_textures = 0;
+
+    engine::Textures::gid drop_texture(EncodedTexture&, std::string, engine::Sampler) {
+        encoded_textures++;
+        return {0, 0};
+    }
+
+    // `ix` only names the model in the dependency graph, the importer never touches the models registry
+    bool import(std::string& gltf, uint32_t ix) {
+        engine::Model model{};
+        auto err = gltf::load_json(&model, {(uint8_t*)gltf.data(), gltf.size()}, "", engine::models::gid{0, ix});
+        model.destroy();
+        return err == gltf::Ok;
+    }
+
+    void print_row(const char* label, double ms, double baseline) {
+        printf("  %-14s %9.2fms  %6.2f models/s  %8.1f primitives/s  x%.2f\n", label, ms,
+               model_count / (ms / 1000.0), model_count * primitives_per_model / (ms / 1000.0), baseline / ms);
+    }
+
+    void run() {
+        auto dir = std::filesystem::temp_directory_path() / "goliath-bench-gltf";
+        std::filesystem::create_directories(dir);
+
+        auto dep_graph = engine::DependencyGraph::init(dir);
+        auto materials = engine::Materials::init(engine::Materials::default_json());
+        if (!dep_graph || !materials) {
+            printf("  Couldn't create the dependency graph or the default materials\n");
+            return;
+        }
+        state::dependency_graph = *dep_graph;
+        state::materials = *materials;
+        texture_sink = drop_texture;
+
+        std::vector<std::string> sources{};
+        for (uint32_t i = 0; i < model_count; i++) {
+            sources.emplace_back(make_gltf(i));
+        }
+
+        std::atomic<uint32_t> failed = 0;
+
+        // every model is still split into primitive and image jobs, only the models themselves go one by one
+        auto start = clock::now();
+        for (uint32_t i = 0; i < model_count; i++) {
+            failed += !import(sources[i], i);
+        }
+        auto one_by_one = elapsed_ms(start);
+
+        // how goliath-cook runs them
+        start = clock::now();
+        engine::scheduler::parallel_for(model_count, 1, [&](uint32_t begin, uint32_t end) {
+            for (auto i = begin; i < end; i++) {
+                failed += !import(sources[i], i);
+            }
+        });
+        auto all_at_once = elapsed_ms(start);
+
+        print_row("one by one", one_by_one, one_by_one);
+        print_row("all at once", all_at_once, one_by_one);
+        printf("  %u textures encoded, %u imports failed\n", encoded_textures.load(), failed.load());
+
+        delete *materials;
+        std::filesystem::remove_all(dir);
+    }
+}
@@ -0,0 +1,61 @@
+#include "bench.hpp"
+
+#include "goliath/engine.hpp"
+
+#include <cstring>
+
+static bool engine_initialized = false;
+
+void bench::init_engine() {
+    if (engine_initialized) return;
+
+    engine::init(engine::Init{
+        .window_name = "goliath-bench",
+        .fullscreen = false,
+    });
+    engine_initialized = true;
+}
+
+struct Section {
+    const char* name;
+    const char* description;
+    void (*run)();
+};
+
+static constexpr Section sections[] = {
+    {"transport", "transport2 upload latency and idle cpu use in the spin and park idle modes", bench::transport::run},
+    {"tickets", "creates, completes and recycles 100k transport2 tickets", bench::transport::run_tickets},
+    {"models", "batched .gom loading throughput per thread count", bench::models::run},
+    {"scheduler", "engine::scheduler against the ThreadPool it replaced", bench::scheduler::run},
+    {"registry", "adds and removes 100k materials, models and textures", bench::registry::run},
+    {"gltf", "imports synthetic glTF models one by one and all at once", bench::gltf_import::run},
+};
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: goliath-bench <section>...\n"
+               "sections:\n");
+        for (const auto& section : sections) {
+            printf("  %-12s %s\n", section.name, section.description);
+        }
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        const Section* found = nullptr;
+        for (const auto& section : sections) {
+            if (std::strcmp(section.name, argv[i]) == 0) found = &section;
+        }
+
+        if (!found) {
+            printf("Unknown section `%s`\n", argv[i]);
+            return 1;
+        }
+
+        printf("%s:\n", found->name);
+        found->run();
+    }
+
+    if (engine_initialized) engine::destroy();
+    return 0;
+}
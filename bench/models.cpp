@@ -0,0 +1,180 @@
+#include "bench.hpp"
+
+#include "goliath/model.hpp"
+#include "goliath/scheduler.hpp"
+#include "goliath/util.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <format>
+#include <thread>
+
+// loads a directory of synthetic .gom files the way `models::acquire` splits them, one batch per thread, and
+// reports the throughput for a growing number of threads. the files are read once up front so every run hits the
+// page cache and only the loader itself is measured
+namespace bench::models {
+    static constexpr uint32_t model_count = 512;
+    // vertices per side of each model's grid mesh
+    static constexpr uint32_t grid_side = 96;
+    // same floor as `min_load_batch` in models.cpp
+    static constexpr uint32_t min_batch = 4;
+
+    engine::Model make_grid(uint32_t seed) {
+        auto* meshes = (engine::Mesh*)malloc(sizeof(engine::Mesh));
+        auto& mesh = meshes[0];
+        mesh = engine::Mesh{};
+
+        mesh.vertex_topology = engine::Topology::TriangleList;
+        mesh.vertex_count = grid_side * grid_side;
+        mesh.index_count = (grid_side - 1) * (grid_side - 1) * 6;
+
+        mesh.positions = (glm::vec3*)malloc(mesh.vertex_count * sizeof(glm::vec3));
+        mesh.normals = (glm::vec3*)malloc(mesh.vertex_count * sizeof(glm::vec3));
+        mesh.tangents = (glm::vec4*)malloc(mesh.vertex_count * sizeof(glm::vec4));
+        mesh.texcoords[0] = (glm::vec2*)malloc(mesh.vertex_count * sizeof(glm::vec2));
+        mesh.indices = (uint32_t*)malloc(mesh.index_count * sizeof(uint32_t));
+
+        // a different height field per model, identical files would compress the benchmark down to one mapping
+        for (uint32_t z = 0; z < grid_side; z++) {
+            for (uint32_t x = 0; x < grid_side; x++) {
+                auto i = z * grid_side + x;
+                auto height = (float)((x * 7 + z * 13 + seed) % 17) / 17.0f;
+
+                mesh.positions[i] = glm::vec3{(float)x, height, (float)z};
+                mesh.normals[i] = glm::vec3{0.0f, 1.0f, 0.0f};
+                mesh.tangents[i] = glm::vec4{1.0f, 0.0f, 0.0f, 1.0f};
+                mesh.texcoords[0][i] = glm::vec2{(float)x, (float)z} / (float)(grid_side - 1);
+            }
+        }
+
+        uint32_t* index = mesh.indices;
+        for (uint32_t z = 0; z + 1 < grid_side; z++) {
+            for (uint32_t x = 0; x + 1 < grid_side; x++) {
+                auto i = z * grid_side + x;
+                for (auto corner : {i, i + grid_side, i + 1, i + 1, i + grid_side, i + grid_side + 1}) {
+                    *index++ = corner;
+                }
+            }
+        }
+
+        mesh.bounding_box = engine::collisions::AABB{
+            .min = glm::vec3{0.0f},
+            .max = glm::vec3{(float)(grid_side - 1), 1.0f, (float)(grid_side - 1)},
+        };
+
+        engine::Model model{};
+        model.bounding_box = mesh.bounding_box;
+        model.mesh_count = 1;
+        model.meshes = meshes;
+        model.mesh_indices_count = 1;
+        model.mesh_indexes = (uint32_t*)malloc(sizeof(uint32_t));
+        model.mesh_indexes[0] = 0;
+        model.mesh_transforms = (glm::mat4*)malloc(sizeof(glm::mat4));
+        model.mesh_transforms[0] = glm::mat4{1.0f};
+
+        return model;
+    }
+
+    std::vector<std::filesystem::path> write_models(const std::filesystem::path& dir) {
+        std::filesystem::create_directories(dir);
+
+        std::vector<std::filesystem::path> paths{};
+        for (uint32_t i = 0; i < model_count; i++) {
+            auto model = make_grid(i);
+            auto size = model.get_save_size();
+            std::vector<uint8_t> data(size);
+            model.save(data);
+            model.destroy();
+
+            auto& path = paths.emplace_back(dir / std::format("{}.gom", i));
+            engine::util::save_file(path, data.data(), size);
+        }
+
+        return paths;
+    }
+
+    // `Acquire` batching, split evenly across `threads` but never below `min_batch` models
+    uint32_t batch_size(uint32_t threads) {
+        return std::max(min_batch, (model_count + threads - 1) / threads);
+    }
+
+    void load_batch(const std::vector<std::filesystem::path>& paths, uint32_t batch, uint32_t size) {
+        auto end = std::min(model_count, (batch + 1) * size);
+        for (auto i = batch * size; i < end; i++) {
+            engine::Model model{};
+            if (engine::Model::map(model, paths[i])) model.destroy();
+        }
+    }
+
+    double load_threads(const std::vector<std::filesystem::path>& paths, uint32_t threads) {
+        auto size = batch_size(threads);
+        auto batches = (model_count + size - 1) / size;
+
+        std::atomic<uint32_t> next_batch = 0;
+        auto start = clock::now();
+
+        std::vector<std::thread> workers{};
+        for (uint32_t i = 0; i < threads; i++) {
+            workers.emplace_back([&] {
+                for (auto batch = next_batch++; batch < batches; batch = next_batch++) {
+                    load_batch(paths, batch, size);
+                }
+            });
+        }
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        return elapsed_ms(start);
+    }
+
+    double load_scheduler(const std::vector<std::filesystem::path>& paths) {
+        // the calling thread takes part in `parallel_for`
+        auto size = batch_size(engine::scheduler::worker_count() + 1);
+        auto batches = (model_count + size - 1) / size;
+
+        auto start = clock::now();
+        engine::scheduler::parallel_for(batches, 1, [&](uint32_t begin, uint32_t end) {
+            for (auto batch = begin; batch < end; batch++) {
+                load_batch(paths, batch, size);
+            }
+        });
+        return elapsed_ms(start);
+    }
+
+    void print_row(const char* label, uint32_t threads, double ms, double baseline, uintmax_t bytes) {
+        printf("  %-10s %3u threads %9.2fms  %8.0f models/s  %7.1f MB/s  x%.2f\n", label, threads, ms,
+               model_count / (ms / 1000.0), (double)bytes / (1024.0 * 1024.0) / (ms / 1000.0), baseline / ms);
+    }
+
+    void run() {
+        auto dir = std::filesystem::temp_directory_path() / "goliath-bench-models";
+        auto paths = write_models(dir);
+
+        uintmax_t bytes = 0;
+        for (const auto& path : paths) {
+            bytes += std::filesystem::file_size(path);
+        }
+
+        load_threads(paths, 1);
+
+        uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<uint32_t> thread_counts{};
+        for (uint32_t threads = 1; threads < cores; threads *= 2) {
+            thread_counts.emplace_back(threads);
+        }
+        thread_counts.emplace_back(cores);
+
+        double baseline = 0.0;
+        for (auto threads : thread_counts) {
+            auto ms = load_threads(paths, threads);
+            if (threads == 1) baseline = ms;
+            print_row("threads", threads, ms, baseline, bytes);
+        }
+
+        print_row("scheduler", engine::scheduler::worker_count() + 1, load_scheduler(paths), baseline, bytes);
+
+        std::filesystem::remove_all(dir);
+    }
+}
@@ -0,0 +1,87 @@
+#include "bench.hpp"
+
+#include "goliath/materials.hpp"
+#include "goliath/models.hpp"
+#include "goliath/samplers.hpp"
+#include "goliath/textures.hpp"
+
+#include <filesystem>
+#include <format>
+
+// fills each registry with 100k entries, swaps every other one out for a new one so the adds only get recycled
+// slots, then empties it again. with the free lists every phase should grow linearly with the entry count
+namespace bench::registry {
+    static constexpr uint32_t asset_count = 100'000;
+
+    template <typename Add, typename Remove> void measure(const char* label, Add&& add, Remove&& remove) {
+        std::vector<decltype(add(0u))> gids{};
+        gids.reserve(asset_count);
+
+        auto start = clock::now();
+        for (uint32_t i = 0; i < asset_count; i++) {
+            gids.emplace_back(add(i));
+        }
+        auto fill = elapsed_ms(start);
+
+        start = clock::now();
+        for (uint32_t i = 0; i < asset_count; i += 2) {
+            remove(gids[i]);
+        }
+        for (uint32_t i = 0; i < asset_count; i += 2) {
+            gids[i] = add(i);
+        }
+        auto churn = elapsed_ms(start);
+
+        start = clock::now();
+        for (auto gid : gids) {
+            remove(gid);
+        }
+        auto empty = elapsed_ms(start);
+
+        printf("  %-10s add %9.2fms  swap half %9.2fms  remove %9.2fms  (%.2fus per add)\n", label, fill, churn, empty,
+               fill * 1000.0 / asset_count);
+    }
+
+    void run() {
+        init_engine();
+
+        auto dir = std::filesystem::temp_directory_path() / "goliath-bench-registry";
+        std::filesystem::create_directories(dir / "models");
+        std::filesystem::create_directories(dir / "textures");
+
+        auto materials = engine::Materials::init(engine::Materials::default_json());
+        if (!materials) {
+            printf("  Couldn't create the default materials\n");
+            return;
+        }
+        auto* textures = engine::Textures::make((dir / "textures").string().c_str());
+        engine::models::init(dir / "models", textures, *materials);
+
+        measure(
+            "materials", [&](uint32_t i) { return (*materials)->add_instance(0, std::format("instance {}", i)); },
+            [&](auto gid) { (*materials)->remove_instance(gid); });
+
+        // the file never gets written, only the slot bookkeeping is measured
+        measure(
+            "models",
+            [](uint32_t i) {
+                return engine::models::add([](auto, const auto&) { return true; }, std::format("model {}", i));
+            },
+            [](auto gid) { engine::models::remove(gid); });
+
+        // textures write their .goi right away, a 1x1 image keeps that as cheap as it gets
+        uint8_t pixel[4] = {255, 255, 255, 255};
+        measure(
+            "textures",
+            [&](uint32_t i) {
+                return textures->add(pixel, 1, 1, VK_FORMAT_R8G8B8A8_UNORM, std::format("texture {}", i),
+                                     engine::Sampler{});
+            },
+            [&](auto gid) { textures->remove(gid); });
+
+        engine::models::destroy();
+        delete textures;
+        delete *materials;
+        std::filesystem::remove_all(dir);
+    }
+}
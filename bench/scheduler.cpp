@@ -0,0 +1,116 @@
+#include "bench.hpp"
+#include "thread_pool.hpp"
+
+#include "goliath/scheduler.hpp"
+
+#include <atomic>
+#include <memory>
+
+// the same independent jobs through the old pool, through the two pools the engine used to run side by side, and
+// through the scheduler, once as plain jobs and once as a `parallel_for`
+namespace bench::scheduler {
+    struct Workload {
+        const char* name;
+        uint32_t job_count;
+        // rounds of `work` per job
+        uint32_t job_size;
+    };
+
+    static constexpr Workload workloads[] = {
+        {"tiny jobs", 200'000, 64},
+        {"medium jobs", 20'000, 16'384},
+    };
+
+    // the results all end up in here so the work can't be optimized out
+    std::atomic<uint64_t> sink = 0;
+
+    void work(uint32_t rounds) {
+        uint64_t x = rounds | 1;
+        for (uint32_t i = 0; i < rounds; i++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+        }
+        sink.fetch_add(x, std::memory_order_relaxed);
+    }
+
+    struct Countdown {
+        std::atomic<uint32_t> left;
+
+        void done() {
+            if (left.fetch_sub(1, std::memory_order_acq_rel) == 1) left.notify_all();
+        }
+
+        void wait() {
+            for (auto value = left.load(std::memory_order_acquire); value != 0;
+                 value = left.load(std::memory_order_acquire)) {
+                left.wait(value, std::memory_order_acquire);
+            }
+        }
+    };
+
+    double run_pools(const Workload& workload, uint32_t pool_count) {
+        Countdown countdown{workload.job_count};
+        auto fn = [&](uint32_t rounds) {
+            work(rounds);
+            countdown.done();
+        };
+
+        std::vector<std::unique_ptr<old::ThreadPool<uint32_t, decltype(fn)>>> pools{};
+        for (uint32_t i = 0; i < pool_count; i++) {
+            pools.emplace_back(std::make_unique<old::ThreadPool<uint32_t, decltype(fn)>>(fn));
+        }
+
+        auto start = clock::now();
+        for (uint32_t i = 0; i < workload.job_count; i++) {
+            pools[i % pool_count]->enqueue(workload.job_size);
+        }
+        countdown.wait();
+        return elapsed_ms(start);
+    }
+
+    double run_jobs(const Workload& workload) {
+        std::vector<engine::scheduler::job> jobs{};
+        jobs.reserve(workload.job_count);
+
+        auto start = clock::now();
+        for (uint32_t i = 0; i < workload.job_count; i++) {
+            jobs.emplace_back(engine::scheduler::submit([rounds = workload.job_size] { work(rounds); }));
+        }
+        engine::scheduler::wait(jobs);
+        return elapsed_ms(start);
+    }
+
+    double run_parallel_for(const Workload& workload) {
+        // a few ranges per thread, enough for stealing to even them out
+        auto grain = std::max(1u, workload.job_count / ((engine::scheduler::worker_count() + 1) * 4));
+
+        auto start = clock::now();
+        engine::scheduler::parallel_for(workload.job_count, grain, [&](uint32_t begin, uint32_t end) {
+            for (auto i = begin; i < end; i++) {
+                work(workload.job_size);
+            }
+        });
+        return elapsed_ms(start);
+    }
+
+    void print_row(const char* label, double ms, double baseline, const Workload& workload) {
+        printf("  %-24s %9.2fms  %6.2fus/job  x%.2f\n", label, ms, ms * 1000.0 / workload.job_count, baseline / ms);
+    }
+
+    void run() {
+        // starts the workers outside of the measured runs
+        engine::scheduler::wait(engine::scheduler::submit([] {}));
+
+        for (const auto& workload : workloads) {
+            printf("  %s, %u jobs of %u rounds\n", workload.name, workload.job_count, workload.job_size);
+
+            auto baseline = run_pools(workload, 1);
+            print_row("ThreadPool", baseline, baseline, workload);
+            // models.cpp and textures.cpp each had a pool of their own
+            print_row("ThreadPool x2", run_pools(workload, 2), baseline, workload);
+            print_row("scheduler::submit", run_jobs(workload), baseline, workload);
+            print_row("scheduler::parallel_for", run_parallel_for(workload), baseline, workload);
+        }
+    }
+}
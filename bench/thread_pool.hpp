@@ -1,11 +1,14 @@
 #pragma once
 
 #include <condition_variable>
+#include <mutex>
 #include <queue>
 #include <thread>
 #include <vector>
 
-namespace engine {
+// the mutex and condition variable pool models.cpp and textures.cpp each had before `engine::scheduler`, kept only
+// so the scheduler section has something to compare against
+namespace bench::old {
     namespace __ {
         template <typename>
         struct function_traits;
@@ -0,0 +1,122 @@
+#include "bench.hpp"
+
+#include "goliath/buffer.hpp"
+#include "goliath/engine.hpp"
+#include "goliath/transport2.hpp"
+
+#include <thread>
+
+// a small priority upload at a time, the worker gets enough of a break in between to go idle again so every
+// upload pays for waking it up
+namespace bench::transport {
+    static constexpr uint32_t upload_size = 4 * 1024;
+    static constexpr uint32_t upload_count = 1000;
+    static constexpr auto upload_gap = std::chrono::milliseconds{2};
+    static constexpr auto idle_window = std::chrono::seconds{2};
+
+    void measure(engine::transport2::IdleMode mode, const char* label, engine::Buffer dst, void* data) {
+        engine::transport2::set_idle_mode(mode, engine::transport2::Config{}.spin_count);
+        std::this_thread::sleep_for(upload_gap);
+
+        std::vector<double> latencies{};
+        latencies.reserve(upload_count);
+        for (uint32_t i = 0; i < upload_count; i++) {
+            std::this_thread::sleep_for(upload_gap);
+
+            auto start = clock::now();
+            auto ticket = engine::transport2::upload(true, data, std::nullopt, upload_size, dst, 0,
+                                                     VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                                                     VK_ACCESS_2_MEMORY_READ_BIT);
+            while (!engine::transport2::is_ready(ticket)) {}
+            latencies.emplace_back(elapsed_us(start));
+        }
+
+        // nothing is queued, whatever cpu time passes now is the worker waiting for work
+        auto cpu_start = cpu_seconds();
+        auto wall_start = clock::now();
+        std::this_thread::sleep_for(idle_window);
+        auto cpu = cpu_seconds() - cpu_start;
+        auto wall = elapsed_ms(wall_start) / 1000.0;
+
+        print_latency(label, latencies);
+        printf("  %-28s idle cpu %.1f%% of a core\n", label, cpu / wall * 100.0);
+    }
+
+    void run() {
+        init_engine();
+
+        auto dst = engine::Buffer::create("Bench upload target", upload_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                          std::nullopt);
+        std::vector<uint8_t> data(upload_size, 0xAB);
+
+        measure(engine::transport2::IdleMode::Spin, "spin", dst, data.data());
+        measure(engine::transport2::IdleMode::Park, "park", dst, data.data());
+
+        dst.destroy();
+    }
+
+    static constexpr uint32_t ticket_count = 100'000;
+    static constexpr uint32_t ticket_upload_size = 16;
+    static constexpr uint32_t ticket_batch = 1024;
+
+    // every ticket gets its own tiny upload, the copies are negligible next to the ticket bookkeeping
+    double issue_tickets(std::vector<engine::transport2::ticket>& tickets, engine::Buffer dst, void* data) {
+        std::vector<engine::transport2::BufferUpload> uploads(ticket_batch);
+        for (uint32_t i = 0; i < ticket_batch; i++) {
+            uploads[i] = engine::transport2::BufferUpload{
+                .src = data,
+                .own = std::nullopt,
+                .size = ticket_upload_size,
+                .dst = dst,
+                .dst_offset = i * ticket_upload_size,
+                .dst_stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+                .dst_access = VK_ACCESS_2_MEMORY_READ_BIT,
+            };
+        }
+
+        auto start = clock::now();
+        for (uint32_t first = 0; first < ticket_count; first += ticket_batch) {
+            auto count = std::min(ticket_batch, ticket_count - first);
+            engine::transport2::upload(false, std::span{uploads}.first(count),
+                                       std::span{tickets}.subspan(first, count));
+        }
+        return elapsed_ms(start);
+    }
+
+    void run_tickets() {
+        init_engine();
+
+        auto dst = engine::Buffer::create("Bench ticket target", ticket_batch * ticket_upload_size,
+                                          VK_BUFFER_USAGE_TRANSFER_DST_BIT, std::nullopt);
+        std::vector<uint8_t> data(ticket_upload_size, 0xAB);
+        std::vector<engine::transport2::ticket> tickets(ticket_count);
+
+        // the second round only gets recycled slots, the first one grows the table
+        for (const char* round : {"fresh", "recycled"}) {
+            auto issue = issue_tickets(tickets, dst, data.data());
+
+            auto start = clock::now();
+            for (auto ticket : tickets) {
+                while (!engine::transport2::is_ready(ticket)) {}
+            }
+            auto complete = elapsed_ms(start);
+
+            start = clock::now();
+            uint32_t ready = 0;
+            for (auto ticket : tickets) {
+                ready += engine::transport2::is_ready(ticket);
+            }
+            auto sweep = elapsed_ms(start);
+
+            start = clock::now();
+            auto wait = engine::transport2::wait_on(tickets);
+            auto waited = elapsed_ms(start);
+
+            printf("  %-9s issue %8.2fms  complete %8.2fms  is_ready sweep %6.2fms (%.1fns/ticket)  wait_on %6.2fms\n",
+                   round, issue, complete, sweep, sweep * 1e6 / ticket_count, waited);
+            if (ready != ticket_count || wait.value == 0) printf("  %-9s not every ticket finished\n", round);
+        }
+
+        dst.destroy();
+    }
+}
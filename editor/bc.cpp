@@ -0,0 +1,362 @@
+#include "bc.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace bc {
+    // 16 texels of a 4x4 block in row order, missing channels are 0 except alpha, which is 255
+    using Block = std::array<std::array<uint8_t, 4>, 16>;
+
+    uint32_t channel_count(VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_R8_UNORM: return 1;
+            case VK_FORMAT_R8G8_UNORM: return 2;
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_SRGB: return 4;
+            default: return 0;
+        }
+    }
+
+    uint32_t block_bytes(VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC4_UNORM_BLOCK: return 8;
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK: return 16;
+            default: assert(false && "Unsupported block format"); return 0;
+        }
+    }
+
+    // texels past the image's edge repeat the last row/column
+    Block fetch_block(const uint8_t* texels, uint32_t width, uint32_t height, uint32_t channels, uint32_t x,
+                      uint32_t y) {
+        Block block{};
+        for (uint32_t by = 0; by < 4; by++) {
+            uint32_t sy = std::min(y + by, height - 1);
+            for (uint32_t bx = 0; bx < 4; bx++) {
+                uint32_t sx = std::min(x + bx, width - 1);
+                const uint8_t* texel = texels + ((size_t)sy * width + sx) * channels;
+
+                auto& out = block[by * 4 + bx];
+                out = {0, 0, 0, 255};
+                for (uint32_t c = 0; c < channels; c++) {
+                    out[c] = texel[c];
+                }
+            }
+        }
+
+        return block;
+    }
+
+    // writes the low `count` bits of `value` LSB first, `out` has to be zeroed
+    void put_bits(uint8_t* out, uint32_t& pos, uint32_t value, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++, pos++) {
+            if ((value >> i) & 1) out[pos / 8] |= (uint8_t)(1 << (pos % 8));
+        }
+    }
+
+    template <std::size_t N> uint32_t nearest(const std::array<uint8_t, 4>& texel, const int (&palette)[N][4],
+                                              uint32_t channels) {
+        uint32_t best = 0;
+        int best_err = std::numeric_limits<int>::max();
+        for (uint32_t i = 0; i < N; i++) {
+            int err = 0;
+            for (uint32_t c = 0; c < channels; c++) {
+                int d = (int)texel[c] - palette[i][c];
+                err += d * d;
+            }
+
+            if (err < best_err) {
+                best_err = err;
+                best = i;
+            }
+        }
+
+        return best;
+    }
+
+    // end points of the block's first `channels` channels along their principal axis
+    void principal_endpoints(const Block& block, uint32_t channels, float (&lo)[4], float (&hi)[4]) {
+        float mean[4]{};
+        float min[4]{255.0f, 255.0f, 255.0f, 255.0f};
+        float max[4]{};
+        for (const auto& texel : block) {
+            for (uint32_t c = 0; c < channels; c++) {
+                mean[c] += texel[c] / 16.0f;
+                min[c] = std::min(min[c], (float)texel[c]);
+                max[c] = std::max(max[c], (float)texel[c]);
+            }
+        }
+
+        float cov[4][4]{};
+        for (const auto& texel : block) {
+            for (uint32_t i = 0; i < channels; i++) {
+                for (uint32_t j = 0; j < channels; j++) {
+                    cov[i][j] += (texel[i] - mean[i]) * (texel[j] - mean[j]);
+                }
+            }
+        }
+
+        // power iteration, seeded with the bounding box diagonal
+        float axis[4]{};
+        for (uint32_t c = 0; c < channels; c++) {
+            axis[c] = max[c] - min[c];
+        }
+
+        for (uint32_t iter = 0; iter < 8; iter++) {
+            float next[4]{};
+            float largest = 0.0f;
+            for (uint32_t i = 0; i < channels; i++) {
+                for (uint32_t j = 0; j < channels; j++) {
+                    next[i] += cov[i][j] * axis[j];
+                }
+                largest = std::max(largest, std::abs(next[i]));
+            }
+
+            if (largest == 0.0f) break;
+            for (uint32_t c = 0; c < channels; c++) {
+                axis[c] = next[c] / largest;
+            }
+        }
+
+        float length = 0.0f;
+        for (uint32_t c = 0; c < channels; c++) {
+            length += axis[c] * axis[c];
+        }
+
+        if (length == 0.0f) {
+            for (uint32_t c = 0; c < 4; c++) {
+                lo[c] = c < channels ? mean[c] : 255.0f;
+                hi[c] = lo[c];
+            }
+            return;
+        }
+
+        length = std::sqrt(length);
+        for (uint32_t c = 0; c < channels; c++) {
+            axis[c] /= length;
+        }
+
+        float t_min = std::numeric_limits<float>::max();
+        float t_max = std::numeric_limits<float>::lowest();
+        for (const auto& texel : block) {
+            float t = 0.0f;
+            for (uint32_t c = 0; c < channels; c++) {
+                t += (texel[c] - mean[c]) * axis[c];
+            }
+            t_min = std::min(t_min, t);
+            t_max = std::max(t_max, t);
+        }
+
+        for (uint32_t c = 0; c < 4; c++) {
+            lo[c] = c < channels ? std::clamp(mean[c] + axis[c] * t_min, 0.0f, 255.0f) : 255.0f;
+            hi[c] = c < channels ? std::clamp(mean[c] + axis[c] * t_max, 0.0f, 255.0f) : 255.0f;
+        }
+    }
+
+    uint16_t to_565(const float (&color)[4]) {
+        uint32_t r = (uint32_t)std::lround(color[0] * 31.0f / 255.0f);
+        uint32_t g = (uint32_t)std::lround(color[1] * 63.0f / 255.0f);
+        uint32_t b = (uint32_t)std::lround(color[2] * 31.0f / 255.0f);
+        return (uint16_t)(r << 11 | g << 5 | b);
+    }
+
+    void from_565(uint16_t value, int (&color)[4]) {
+        int r = (value >> 11) & 31;
+        int g = (value >> 5) & 63;
+        int b = value & 31;
+        color[0] = r << 3 | r >> 2;
+        color[1] = g << 2 | g >> 4;
+        color[2] = b << 3 | b >> 2;
+        color[3] = 255;
+    }
+
+    // always uses the opaque four colour mode
+    void encode_bc1(const Block& block, uint8_t* out) {
+        float lo[4], hi[4];
+        principal_endpoints(block, 3, lo, hi);
+
+        uint16_t c0 = to_565(hi);
+        uint16_t c1 = to_565(lo);
+        if (c0 < c1) std::swap(c0, c1);
+
+        uint32_t indices = 0;
+        if (c0 != c1) {
+            int palette[4][4];
+            from_565(c0, palette[0]);
+            from_565(c1, palette[1]);
+            for (uint32_t c = 0; c < 3; c++) {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            for (uint32_t i = 0; i < 16; i++) {
+                indices |= nearest(block[i], palette, 3) << (2 * i);
+            }
+        }
+
+        std::memcpy(out, &c0, sizeof(uint16_t));
+        std::memcpy(out + 2, &c1, sizeof(uint16_t));
+        std::memcpy(out + 4, &indices, sizeof(uint32_t));
+    }
+
+    // always uses the eight value mode
+    void encode_bc4(const Block& block, uint32_t channel, uint8_t* out) {
+        uint8_t lo = 255;
+        uint8_t hi = 0;
+        for (const auto& texel : block) {
+            lo = std::min(lo, texel[channel]);
+            hi = std::max(hi, texel[channel]);
+        }
+
+        uint64_t indices = 0;
+        if (lo != hi) {
+            int palette[8][4]{};
+            palette[0][0] = hi;
+            palette[1][0] = lo;
+            for (int i = 1; i < 7; i++) {
+                palette[i + 1][0] = ((7 - i) * hi + i * lo) / 7;
+            }
+
+            for (uint32_t i = 0; i < 16; i++) {
+                std::array<uint8_t, 4> value{block[i][channel], 0, 0, 0};
+                indices |= (uint64_t)nearest(value, palette, 1) << (3 * i);
+            }
+        }
+
+        out[0] = hi;
+        out[1] = lo;
+        for (uint32_t i = 0; i < 6; i++) {
+            out[2 + i] = (uint8_t)(indices >> (8 * i));
+        }
+    }
+
+    void quantize_bc7(const float (&endpoint)[4], uint8_t (&quantized)[4], uint8_t& p_bit) {
+        float best_err = std::numeric_limits<float>::max();
+        for (uint8_t p = 0; p < 2; p++) {
+            uint8_t candidate[4];
+            float err = 0.0f;
+            for (uint32_t c = 0; c < 4; c++) {
+                candidate[c] = (uint8_t)std::clamp<long>(std::lround((endpoint[c] - p) / 2.0f), 0, 127);
+
+                float d = (float)(candidate[c] << 1 | p) - endpoint[c];
+                err += d * d;
+            }
+
+            if (err < best_err) {
+                best_err = err;
+                p_bit = p;
+                std::memcpy(quantized, candidate, sizeof(candidate));
+            }
+        }
+    }
+
+    // mode 6 only, a single RGBA subset with 7 bit end points, unique p-bits and 4 bit indices
+    void encode_bc7(const Block& block, uint8_t* out) {
+        static constexpr int weights[16]{0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+        float lo[4], hi[4];
+        principal_endpoints(block, 4, lo, hi);
+
+        uint8_t endpoints[2][4];
+        uint8_t p_bits[2];
+        quantize_bc7(lo, endpoints[0], p_bits[0]);
+        quantize_bc7(hi, endpoints[1], p_bits[1]);
+
+        int palette[16][4];
+        for (uint32_t i = 0; i < 16; i++) {
+            for (uint32_t c = 0; c < 4; c++) {
+                int e0 = endpoints[0][c] << 1 | p_bits[0];
+                int e1 = endpoints[1][c] << 1 | p_bits[1];
+                palette[i][c] = ((64 - weights[i]) * e0 + weights[i] * e1 + 32) >> 6;
+            }
+        }
+
+        uint32_t indices[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            indices[i] = nearest(block[i], palette, 4);
+        }
+
+        // the anchor index has its top bit implied to be 0
+        if (indices[0] & 8) {
+            std::swap(endpoints[0], endpoints[1]);
+            std::swap(p_bits[0], p_bits[1]);
+            for (auto& index : indices) {
+                index = 15 - index;
+            }
+        }
+
+        std::memset(out, 0, 16);
+        uint32_t pos = 0;
+        put_bits(out, pos, 1 << 6, 7);
+        for (uint32_t c = 0; c < 4; c++) {
+            put_bits(out, pos, endpoints[0][c], 7);
+            put_bits(out, pos, endpoints[1][c], 7);
+        }
+        put_bits(out, pos, p_bits[0], 1);
+        put_bits(out, pos, p_bits[1], 1);
+
+        put_bits(out, pos, indices[0], 3);
+        for (uint32_t i = 1; i < 16; i++) {
+            put_bits(out, pos, indices[i], 4);
+        }
+    }
+
+    VkFormat pick_format(VkFormat format, std::span<const uint8_t> texels) {
+        switch (format) {
+            case VK_FORMAT_R8_UNORM: return VK_FORMAT_BC4_UNORM_BLOCK;
+            case VK_FORMAT_R8G8_UNORM: return VK_FORMAT_BC5_UNORM_BLOCK;
+            case VK_FORMAT_R8G8B8A8_UNORM: return VK_FORMAT_BC7_UNORM_BLOCK;
+            case VK_FORMAT_R8G8B8A8_SRGB:
+                for (std::size_t i = 3; i < texels.size(); i += 4) {
+                    if (texels[i] != 255) return VK_FORMAT_BC3_SRGB_BLOCK;
+                }
+                return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+            default: return format;
+        }
+    }
+
+    uint32_t encoded_size(uint32_t width, uint32_t height, VkFormat format) {
+        return ((width + 3) / 4) * ((height + 3) / 4) * block_bytes(format);
+    }
+
+    void encode(std::span<const uint8_t> texels, uint32_t width, uint32_t height, VkFormat src_format,
+                VkFormat format, uint8_t* out) {
+        uint32_t channels = channel_count(src_format);
+        assert(channels != 0 && "Unsupported source format");
+        assert(texels.size() >= (std::size_t)width * height * channels);
+
+        const uint32_t bytes = block_bytes(format);
+        for (uint32_t y = 0; y < height; y += 4) {
+            for (uint32_t x = 0; x < width; x += 4, out += bytes) {
+                auto block = fetch_block(texels.data(), width, height, channels, x, y);
+
+                switch (format) {
+                    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                    case VK_FORMAT_BC1_RGB_SRGB_BLOCK: encode_bc1(block, out); break;
+                    case VK_FORMAT_BC3_UNORM_BLOCK:
+                    case VK_FORMAT_BC3_SRGB_BLOCK:
+                        encode_bc4(block, 3, out);
+                        encode_bc1(block, out + 8);
+                        break;
+                    case VK_FORMAT_BC4_UNORM_BLOCK: encode_bc4(block, 0, out); break;
+                    case VK_FORMAT_BC5_UNORM_BLOCK:
+                        encode_bc4(block, 0, out);
+                        encode_bc4(block, 1, out + 8);
+                        break;
+                    case VK_FORMAT_BC7_UNORM_BLOCK:
+                    case VK_FORMAT_BC7_SRGB_BLOCK: encode_bc7(block, out); break;
+                    default: assert(false && "Unsupported block format");
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vulkan/vulkan_core.h>
+
+namespace bc {
+    // block compressed format an image in `format` gets stored as, `format` itself when it has to stay uncompressed
+    // single channel -> BC4, two channels -> BC5, srgb colour -> BC1 or BC3 when it uses alpha, linear RGBA -> BC7
+    VkFormat pick_format(VkFormat format, std::span<const uint8_t> texels);
+
+    // byte size of a `width`x`height` image encoded as `format`
+    uint32_t encoded_size(uint32_t width, uint32_t height, VkFormat format);
+
+    // encodes tightly packed `src_format` texels into `format` blocks, `out` has to hold `encoded_size` bytes
+    void encode(std::span<const uint8_t> texels, uint32_t width, uint32_t height, VkFormat src_format,
+                VkFormat format, uint8_t* out);
+}
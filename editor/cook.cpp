@@ -0,0 +1,562 @@
+#include "gltf.hpp"
+#include "project.hpp"
+#include "state.hpp"
+#include "textures.hpp"
+
+#include "goliath/dependency_graph.hpp"
+#include "goliath/materials.hpp"
+#include "goliath/models.hpp"
+#include "goliath/scheduler.hpp"
+#include "goliath/textures.hpp"
+#include "goliath/util.hpp"
+
+#include "xxhash.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+// goliath-cook converts a directory of glTF, PNG and JPG sources into the project's .gom and .goi files without a
+// window or a GPU and writes the registries the editor and the game load. a manifest next to the models registry
+// keeps the content hash and output of every source, so a run only converts what changed since the last one
+namespace cook {
+    // bump whenever the importers change what they write, every source gets converted again
+    static constexpr uint64_t version = 1;
+
+    struct Source {
+        enum Kind {
+            Model,
+            Texture,
+        };
+
+        std::filesystem::path path;
+        // path relative to the sources directory, the manifest key
+        std::string key;
+        Kind kind;
+
+        uint64_t hash = 0;
+        // files outside of the source itself that went into `hash`, the buffers and images of a .gltf
+        std::vector<std::filesystem::path> referenced{};
+
+        std::optional<engine::DependencyGraph::AssetGID> output{};
+        bool dirty = true;
+        bool failed = false;
+        // set by `cook_model` when another source's model is identical, the source's own model is dropped for it
+        std::optional<engine::models::gid> shared{};
+    };
+
+    // the cook never loads a model or a texture, it only hands out gids the way the editor would
+    engine::models::Registry models_registry{};
+    engine::Textures::Registry textures_registry{};
+
+    // guards `textures_registry` and `reusable_textures` while the importers run
+    std::mutex textures_mutex{};
+    // textures of the models being converted again, handed to the new texture of the same name so their gids stay
+    std::unordered_map<std::string, engine::Textures::gid> reusable_textures{};
+
+    std::filesystem::path manifest_path() {
+        return project::models_registry.parent_path() / "cook.json";
+    }
+
+    std::string lowercase_extension(const std::filesystem::path& path) {
+        auto ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+        return ext;
+    }
+
+    void remove_texture(engine::Textures::gid gid) {
+        if (!textures_registry.free(gid)) return;
+
+        std::filesystem::remove(project::textures_directory / engine::make_texture_path(gid));
+    }
+
+    // `texture_sink` while the importers run, every glTF texture ends up here
+    engine::Textures::gid sink_texture(EncodedTexture& texture, std::string name, engine::Sampler sampler) {
+        auto hash = content_hash(texture, sampler);
+
+        engine::Textures::gid gid;
+        {
+            std::lock_guard lock{textures_mutex};
+
+            if (auto existing = state::dependency_graph->find_content(hash); existing) {
+                const auto* shared = std::get_if<engine::Textures::gid>(&*existing);
+                if (shared && textures_registry.is_alive(*shared)) return *shared;
+            }
+
+            if (auto it = reusable_textures.find(name); it != reusable_textures.end()) {
+                gid = it->second;
+                reusable_textures.erase(it);
+                textures_registry.sampler_prototypes[gid.id()] = sampler;
+            } else {
+                gid = textures_registry.alloc(std::move(name), sampler);
+            }
+
+            state::dependency_graph->add_content(hash, gid);
+        }
+
+        engine::Textures::write(project::textures_directory / engine::make_texture_path(gid), texture.payload,
+                                texture.width, texture.height, texture.format, texture.mip_levels);
+        return gid;
+    }
+
+    // drops the material instances and textures only `gid` used, like the editor's "Remove, including unused
+    // dependencies". with `keep_textures` they're parked in `reusable_textures` instead of being deleted
+    void release_model(engine::models::gid gid, bool keep_textures) {
+        auto [removed, _] = state::dependency_graph->deep_remove(gid);
+
+        for (const auto& asset : removed) {
+            if (const auto* material = std::get_if<engine::Materials::gid>(&asset)) {
+                state::materials->remove_instance(*material);
+            } else if (const auto* texture = std::get_if<engine::Textures::gid>(&asset)) {
+                if (!textures_registry.is_alive(*texture)) continue;
+
+                if (keep_textures) {
+                    reusable_textures[textures_registry.names[texture->id()]] = *texture;
+                } else {
+                    remove_texture(*texture);
+                }
+            }
+        }
+    }
+
+    void remove_model(engine::models::gid gid) {
+        if (!models_registry.is_alive(gid)) return;
+
+        release_model(gid, false);
+        models_registry.free(gid);
+
+        std::filesystem::remove(project::models_directory / engine::models::make_model_path(gid));
+    }
+
+    // how many sources have each model as their output, by `gid::value`. identical models of different sources
+    // share one gid, it's only removed once none of them use it anymore
+    std::unordered_map<uint32_t, uint32_t> model_refs{};
+
+    void remove_output(const engine::DependencyGraph::AssetGID& output) {
+        if (const auto* model = std::get_if<engine::models::gid>(&output)) {
+            remove_model(*model);
+        } else if (const auto* texture = std::get_if<engine::Textures::gid>(&output)) {
+            // glTF materials can share it through the content index, then it stays until the last of them is gone
+            if (state::dependency_graph->ref_count(*texture) != 0) return;
+
+            state::dependency_graph->remove_asset(*texture);
+            remove_texture(*texture);
+        }
+    }
+
+    // drops one source's claim on `output`
+    void release_output(const engine::DependencyGraph::AssetGID& output) {
+        if (const auto* model = std::get_if<engine::models::gid>(&output)) {
+            if (auto refs = model_refs.find(model->value); refs != model_refs.end()) {
+                if (--refs->second != 0) return;
+                model_refs.erase(refs);
+            }
+        }
+
+        remove_output(output);
+    }
+
+    // the source's model turned out identical to `shared`, it takes that one over its own
+    void share_output(Source& source) {
+        release_output(*source.output);
+        source.output = *source.shared;
+        model_refs[source.shared->value]++;
+    }
+
+    bool output_exists(const engine::DependencyGraph::AssetGID& output) {
+        if (const auto* model = std::get_if<engine::models::gid>(&output)) {
+            return models_registry.is_alive(*model) &&
+                   std::filesystem::exists(project::models_directory / engine::models::make_model_path(*model));
+        } else if (const auto* texture = std::get_if<engine::Textures::gid>(&output)) {
+            return textures_registry.is_alive(*texture) &&
+                   std::filesystem::exists(project::textures_directory / engine::make_texture_path(*texture));
+        }
+
+        return false;
+    }
+
+    bool hash_file(XXH3_state_t* state, const std::filesystem::path& path) {
+        uint32_t size;
+        auto* data = engine::util::read_file(path, &size);
+        if (data == nullptr) return false;
+
+        XXH3_64bits_update(state, data, size);
+        free(data);
+        return true;
+    }
+
+    // the external buffers and images a .gltf points at, embedded `data:` uris are already part of the file
+    std::vector<std::filesystem::path> gltf_references(const std::filesystem::path& path) {
+        std::vector<std::filesystem::path> references{};
+
+        std::ifstream file{path};
+        auto j = nlohmann::json::parse(file, nullptr, false);
+        if (j.is_discarded()) return references;
+
+        for (const char* key : {"buffers", "images"}) {
+            auto entries = j.find(key);
+            if (entries == j.end() || !entries->is_array()) continue;
+
+            for (const auto& entry : *entries) {
+                auto uri = entry.find("uri");
+                if (uri == entry.end() || !uri->is_string()) continue;
+
+                auto str = uri->get<std::string>();
+                if (str.starts_with("data:")) continue;
+
+                references.emplace_back(path.parent_path() / str);
+            }
+        }
+
+        return references;
+    }
+
+    void hash_source(Source& source) {
+        auto* state = XXH3_createState();
+        XXH3_64bits_reset_withSeed(state, version);
+
+        bool read = hash_file(state, source.path);
+        if (read && source.kind == Source::Model && lowercase_extension(source.path) == ".gltf") {
+            source.referenced = gltf_references(source.path);
+            for (const auto& path : source.referenced) {
+                hash_file(state, path);
+            }
+        }
+
+        // an unreadable source never matches the manifest, so it's converted and reported as failed
+        source.hash = read ? XXH3_64bits_digest(state) : 0;
+        XXH3_freeState(state);
+    }
+
+    bool cook_model(Source& source) {
+        uint32_t size;
+        auto* data = engine::util::read_file(source.path, &size);
+        if (data == nullptr) {
+            printf("%s: couldn't read the file\n", source.key.c_str());
+            return false;
+        }
+
+        auto gid = std::get<engine::models::gid>(*source.output);
+        auto base_dir = source.path.parent_path().string();
+
+        engine::Model model{};
+        std::string error{};
+        std::string warning{};
+        auto err = lowercase_extension(source.path) == ".glb"
+                       ? gltf::load_bin(&model, {data, size}, base_dir, gid, &error, &warning)
+                       : gltf::load_json(&model, {data, size}, base_dir, gid, &error, &warning);
+        free(data);
+
+        if (!warning.empty()) printf("%s: %s\n", source.key.c_str(), warning.c_str());
+        if (err != gltf::Ok) {
+            printf("%s: import failed with error %d %s\n", source.key.c_str(), err, error.c_str());
+            model.destroy();
+            return false;
+        }
+
+        // the registry isn't touched while the importers run, the duplicate is dropped by `share_output` afterwards
+        auto alive = [](engine::models::gid model) { return models_registry.is_alive(model); };
+        if (auto existing = gltf::find_or_index(gltf::content_hash(model), gid, alive); existing) {
+            source.shared = *existing;
+            model.destroy();
+            return true;
+        }
+
+        auto save_size = model.get_save_size();
+        auto* save_data = (uint8_t*)malloc(save_size);
+        model.save({save_data, save_size});
+        engine::util::save_file(project::models_directory / engine::models::make_model_path(gid), save_data,
+                                (uint32_t)save_size);
+
+        free(save_data);
+        model.destroy();
+        return true;
+    }
+
+    bool cook_texture(const Source& source) {
+        auto texture = load_texture(source.path);
+        if (!texture) {
+            printf("%s: couldn't decode the image\n", source.key.c_str());
+            return false;
+        }
+
+        auto gid = std::get<engine::Textures::gid>(*source.output);
+        engine::Sampler sampler;
+        {
+            std::lock_guard lock{textures_mutex};
+            sampler = textures_registry.sampler_prototypes[gid.id()];
+        }
+
+        // later glTF imports of the same texels share this texture instead of storing their own copy
+        state::dependency_graph->add_content(content_hash(*texture, sampler), gid);
+
+        engine::Textures::write(project::textures_directory / engine::make_texture_path(gid), texture->payload,
+                                texture->width, texture->height, texture->format, texture->mip_levels);
+        return true;
+    }
+
+    std::vector<Source> find_sources(const std::filesystem::path& sources_dir) {
+        std::vector<Source> sources{};
+
+        for (const auto& entry : std::filesystem::recursive_directory_iterator{sources_dir}) {
+            if (!entry.is_regular_file()) continue;
+
+            auto ext = lowercase_extension(entry.path());
+            Source::Kind kind;
+            if (ext == ".gltf" || ext == ".glb") kind = Source::Model;
+            else if (ext == ".png" || ext == ".jpg" || ext == ".jpeg") kind = Source::Texture;
+            else continue;
+
+            sources.emplace_back(Source{
+                .path = entry.path(),
+                .key = std::filesystem::relative(entry.path(), sources_dir).generic_string(),
+                .kind = kind,
+            });
+        }
+
+        // gids are handed out in this order, sorting keeps them the same between machines
+        std::sort(sources.begin(), sources.end(), [](const auto& a, const auto& b) { return a.key < b.key; });
+
+        return sources;
+    }
+
+    // images a .gltf points at are converted by its import, not as textures of their own
+    void drop_referenced_images(std::vector<Source>& sources) {
+        std::unordered_set<std::string> referenced{};
+        for (const auto& source : sources) {
+            for (const auto& path : source.referenced) {
+                referenced.emplace(std::filesystem::weakly_canonical(path).string());
+            }
+        }
+
+        if (referenced.empty()) return;
+
+        std::erase_if(sources, [&](const Source& source) {
+            return source.kind == Source::Texture &&
+                   referenced.contains(std::filesystem::weakly_canonical(source.path).string());
+        });
+    }
+
+    void from_json(const nlohmann::json& j, engine::DependencyGraph::AssetGID& output) {
+        if (j.contains("model")) {
+            output = j["model"].get<engine::models::gid>();
+        } else {
+            output = j["texture"].get<engine::Textures::gid>();
+        }
+    }
+
+    nlohmann::json manifest_entry(const Source& source) {
+        nlohmann::json j{{"hash", source.hash}};
+        if (const auto* model = std::get_if<engine::models::gid>(&*source.output)) {
+            j["model"] = *model;
+        } else {
+            j["texture"] = std::get<engine::Textures::gid>(*source.output);
+        }
+
+        return j;
+    }
+
+    // decides which sources have to be converted and gives every one of them a gid. sources that were converted
+    // before keep theirs, the ones gone from the sources directory get their outputs removed
+    void plan(std::vector<Source>& sources, const nlohmann::json& manifest) {
+        std::unordered_set<std::string> present{};
+        for (const auto& source : sources) {
+            present.emplace(source.key);
+        }
+
+        for (const auto& [key, entry] : manifest.items()) {
+            engine::DependencyGraph::AssetGID output;
+            from_json(entry, output);
+            if (const auto* model = std::get_if<engine::models::gid>(&output)) model_refs[model->value]++;
+        }
+
+        for (const auto& [key, entry] : manifest.items()) {
+            if (present.contains(key)) continue;
+
+            engine::DependencyGraph::AssetGID output;
+            from_json(entry, output);
+            release_output(output);
+        }
+
+        for (auto& source : sources) {
+            std::optional<engine::DependencyGraph::AssetGID> previous{};
+            bool same_hash = false;
+            if (auto entry = manifest.find(source.key); entry != manifest.end()) {
+                engine::DependencyGraph::AssetGID output;
+                from_json(*entry, output);
+                previous = output;
+                same_hash = (*entry)["hash"].get<uint64_t>() == source.hash && source.hash != 0;
+            }
+
+            bool same_kind = previous && std::holds_alternative<engine::models::gid>(*previous) ==
+                                             (source.kind == Source::Model);
+            if (same_kind && same_hash && output_exists(*previous)) {
+                source.output = previous;
+                source.dirty = false;
+                continue;
+            }
+
+            auto name = source.path.stem().string();
+            // a model other sources share is left to them, converting it in place would change theirs too
+            bool shared = previous && std::holds_alternative<engine::models::gid>(*previous) &&
+                          model_refs[std::get<engine::models::gid>(*previous).value] > 1;
+            if (same_kind && !shared && std::holds_alternative<engine::models::gid>(*previous) &&
+                models_registry.is_alive(std::get<engine::models::gid>(*previous))) {
+                auto gid = std::get<engine::models::gid>(*previous);
+                release_model(gid, true);
+                source.output = gid;
+            } else if (same_kind && std::holds_alternative<engine::Textures::gid>(*previous) &&
+                       textures_registry.is_alive(std::get<engine::Textures::gid>(*previous))) {
+                // written over in place, materials pointing at it see the new image
+                source.output = previous;
+            } else {
+                if (previous) release_output(*previous);
+
+                if (source.kind == Source::Model) {
+                    source.output = models_registry.alloc(name);
+                    model_refs[std::get<engine::models::gid>(*source.output).value]++;
+                } else {
+                    source.output = textures_registry.alloc(name, engine::Sampler{});
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    std::optional<nlohmann::json> read_registry(const std::filesystem::path& path, const char* what, T&& fallback) {
+        auto j = engine::util::read_json(path);
+        if (!j.has_value() && j.error() == engine::util::ReadJsonErr::FileErr && !std::filesystem::exists(path)) {
+            return fallback();
+        } else if (!j.has_value()) {
+            printf("%s file is corrupted\n", what);
+            return std::nullopt;
+        }
+
+        return *j;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: goliath-cook <sources directory>\n"
+               "converts every .gltf, .glb, .png and .jpg under the directory into the project found from the "
+               "working directory\n");
+        return 1;
+    }
+
+    auto sources_dir = std::filesystem::absolute(argv[1]);
+    if (!std::filesystem::is_directory(sources_dir)) {
+        printf("`%s` isn't a directory\n", sources_dir.string().c_str());
+        return 1;
+    }
+
+    if (!project::find_project()) {
+        printf("No goliath.json found in the working directory or any of its parents\n");
+        return 1;
+    }
+    std::filesystem::current_path(project::project_root);
+
+    std::filesystem::create_directories(project::models_directory);
+    std::filesystem::create_directories(project::textures_directory);
+
+    auto dep_graph = engine::DependencyGraph::init(project::dependency_graph_metadata_directory);
+    if (!dep_graph) {
+        auto [path, err] = dep_graph.error();
+        printf("Couldn't create the asset dependency graph, error %d at file `%s`\n", err, path.string().c_str());
+        return 1;
+    }
+    state::dependency_graph = *dep_graph;
+
+    auto mats_json = cook::read_registry(project::materials, "materials.json", engine::Materials::default_json);
+    if (!mats_json) return 1;
+
+    auto mats = engine::Materials::init(*mats_json);
+    if (!mats) return 1;
+    state::materials = *mats;
+
+    auto empty_array = [] { return nlohmann::json::array(); };
+    auto tex_reg_json = cook::read_registry(project::textures_registry, "Texture registry", empty_array);
+    auto models_reg_json = cook::read_registry(project::models_registry, "Models registry", empty_array);
+    auto manifest = cook::read_registry(cook::manifest_path(), "Cook manifest", [] { return nlohmann::json::object(); });
+    if (!tex_reg_json || !models_reg_json || !manifest) return 1;
+
+    cook::textures_registry.load(*tex_reg_json);
+    cook::models_registry.load(*models_reg_json);
+
+    texture_sink = cook::sink_texture;
+
+    auto sources = cook::find_sources(sources_dir);
+    engine::scheduler::parallel_for((uint32_t)sources.size(), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            cook::hash_source(sources[i]);
+        }
+    });
+    cook::drop_referenced_images(sources);
+
+    cook::plan(sources, *manifest);
+
+    std::vector<engine::scheduler::job> jobs{};
+    for (auto& source : sources) {
+        if (!source.dirty) continue;
+
+        jobs.emplace_back(engine::scheduler::submit([&source] {
+            source.failed = source.kind == cook::Source::Model ? !cook::cook_model(source) : !cook::cook_texture(source);
+        }));
+    }
+    engine::scheduler::wait(jobs);
+
+    uint32_t cooked = 0;
+    uint32_t failed = 0;
+    auto new_manifest = nlohmann::json::object();
+    for (auto& source : sources) {
+        if (source.failed) {
+            // nothing is left behind for it, the next run tries again
+            cook::release_output(*source.output);
+            failed++;
+            continue;
+        }
+
+        if (source.shared) cook::share_output(source);
+
+        if (source.dirty) cooked++;
+        new_manifest[source.key] = cook::manifest_entry(source);
+    }
+
+    // textures of converted models whose new import didn't produce one with the same name
+    for (const auto& [name, gid] : cook::reusable_textures) {
+        state::dependency_graph->remove_asset(gid);
+        cook::remove_texture(gid);
+    }
+
+    {
+        std::ofstream o{project::models_registry};
+        o << cook::models_registry.save();
+    }
+    {
+        std::ofstream o{project::textures_registry};
+        o << cook::textures_registry.save();
+    }
+    {
+        std::ofstream o{project::materials};
+        o << state::materials->save();
+    }
+    {
+        std::ofstream o{cook::manifest_path()};
+        o << new_manifest.dump(4);
+    }
+    state::dependency_graph->save();
+
+    printf("%u converted, %u up to date, %u failed\n", cooked, (uint32_t)sources.size() - cooked - failed, failed);
+
+    return failed == 0 ? 0 : 1;
+}
@@ -4,17 +4,48 @@
 #include "goliath/materials.hpp"
 #include "goliath/models.hpp"
 #include "goliath/textures.hpp"
+#include "lods.hpp"
+#include "meshlets.hpp"
+#include "optimize.hpp"
 #include "state.hpp"
 #include "textures.hpp"
 
+#include "goliath/scheduler.hpp"
+
+#include "xxhash.h"
+
+#include <mutex>
+
 #define TINYGLTF_IMPLEMENTATION
 #define NO_STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "tinygltf/tiny_gltf.h"
 
+struct TextureTask {
+    int tex_id;
+    bool srgb;
+    std::string name;
+
+    engine::Textures::gid gid{0, 0};
+    engine::scheduler::job job{};
+};
+
+struct PrimitiveTask {
+    const tinygltf::Primitive* primitive;
+    std::string name;
+    uint32_t mesh_ix;
+
+    gltf::Err err = gltf::Ok;
+};
+
+// filled in by walking the scene, the tasks run once the whole scene is known
 struct Handled {
     std::vector<std::pair<uint32_t, std::vector<uint32_t>>> meshes{};
-    std::vector<std::pair<uint32_t, engine::Textures::gid>> textures{};
+    std::vector<PrimitiveTask> primitives{};
+    // first come first named, like the primitives referencing them
+    std::vector<TextureTask> textures{};
+    // `hash_primitive` of every queued primitive and the mesh it became
+    std::vector<std::pair<uint64_t, uint32_t>> geometry{};
 };
 
 uint32_t get_type_size(int type) {
@@ -103,21 +134,15 @@ void* copy_buffer(uint32_t* size, uint32_t* element_size, const tinygltf::Model&
     return arr;
 }
 
-engine::Textures::gid parse_texture(const std::string& tex_name, const tinygltf::Model& model,
-                                    int tex_id, bool srgb, Handled& handled) {
-    if (tex_id == -1) return {0, 0};
-    for (const auto& [id, gid] : handled.textures) {
-        if (tex_id == id) return gid;
-    }
-
-    const auto& texture = model.textures[tex_id];
-    if (texture.source == -1) return {0, 0};
+void parse_texture(const tinygltf::Model& model, TextureTask& task) {
+    const auto& texture = model.textures[task.tex_id];
+    if (texture.source == -1) return;
 
     const auto& image = model.images[texture.source];
 
     bool resize = false;
     VkFormat format;
-    if (srgb) {
+    if (task.srgb) {
         format = VK_FORMAT_R8G8B8A8_SRGB;
         assert(image.component == 4);
         assert(image.bits == 8);
@@ -151,8 +176,14 @@ engine::Textures::gid parse_texture(const std::string& tex_name, const tinygltf:
         const auto& gltf_sampler = model.samplers[texture.sampler];
 
         switch (gltf_sampler.minFilter) {
-            case TINYGLTF_TEXTURE_FILTER_LINEAR: sampler.min_filter(engine::FilterMode::Linear); break;
-            case TINYGLTF_TEXTURE_FILTER_NEAREST: sampler.min_filter(engine::FilterMode::Nearest); break;
+            case TINYGLTF_TEXTURE_FILTER_LINEAR:
+                sampler.min_filter(engine::FilterMode::Linear);
+                sampler.lod(0.0f, 0.0f, 0.0f);
+                break;
+            case TINYGLTF_TEXTURE_FILTER_NEAREST:
+                sampler.min_filter(engine::FilterMode::Nearest);
+                sampler.lod(0.0f, 0.0f, 0.0f);
+                break;
             case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_LINEAR:
                 sampler.min_filter(engine::FilterMode::Linear);
                 sampler.mipmap(engine::MipMapMode::Linear);
@@ -187,41 +218,60 @@ engine::Textures::gid parse_texture(const std::string& tex_name, const tinygltf:
         }
     }
 
-    uint32_t image_size = resize ? 4 * image.bits / 8 * image.width * image.height : image.image.size();
-    void* image_data = malloc(image_size);
+    // the decoded image is only read, so it's handed over as is unless it has to be widened
+    std::span<uint8_t> texels{(uint8_t*)image.image.data(), image.image.size()};
+    std::vector<uint8_t> widened{};
     if (resize) {
-        auto orig_chunk = image.component * image.bits / 8;
-        auto new_chunk = 4 * image.bits / 8;
-        for (std::size_t i = 0; i < image.width * image.height; i++) {
-            std::memcpy((uint8_t*)image_data + i * new_chunk, image.image.data() + i * orig_chunk, orig_chunk);
-            std::memset((uint8_t*)image_data + i * new_chunk + orig_chunk, 0, new_chunk - orig_chunk);
-        }
-    } else {
-        std::memcpy(image_data, image.image.data(), image_size);
+        widened.resize(4 * image.bits / 8 * image.width * image.height);
+        expand_rgb(texels, widened.data(), image.bits / 8);
+        texels = widened;
+    }
+
+    task.gid = add_texture(texels, image.width, image.height, format, task.name, sampler);
+}
+
+// queues `tex_id` under `name` unless an earlier primitive already did
+void queue_texture(Handled& handled, int tex_id, bool srgb, std::string name) {
+    if (tex_id == -1) return;
+    for (const auto& task : handled.textures) {
+        if (task.tex_id == tex_id) return;
     }
 
-    auto tgid = game_textures->add({(uint8_t*)image_data, image_size}, image.width, image.height, format, tex_name, sampler);
-    handled.textures.emplace_back(tex_id, tgid);
-    return tgid;
+    handled.textures.emplace_back(TextureTask{
+        .tex_id = tex_id,
+        .srgb = srgb,
+        .name = std::move(name),
+    });
+}
+
+engine::Textures::gid texture_gid(const Handled& handled, int tex_id) {
+    for (const auto& task : handled.textures) {
+        if (task.tex_id == tex_id) return task.gid;
+    }
+
+    return {0, 0};
+}
+
+void queue_material_textures(Handled& handled, const std::string& prim_name, const tinygltf::Material& material) {
+    queue_texture(handled, material.pbrMetallicRoughness.baseColorTexture.index, true, prim_name + ": Albedo");
+    queue_texture(handled, material.pbrMetallicRoughness.metallicRoughnessTexture.index, false,
+                  prim_name + ": Metallic Roughness");
+    queue_texture(handled, material.normalTexture.index, false, prim_name + ": Normal");
+    queue_texture(handled, material.occlusionTexture.index, false, prim_name + ": Occlusion");
+    queue_texture(handled, material.emissiveTexture.index, true, prim_name + ": Emissive");
 }
 
 void parse_material(engine::models::gid mgid, const std::string& prim_name, engine::Mesh* out,
-                    const tinygltf::Model& model, const tinygltf::Material& material, Handled& handled) {
+                    const tinygltf::Material& material, const Handled& handled) {
     auto schema_size = state::materials->get_schema(0)->total_size;
     uint8_t* material_data = (uint8_t*)malloc(schema_size);
 
     engine::material::pbr::Data pbr_data{
-        .albedo_map = parse_texture(prim_name + ": Albedo", model,
-                                    material.pbrMetallicRoughness.baseColorTexture.index, true, handled),
-        .metallic_roughness_map =
-            parse_texture(prim_name + ": Metallic Roughness", model,
-                          material.pbrMetallicRoughness.metallicRoughnessTexture.index, false, handled),
-        .normal_map =
-            parse_texture(prim_name + ": Normal", model, material.normalTexture.index, false, handled),
-        .occlusion_map =
-            parse_texture(prim_name + ": Occlusion", model, material.occlusionTexture.index, false, handled),
-        .emissive_map =
-            parse_texture(prim_name + ": Emissive", model, material.emissiveTexture.index, true, handled),
+        .albedo_map = texture_gid(handled, material.pbrMetallicRoughness.baseColorTexture.index),
+        .metallic_roughness_map = texture_gid(handled, material.pbrMetallicRoughness.metallicRoughnessTexture.index),
+        .normal_map = texture_gid(handled, material.normalTexture.index),
+        .occlusion_map = texture_gid(handled, material.occlusionTexture.index),
+        .emissive_map = texture_gid(handled, material.emissiveTexture.index),
 
         .albedo_texcoord = (uint32_t)material.pbrMetallicRoughness.baseColorTexture.texCoord,
         .metallic_roughness_texcoord = (uint32_t)material.pbrMetallicRoughness.metallicRoughnessTexture.texCoord,
@@ -252,9 +302,65 @@ void parse_material(engine::models::gid mgid, const std::string& prim_name, engi
     free(material_data);
 }
 
-gltf::Err parse_primitive(engine::models::gid mgid, const std::string& prim_name, engine::Mesh* out,
-                          const tinygltf::Model& model, const tinygltf::Primitive& primitive,
-                          engine::collisions::AABB& model_aabb, Handled& handled) {
+// XXH3 of the primitive's topology, material and the bytes of every attribute it reads. primitives of different
+// glTF meshes with the same hash end up as one mesh, nullopt for sparse accessors which are never shared
+std::optional<uint64_t> hash_primitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive) {
+    auto* state = XXH3_createState();
+    XXH3_64bits_reset(state);
+    XXH3_64bits_update(state, &primitive.mode, sizeof(int));
+    XXH3_64bits_update(state, &primitive.material, sizeof(int));
+
+    auto hash_accessor = [&](int accessor_id) {
+        uint8_t present = accessor_id != -1;
+        XXH3_64bits_update(state, &present, sizeof(uint8_t));
+        if (!present) return true;
+
+        const auto& accessor = model.accessors[(uint64_t)accessor_id];
+        if (accessor.sparse.isSparse || accessor.bufferView == -1) return false;
+
+        XXH3_64bits_update(state, &accessor.componentType, sizeof(int));
+        XXH3_64bits_update(state, &accessor.type, sizeof(int));
+        XXH3_64bits_update(state, &accessor.normalized, sizeof(bool));
+        XXH3_64bits_update(state, &accessor.count, sizeof(std::size_t));
+
+        const auto& buffer_view = model.bufferViews[(uint64_t)accessor.bufferView];
+        const auto* cursor =
+            model.buffers[(uint64_t)buffer_view.buffer].data.data() + buffer_view.byteOffset + accessor.byteOffset;
+
+        uint32_t element_size = get_type_size(accessor.type) * get_component_type_size(accessor.componentType);
+        uint32_t stride = buffer_view.byteStride == 0 ? element_size : (uint32_t)buffer_view.byteStride;
+        if (stride == element_size) {
+            XXH3_64bits_update(state, cursor, element_size * accessor.count);
+        } else {
+            for (std::size_t i = 0; i < accessor.count; i++) {
+                XXH3_64bits_update(state, cursor + i * stride, element_size);
+            }
+        }
+
+        return true;
+    };
+
+    auto attribute = [&](const std::string& name) {
+        auto it = primitive.attributes.find(name);
+        return it == primitive.attributes.end() ? -1 : it->second;
+    };
+
+    bool hashed = hash_accessor(primitive.indices) && hash_accessor(attribute("POSITION")) &&
+                  hash_accessor(attribute("NORMAL")) && hash_accessor(attribute("TANGENT"));
+    for (std::size_t i = 0; hashed && i < std::tuple_size_v<decltype(engine::Mesh::texcoords)>; i++) {
+        hashed = hash_accessor(attribute(std::format("TEXCOORD_{}", i)));
+    }
+
+    auto hash = XXH3_64bits_digest(state);
+    XXH3_freeState(state);
+
+    if (!hashed) return std::nullopt;
+    return hash;
+}
+
+// fills in everything but the material, safe to run on several primitives at once
+gltf::Err parse_primitive(const std::string& prim_name, engine::Mesh* out, const tinygltf::Model& model,
+                          const tinygltf::Primitive& primitive) {
     auto it = primitive.attributes.find("POSITION");
     if (it == primitive.attributes.end()) return gltf::PositionAttributeMissing;
 
@@ -347,18 +453,29 @@ gltf::Err parse_primitive(engine::models::gid mgid, const std::string& prim_name
     };
 
     out->bounding_box = aabb;
-    model_aabb.extend(aabb);
 
-    assert(primitive.material >= 0 && "NOTE: if this asserts add default material creation");
-    parse_material(mgid, prim_name, out, model, model.materials[primitive.material], handled);
+    float acmr_before = 0.0f;
+    if (out->indices != nullptr) acmr_before = optimize::acmr({out->indices, out->index_count}, out->vertex_count);
+
+    lods::generate(*out);
+    meshlets::build(*out);
+    optimize::triangles(*out);
+    optimize::vertices(*out);
+    out->compact_vertices = out->can_compact_vertices();
+    out->short_indices = out->can_short_indices();
+
+    if (out->indices != nullptr && out->vertex_topology == engine::Topology::TriangleList) {
+        printf("%s: ACMR %.3f -> %.3f\n", prim_name.c_str(), acmr_before,
+               optimize::acmr({out->indices, out->index_count}, out->vertex_count));
+    }
 
     return gltf::Ok;
 }
 
-gltf::Err parse_node(engine::models::gid mgid, const tinygltf::Model& model, int node_id,
-                     std::vector<engine::Mesh>& meshes, std::vector<glm::mat4>& mesh_transforms,
-                     std::vector<uint32_t>& mesh_indices, glm::mat4 current_transform,
-                     engine::collisions::AABB& model_aabb, Handled& handled) {
+// only queues the primitives and textures it finds, `parse_model` runs them
+void parse_node(const tinygltf::Model& model, int node_id, std::vector<engine::Mesh>& meshes,
+                std::vector<glm::mat4>& mesh_transforms, std::vector<uint32_t>& mesh_indices,
+                glm::mat4 current_transform, Handled& handled) {
     auto& node = model.nodes[(uint64_t)node_id];
 
     glm::mat4 mat;
@@ -398,11 +515,29 @@ gltf::Err parse_node(engine::models::gid mgid, const tinygltf::Model& model, int
         auto& mesh = model.meshes[(uint64_t)node.mesh];
         std::vector<uint32_t> handled_meshes{};
         for (const auto& [i, primitive] : mesh.primitives | std::ranges::views::enumerate) {
+            auto hash = hash_primitive(model, primitive);
+            if (hash) {
+                auto shared = std::ranges::find(handled.geometry, *hash, &std::pair<uint64_t, uint32_t>::first);
+                if (shared != handled.geometry.end()) {
+                    mesh_indices.emplace_back(shared->second);
+                    mesh_transforms.emplace_back(mat);
+                    handled_meshes.emplace_back(shared->second);
+                    continue;
+                }
+            }
+
             meshes.emplace_back();
 
-            auto res = parse_primitive(mgid, i == 0 ? mesh.name : std::format("{} #{}", mesh.name, i),
-                                       &meshes.back(), model, primitive, model_aabb, handled);
-            if (res != gltf::Ok) return res;
+            auto& task = handled.primitives.emplace_back(PrimitiveTask{
+                .primitive = &primitive,
+                .name = i == 0 ? mesh.name : std::format("{} #{}", mesh.name, i),
+                .mesh_ix = (uint32_t)meshes.size() - 1,
+            });
+            if (primitive.material >= 0) {
+                queue_material_textures(handled, task.name, model.materials[primitive.material]);
+            }
+
+            if (hash) handled.geometry.emplace_back(*hash, (uint32_t)meshes.size() - 1);
 
             mesh_indices.emplace_back(meshes.size() - 1);
             mesh_transforms.emplace_back(mat);
@@ -413,12 +548,8 @@ gltf::Err parse_node(engine::models::gid mgid, const tinygltf::Model& model, int
 
 mesh_loaded:
     for (auto children_id : node.children) {
-        auto res =
-            parse_node(mgid, model, children_id, meshes, mesh_transforms, mesh_indices, mat, model_aabb, handled);
-        if (res != gltf::Ok) return res;
+        parse_node(model, children_id, meshes, mesh_transforms, mesh_indices, mat, handled);
     }
-
-    return gltf::Ok;
 }
 
 gltf::Err parse_model(engine::models::gid mgid, engine::Model* out, const tinygltf::Model& model) {
@@ -444,13 +575,53 @@ gltf::Err parse_model(engine::models::gid mgid, engine::Model* out, const tinygl
     for (auto node_id : scene.nodes) {
         if (node_id == -1) continue;
 
-        auto err = parse_node(mgid, model, node_id, meshes, mesh_transforms, mesh_indices,
-                              glm::identity<glm::mat4>(), model_aabb, handled);
-        if (err != gltf::Ok) return err;
+        parse_node(model, node_id, meshes, mesh_transforms, mesh_indices, glm::identity<glm::mat4>(), handled);
     }
     assert(mesh_indices.size() == mesh_transforms.size());
     assert(meshes.size() <= mesh_indices.size());
 
+    // every image and every primitive is a job of its own, a primitive's material waits for its geometry and
+    // textures. `meshes` and `handled` don't grow anymore, so the jobs can hold on to their elements
+    std::vector<engine::scheduler::job> jobs{};
+    for (auto& task : handled.textures) {
+        task.job = engine::scheduler::submit([&model, &task]() { parse_texture(model, task); });
+        jobs.emplace_back(task.job);
+    }
+
+    for (auto& task : handled.primitives) {
+        auto* mesh = &meshes[task.mesh_ix];
+        auto geometry = engine::scheduler::submit(
+            [&model, &task, mesh]() { task.err = parse_primitive(task.name, mesh, model, *task.primitive); });
+
+        std::vector<engine::scheduler::job> deps{geometry};
+        if (task.primitive->material >= 0) {
+            const auto& material = model.materials[task.primitive->material];
+            for (auto tex_id : {material.pbrMetallicRoughness.baseColorTexture.index,
+                                material.pbrMetallicRoughness.metallicRoughnessTexture.index,
+                                material.normalTexture.index, material.occlusionTexture.index,
+                                material.emissiveTexture.index}) {
+                for (const auto& texture : handled.textures) {
+                    if (texture.tex_id == tex_id) deps.emplace_back(texture.job);
+                }
+            }
+        }
+
+        jobs.emplace_back(engine::scheduler::submit(
+            [&model, &task, &handled, mesh, mgid]() {
+                if (task.err != gltf::Ok) return;
+
+                assert(task.primitive->material >= 0 && "NOTE: if this asserts add default material creation");
+                parse_material(mgid, task.name, mesh, model.materials[task.primitive->material], handled);
+            },
+            engine::scheduler::Priority::Normal, deps));
+    }
+    engine::scheduler::wait(jobs);
+
+    for (const auto& task : handled.primitives) {
+        if (task.err != gltf::Ok) return task.err;
+        model_aabb.extend(meshes[task.mesh_ix].bounding_box);
+    }
+
     out->mesh_count = (uint32_t)meshes.size();
     out->mesh_indices_count = (uint32_t)mesh_indices.size();
 
@@ -474,11 +645,89 @@ gltf::Err parse_model(engine::models::gid mgid, engine::Model* out, const tinygl
     return gltf::Ok;
 }
 
+// guards looking up a model's content and indexing it, so two identical imports running at once can't both miss
+static std::mutex content_mutex{};
+
+static bool is_live_model(engine::models::gid gid) {
+    return gid.id() < engine::models::get_names().size() &&
+           engine::models::get_generation(gid.id()) == gid.gen() && !engine::models::is_deleted(gid);
+}
+
+// drops a duplicate import, its material instances were only made for it
+static void drop_duplicate(engine::models::gid gid) {
+    auto [removed, _] = state::dependency_graph->deep_remove(gid);
+    for (const auto& asset : removed) {
+        if (const auto* material = std::get_if<engine::Materials::gid>(&asset)) {
+            state::materials->remove_instance(*material);
+        }
+    }
+
+    engine::models::remove(gid);
+}
+
 namespace gltf {
-    tinygltf::TinyGLTF loader{};
+    uint64_t content_hash(const engine::Model& model) {
+        auto* state = XXH3_createState();
+        XXH3_64bits_reset(state);
+
+        auto update = [&](const void* data, std::size_t size) {
+            if (data != nullptr && size != 0) XXH3_64bits_update(state, data, size);
+        };
+        auto update_value = [&](const auto& value) { update(&value, sizeof(value)); };
+
+        update(model.mesh_indexes, model.mesh_indices_count * sizeof(uint32_t));
+        update(model.mesh_transforms, model.mesh_indices_count * sizeof(glm::mat4));
+
+        for (const auto& mesh : std::span{model.meshes, model.mesh_count}) {
+            update_value(mesh.vertex_topology);
+            update_value(mesh.index_count);
+            update_value(mesh.vertex_count);
+            update_value(mesh.indexed_tangents);
+            update_value(mesh.compact_vertices);
+            update_value(mesh.short_indices);
+            update_value(mesh.bounding_box);
+
+            update(mesh.indices, mesh.index_count * sizeof(uint32_t));
+            update(mesh.positions, mesh.vertex_count * sizeof(glm::vec3));
+            update(mesh.normals, mesh.vertex_count * sizeof(glm::vec3));
+            update(mesh.tangents, (mesh.indexed_tangents ? mesh.vertex_count : mesh.index_count) * sizeof(glm::vec4));
+            for (auto* texcoords : mesh.texcoords) {
+                update(texcoords, mesh.vertex_count * sizeof(glm::vec2));
+            }
+
+            update_value(mesh.lod_count);
+            update(mesh.lods.data(), mesh.lod_count * sizeof(engine::model::MeshLod));
+            update(mesh.lod_indices, mesh.lod_index_count * sizeof(uint32_t));
+            update(mesh.meshlets, mesh.meshlet_count * sizeof(engine::model::Meshlet));
+
+            update_value(mesh.material_instance.dim());
+            if (auto data = state::materials->get_instance_data(mesh.material_instance); data) {
+                update(data->data(), data->size());
+            }
+        }
+
+        auto hash = XXH3_64bits_digest(state);
+        XXH3_freeState(state);
+        return hash;
+    }
+
+    std::optional<engine::models::gid> find_or_index(uint64_t hash, engine::models::gid gid,
+                                                     bool (*alive)(engine::models::gid)) {
+        std::lock_guard lock{content_mutex};
+
+        if (auto existing = state::dependency_graph->find_content(hash); existing) {
+            const auto* model = std::get_if<engine::models::gid>(&*existing);
+            if (model && *model != gid && alive(*model)) return *model;
+        }
+
+        state::dependency_graph->add_content(hash, gid);
+        return std::nullopt;
+    }
 
     Err load_json(engine::Model* out, std::span<uint8_t> data, const std::string& base_dir, engine::models::gid mgid,
                   std::string* tinygltf_error, std::string* tinygltf_warning) {
+        // the loader keeps per file state, one per call lets several imports run on the workers
+        tinygltf::TinyGLTF loader{};
         tinygltf::Model model;
 
         if (!loader.LoadASCIIFromString(&model, tinygltf_error, tinygltf_warning, (const char*)data.data(),
@@ -493,6 +742,7 @@ namespace gltf {
 
     Err load_bin(engine::Model* out, std::span<uint8_t> data, const std::string& base_dir, engine::models::gid mgid,
                  std::string* tinygltf_error, std::string* tinygltf_warning) {
+        tinygltf::TinyGLTF loader{};
         tinygltf::Model model;
 
         if (!loader.LoadBinaryFromMemory(&model, tinygltf_error, tinygltf_warning, data.data(), (uint32_t)data.size(),
@@ -563,6 +813,13 @@ namespace gltf {
 
                     if (engine::models::get_generation(gid.id()) != gid.gen()) goto cleanup;
 
+                    if (auto existing = find_or_index(content_hash(model), gid, is_live_model); existing) {
+                        printf("`%s` is identical to model %u, the import is dropped in favour of it\n",
+                               name.c_str(), existing->id());
+                        drop_duplicate(gid);
+                        goto cleanup;
+                    }
+
                     auto save_size = model.get_save_size();
                     uint8_t* save_data = (uint8_t*)malloc(save_size);
 
@@ -4,8 +4,6 @@
 #include "goliath/models.hpp"
 
 namespace gltf {
-    using ImageFn = const std::function<engine::Textures::gid(std::span<uint8_t>, int, int, VkFormat, const std::string&, engine::Sampler)>&;
-
     enum Err {
         Ok,
         TinyGLTFErr,
@@ -31,11 +29,25 @@ namespace gltf {
         std::string model_src_file;
     };
 
-    [[nodiscard]] Err load_json(engine::Model* out, std::span<uint8_t> data, const std::string& base_dir, ImageFn image_fn,
-                  std::string* tinygltf_error = nullptr, std::string* tinygltf_warning = nullptr);
+    // parses `data` into `out`, the materials and textures it uses are added for `mgid` on the way. several files
+    // can be loaded at once
+    [[nodiscard]] Err load_json(engine::Model* out, std::span<uint8_t> data, const std::string& base_dir,
+                                engine::models::gid mgid, std::string* tinygltf_error = nullptr,
+                                std::string* tinygltf_warning = nullptr);
 
-    [[nodiscard]] Err load_bin(engine::Model* out, std::span<uint8_t> data, const std::string& base_dir, ImageFn image_fn,
-                 std::string* tinygltf_error = nullptr, std::string* tinygltf_warning = nullptr);
+    [[nodiscard]] Err load_bin(engine::Model* out, std::span<uint8_t> data, const std::string& base_dir,
+                               engine::models::gid mgid, std::string* tinygltf_error = nullptr,
+                               std::string* tinygltf_warning = nullptr);
 
     engine::models::gid add_model(const std::filesystem::path& path, const std::string& name);
+
+    // XXH3 of everything `model` saves into its .gom. material instances count by their data instead of their gid,
+    // every import makes instances of its own
+    uint64_t content_hash(const engine::Model& model);
+
+    // the model already indexed under `hash` if `alive` still accepts it, otherwise `gid` becomes the indexed one and
+    // std::nullopt is returned. only whole models are shared this way, a mesh two different models have in common is
+    // still stored in both .gom files
+    std::optional<engine::models::gid> find_or_index(uint64_t hash, engine::models::gid gid,
+                                                     bool (*alive)(engine::models::gid));
 }
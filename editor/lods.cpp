@@ -0,0 +1,321 @@
+#include "lods.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <glm/common.hpp>
+#include <glm/ext/vector_double3.hpp>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <unordered_map>
+
+namespace lods {
+    // meshes below this many indices aren't worth a lod chain
+    static constexpr uint32_t min_index_count = 3 * 64;
+    // a level has to drop at least this much of the one before to be kept
+    static constexpr float min_reduction = 0.15f;
+    // past this the simplified surface doesn't resemble the mesh anymore
+    static constexpr float max_lod_error = 0.1f;
+
+    // symmetric 4x4 matrix summing the squared distances to a set of planes, only the upper triangle is stored
+    struct Quadric {
+        std::array<double, 10> m{};
+
+        static Quadric from_plane(glm::dvec3 n, double d) {
+            return Quadric{{
+                n.x * n.x, n.x * n.y, n.x * n.z, n.x * d,
+                n.y * n.y, n.y * n.z, n.y * d,
+                n.z * n.z, n.z * d,
+                d * d,
+            }};
+        }
+
+        void add(const Quadric& other) {
+            for (std::size_t i = 0; i < m.size(); i++) {
+                m[i] += other.m[i];
+            }
+        }
+
+        double eval(glm::dvec3 p) const {
+            double r = m[0] * p.x * p.x + 2.0 * m[1] * p.x * p.y + 2.0 * m[2] * p.x * p.z + 2.0 * m[3] * p.x +
+                       m[4] * p.y * p.y + 2.0 * m[5] * p.y * p.z + 2.0 * m[6] * p.y + m[7] * p.z * p.z +
+                       2.0 * m[8] * p.z + m[9];
+            return std::max(r, 0.0);
+        }
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+
+    uint64_t edge_key(uint32_t a, uint32_t b) {
+        return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+    }
+
+    // vertices on an edge that doesn't have exactly two triangles can't move. that covers open borders, uv and
+    // normal seams, which are borders in index space, and non-manifold edges, so collapses never open cracks
+    std::vector<uint8_t> find_locked(std::span<const uint32_t> indices, uint32_t vertex_count) {
+        std::unordered_map<uint64_t, uint32_t> edge_counts{};
+        edge_counts.reserve(indices.size());
+        for (std::size_t i = 0; i < indices.size(); i += 3) {
+            for (std::size_t k = 0; k < 3; k++) {
+                edge_counts[edge_key(indices[i + k], indices[i + (k + 1) % 3])]++;
+            }
+        }
+
+        std::vector<uint8_t> locked(vertex_count, 0);
+        for (const auto& [key, count] : edge_counts) {
+            if (count == 2) continue;
+
+            locked[key >> 32] = 1;
+            locked[key & 0xFFFFFFFFu] = 1;
+        }
+
+        return locked;
+    }
+
+    // whether moving `from` onto `to` turns any of the triangles around `from` over
+    bool flips(std::span<const uint32_t> tris, std::span<const uint32_t> adjacent, std::span<const glm::dvec3> positions,
+               uint32_t from, uint32_t to) {
+        for (auto tri : adjacent) {
+            const uint32_t* t = &tris[tri * 3];
+            if (t[0] == to || t[1] == to || t[2] == to) continue;
+
+            std::array<glm::dvec3, 3> before{positions[t[0]], positions[t[1]], positions[t[2]]};
+            auto after = before;
+            for (std::size_t k = 0; k < 3; k++) {
+                if (t[k] == from) after[k] = positions[to];
+            }
+
+            auto n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+            auto n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+            if (glm::dot(n0, n1) <= 0.25 * glm::length(n0) * glm::length(n1)) return true;
+        }
+
+        return false;
+    }
+
+    // the surface stays manifold only if the vertices connected to both ends of the edge are the ones opposite it
+    bool keeps_manifold(std::span<const uint32_t> tris, std::span<const uint32_t> around_from,
+                        std::span<const uint32_t> around_to, uint32_t from, uint32_t to) {
+        std::vector<uint32_t> opposite{};
+        std::vector<uint32_t> from_ring{};
+        for (auto tri : around_from) {
+            const uint32_t* t = &tris[tri * 3];
+            bool on_edge = t[0] == to || t[1] == to || t[2] == to;
+
+            for (std::size_t k = 0; k < 3; k++) {
+                if (t[k] == from || t[k] == to) continue;
+
+                from_ring.emplace_back(t[k]);
+                if (on_edge) opposite.emplace_back(t[k]);
+            }
+        }
+
+        for (auto tri : around_to) {
+            const uint32_t* t = &tris[tri * 3];
+            for (std::size_t k = 0; k < 3; k++) {
+                if (t[k] == from || t[k] == to) continue;
+                if (std::find(from_ring.begin(), from_ring.end(), t[k]) == from_ring.end()) continue;
+                if (std::find(opposite.begin(), opposite.end(), t[k]) == opposite.end()) return false;
+            }
+        }
+
+        return true;
+    }
+
+    float simplify(std::span<const uint32_t> indices, std::span<const glm::vec3> positions, uint32_t target_index_count,
+                   float max_error, std::vector<uint32_t>& out) {
+        auto vertex_count = (uint32_t)positions.size();
+        out.assign(indices.begin(), indices.end());
+        if (out.size() <= target_index_count || vertex_count == 0) return 0.0f;
+
+        // errors are measured on the mesh scaled to a unit box
+        glm::vec3 min = positions[0];
+        glm::vec3 max = positions[0];
+        for (auto p : positions) {
+            min = glm::min(min, p);
+            max = glm::max(max, p);
+        }
+        double extent = std::max({max.x - min.x, max.y - min.y, max.z - min.z});
+        double scale = extent > 0.0 ? 1.0 / extent : 1.0;
+
+        std::vector<glm::dvec3> scaled(vertex_count);
+        for (uint32_t v = 0; v < vertex_count; v++) {
+            scaled[v] = glm::dvec3{positions[v] - min} * scale;
+        }
+
+        std::vector<Quadric> quadrics(vertex_count);
+        for (std::size_t i = 0; i < out.size(); i += 3) {
+            auto p0 = scaled[out[i]];
+            auto n = glm::cross(scaled[out[i + 1]] - p0, scaled[out[i + 2]] - p0);
+            auto len = glm::length(n);
+            if (len == 0.0) continue;
+
+            n /= len;
+            auto q = Quadric::from_plane(n, -glm::dot(n, p0));
+            for (std::size_t k = 0; k < 3; k++) {
+                quadrics[out[i + k]].add(q);
+            }
+        }
+
+        auto locked = find_locked(indices, vertex_count);
+        double max_cost = (double)max_error * max_error;
+        double reached = 0.0;
+
+        std::vector<Collapse> collapses{};
+        std::vector<uint32_t> adjacency_offsets(vertex_count + 1);
+        std::vector<uint32_t> adjacency{};
+        std::vector<uint32_t> remap(vertex_count);
+        std::vector<uint8_t> touched(vertex_count);
+
+        // every pass collapses the cheapest edges whose neighbourhoods don't overlap, then drops the triangles that
+        // became degenerate
+        while (out.size() > target_index_count) {
+            auto tri_count = (uint32_t)(out.size() / 3);
+
+            std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+            for (auto v : out) {
+                adjacency_offsets[v + 1]++;
+            }
+            for (uint32_t v = 0; v < vertex_count; v++) {
+                adjacency_offsets[v + 1] += adjacency_offsets[v];
+            }
+            adjacency.resize(out.size());
+            {
+                auto cursor = adjacency_offsets;
+                for (uint32_t tri = 0; tri < tri_count; tri++) {
+                    for (std::size_t k = 0; k < 3; k++) {
+                        adjacency[cursor[out[tri * 3 + k]]++] = tri;
+                    }
+                }
+            }
+
+            // interior edges show up once per direction, only the one with the lower first vertex is taken
+            collapses.clear();
+            for (std::size_t i = 0; i < out.size(); i += 3) {
+                for (std::size_t k = 0; k < 3; k++) {
+                    auto a = out[i + k];
+                    auto b = out[i + (k + 1) % 3];
+                    if (a > b || (locked[a] && locked[b])) continue;
+
+                    auto q = quadrics[a];
+                    q.add(quadrics[b]);
+
+                    double a_to_b = locked[a] ? std::numeric_limits<double>::infinity() : q.eval(scaled[b]);
+                    double b_to_a = locked[b] ? std::numeric_limits<double>::infinity() : q.eval(scaled[a]);
+                    if (a_to_b <= b_to_a) collapses.emplace_back(a, b, a_to_b);
+                    else collapses.emplace_back(b, a, b_to_a);
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(),
+                      [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+            for (uint32_t v = 0; v < vertex_count; v++) {
+                remap[v] = v;
+            }
+            std::fill(touched.begin(), touched.end(), 0);
+
+            auto index_count = (uint32_t)out.size();
+            uint32_t applied = 0;
+            for (const auto& collapse : collapses) {
+                if (collapse.cost > max_cost || index_count <= target_index_count) break;
+                if (touched[collapse.from] || touched[collapse.to]) continue;
+
+                std::span<const uint32_t> around{adjacency.data() + adjacency_offsets[collapse.from],
+                                                 adjacency.data() + adjacency_offsets[collapse.from + 1]};
+                std::span<const uint32_t> around_to{adjacency.data() + adjacency_offsets[collapse.to],
+                                                    adjacency.data() + adjacency_offsets[collapse.to + 1]};
+                if (flips(out, around, scaled, collapse.from, collapse.to)) continue;
+                if (!keeps_manifold(out, around, around_to, collapse.from, collapse.to)) continue;
+
+                // the triangles around `from` stay untouched for the rest of the pass, so later flip checks still
+                // see them as they are in `out`
+                for (auto tri : around) {
+                    const uint32_t* t = &out[tri * 3];
+                    if (t[0] == collapse.to || t[1] == collapse.to || t[2] == collapse.to) index_count -= 3;
+
+                    for (std::size_t k = 0; k < 3; k++) {
+                        touched[t[k]] = 1;
+                    }
+                }
+
+                quadrics[collapse.to].add(quadrics[collapse.from]);
+                remap[collapse.from] = collapse.to;
+                reached = std::max(reached, collapse.cost);
+                applied++;
+            }
+
+            if (applied == 0) break;
+
+            std::size_t write = 0;
+            for (std::size_t i = 0; i < out.size(); i += 3) {
+                auto a = remap[out[i]];
+                auto b = remap[out[i + 1]];
+                auto c = remap[out[i + 2]];
+                if (a == b || b == c || a == c) continue;
+
+                out[write++] = a;
+                out[write++] = b;
+                out[write++] = c;
+            }
+            out.resize(write);
+        }
+
+        return (float)std::sqrt(reached);
+    }
+
+    void generate(engine::Mesh& mesh) {
+        free(mesh.lod_indices);
+        mesh.lod_indices = nullptr;
+        mesh.lod_index_count = 0;
+        mesh.lod_count = 0;
+        mesh.lods = {};
+
+        if (mesh.vertex_topology != engine::Topology::TriangleList || mesh.indices == nullptr ||
+            mesh.positions == nullptr || mesh.index_count < min_index_count) {
+            return;
+        }
+
+        std::span<const uint32_t> indices{mesh.indices, mesh.index_count};
+        std::span<const glm::vec3> positions{mesh.positions, mesh.vertex_count};
+
+        std::vector<uint32_t> lod_indices{};
+        std::vector<uint32_t> simplified{};
+        uint32_t previous_count = mesh.index_count;
+        float previous_error = 0.0f;
+
+        // every level starts from the full mesh so its error is measured against the original surface
+        for (uint32_t lod = 0; lod < engine::model::max_lod_count; lod++) {
+            auto target = (uint32_t)(mesh.index_count >> (lod + 1)) / 3 * 3;
+            if (target < 3) break;
+
+            auto error = simplify(indices, positions, target, max_lod_error, simplified);
+            if (simplified.empty() || (float)simplified.size() > (float)previous_count * (1.0f - min_reduction)) break;
+
+            // coarser levels never claim to be more accurate than finer ones, selection relies on it
+            error = std::max(error, previous_error);
+
+            mesh.lods[lod] = engine::model::MeshLod{
+                .first_index = mesh.index_count + (uint32_t)lod_indices.size(),
+                .index_count = (uint32_t)simplified.size(),
+                .error = error,
+            };
+            lod_indices.insert(lod_indices.end(), simplified.begin(), simplified.end());
+
+            previous_count = (uint32_t)simplified.size();
+            previous_error = error;
+            mesh.lod_count++;
+        }
+
+        if (lod_indices.empty()) return;
+
+        mesh.lod_index_count = (uint32_t)lod_indices.size();
+        mesh.lod_indices = (uint32_t*)malloc(lod_indices.size() * sizeof(uint32_t));
+        std::memcpy(mesh.lod_indices, lod_indices.data(), lod_indices.size() * sizeof(uint32_t));
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "goliath/model.hpp"
+
+#include <cstdint>
+#include <glm/ext/vector_float3.hpp>
+#include <span>
+#include <vector>
+
+namespace lods {
+    // collapses edges of the indexed triangle list until at most `target_index_count` indices are left or the next
+    // collapse would move the surface further than `max_error`, relative to the largest side of the mesh bounds.
+    // vertices are never moved or added, so the result indexes the same vertex arrays. returns the error reached
+    float simplify(std::span<const uint32_t> indices, std::span<const glm::vec3> positions, uint32_t target_index_count,
+                   float max_error, std::vector<uint32_t>& out);
+
+    // replaces the lod chain of `mesh` with up to `model::max_lod_count` levels, each targeting half the triangles of
+    // the one before. only indexed triangle lists get any
+    void generate(engine::Mesh& mesh);
+}
@@ -78,7 +78,8 @@ void update_depth(engine::GPUImage* images, VkImageView* image_views, uint32_t f
                                                   .height(engine::get_swapchain_extent().height)
                                                   .aspect_mask(VK_IMAGE_ASPECT_DEPTH_BIT)
                                                   .new_layout(VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL)
-                                                  .usage(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT),
+                                                  .usage(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                                         VK_IMAGE_USAGE_SAMPLED_BIT),
                                               VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT,
                                               VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
                                                   VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
@@ -120,6 +121,7 @@ void rebuild(engine::GPUImage* depth_images, VkImageView* depth_image_views, eng
     }
 
     update_depth(depth_images, depth_image_views, engine::frames_in_flight);
+    engine::culling::resize_hiz({engine::get_swapchain_extent().width, engine::get_swapchain_extent().height});
 
     update_target(target_images, target_image_views, engine::frames_in_flight);
 
@@ -149,6 +151,9 @@ struct PBRShadingSet {
 
 int main(int argc, char** argv) {
     EXVAR_INPUT(exvar_reg, "Editor/Camera/locked", bool, lock_cam, = true, engine::imgui_reflection::Input_ReadOnly);
+    EXVAR_INPUT(exvar_reg, "Editor/Culling/validate on cpu", bool, validate_culling, = false);
+    EXVAR_INPUT(exvar_reg, "Editor/Culling/occlusion", bool, occlusion_culling, = false);
+    EXVAR_SLIDER(exvar_reg, "Editor/Culling/lod pixel error", float, lod_pixel_error, = 1.0f, 0.0f, 16.0f);
 
     if (argc >= 2 && std::strcmp(argv[1], "init") == 0) {
         project::init(std::filesystem::current_path());
@@ -492,6 +497,7 @@ int main(int argc, char** argv) {
     engine::GPUImage* depth_images = (engine::GPUImage*)malloc(sizeof(engine::GPUImage) * engine::frames_in_flight);
     VkImageView* depth_image_views = (VkImageView*)malloc(sizeof(VkImageView) * engine::frames_in_flight);
     update_depth(depth_images, depth_image_views, engine::frames_in_flight);
+    engine::culling::resize_hiz({engine::get_swapchain_extent().width, engine::get_swapchain_extent().height});
 
     engine::GPUImage* target_images = (engine::GPUImage*)malloc(sizeof(engine::GPUImage) * engine::frames_in_flight);
     VkImageView* target_image_views = (VkImageView*)malloc(sizeof(VkImageView) * engine::frames_in_flight);
@@ -550,6 +556,17 @@ int main(int argc, char** argv) {
 
             if (ImGui::Begin("Editor Inspector", nullptr, ImGuiWindowFlags_HorizontalScrollbar)) {
                 exvar_reg.imgui_ui();
+
+                ImGui::SeparatorText("Culling");
+                auto cull_stats = engine::culling::get_stats();
+                ImGui::Text("Draws: %u, culled: %u, occluded: %u", cull_stats.tested, cull_stats.culled,
+                            cull_stats.occluded);
+                ImGui::Text("Clusters: %u, culled: %u", cull_stats.clusters, cull_stats.clusters_culled);
+                if (validate_culling) {
+                    auto reference =
+                        engine::culling::reference_cull(scene::selected_scene(), cam_info.cam.view_projection());
+                    ImGui::Text("CPU draws: %u, culled: %u", reference.tested, reference.culled);
+                }
             }
             ImGui::End();
 
@@ -621,8 +638,7 @@ int main(int argc, char** argv) {
                             std::size_t i = 0;
 
                             while (NFD_PathSet_EnumNext(&enumerator, &path) && path) {
-                                game_textures->add(path, std::filesystem::path{path}.stem().string(),
-                                                   engine::Sampler{});
+                                import_texture(path, std::filesystem::path{path}.stem().string(), engine::Sampler{});
                                 NFD_PathSet_FreePath(path);
                             }
 
@@ -836,17 +852,21 @@ int main(int argc, char** argv) {
             engine::visbuffer::clear_buffers(visbuffer, engine::get_current_frame());
 
             engine::rendering::mark("Editor: scene flatten");
-            engine::culling::bind_flatten();
-            tickets[0] =
-                engine::scenes::draw(scene::selected_scene(), [&](auto gid, auto transforms_addr, auto transform_ix) {
-                    auto _ = engine::culling::flatten(gid, transforms_addr, transform_ix * sizeof(glm::mat4));
-                });
+            tickets[0] = engine::culling::flatten_scene(scene::selected_scene());
 
             auto& draw_id_buffer = draw_id_buffers[engine::get_current_frame()];
             auto& indirect_draw_buffer = indirect_draw_buffers[engine::get_current_frame()];
 
+            auto lod_error = lod_pixel_error / (float)engine::get_swapchain_extent().height;
+
+            engine::culling::set_view(cam_info.cam.view_projection(), cam_info.cam.position, lod_error);
+
             engine::rendering::mark("Editor: scene culling");
-            engine::culling::cull(max_draw_size, draw_id_buffer.address(), indirect_draw_buffer.address());
+            if (occlusion_culling) {
+                engine::culling::cull_early(max_draw_size, draw_id_buffer.address(), indirect_draw_buffer.address());
+            } else {
+                engine::culling::cull(max_draw_size, draw_id_buffer.address(), indirect_draw_buffer.address());
+            }
 
             engine::synchronization::begin_barriers();
             engine::culling::sync_for_draw(draw_id_buffer, indirect_draw_buffer);
@@ -879,6 +899,45 @@ int main(int argc, char** argv) {
             });
             engine::rendering::end();
 
+            if (occlusion_culling) {
+                engine::rendering::mark("Editor: scene occlusion culling");
+                engine::culling::build_hiz(depth_images[engine::get_current_frame()].image,
+                                           depth_image_views[engine::get_current_frame()]);
+                engine::culling::cull_late(max_draw_size, draw_id_buffer);
+
+                engine::synchronization::begin_barriers();
+                engine::culling::sync_late_for_draw();
+                engine::synchronization::end_barriers();
+
+                engine::visbuffer::prepare_for_draw(visbuffer, engine::get_current_frame());
+
+                engine::rendering::mark("Editor: scene visbuffer late raster");
+                engine::rendering::begin(
+                    engine::RenderPass{}
+                        .add_color_attachment(visbuffer.attach(engine::get_current_frame(), engine::LoadOp::Load))
+                        .depth_attachment(engine::RenderingAttachement{}
+                                              .set_image(depth_image_views[engine::get_current_frame()],
+                                                         VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL)
+                                              .set_load_op(engine::LoadOp::Load)
+                                              .set_store_op(engine::StoreOp::Store)));
+
+                auto& late_draws = engine::culling::late_draws();
+                VisbufferRasterPC::write(visbuffer_raster_pc, draw_id_buffer.address(),
+                                         late_draws.address() + engine::culling::late_draws_offset,
+                                         cam_info.cam.view_projection());
+
+                visbuffer_raster_pipeline.bind();
+                visbuffer_raster_pipeline.draw_indirect_count(engine::GraphicsPipeline::DrawIndirectCountParams{
+                    .push_constant = visbuffer_raster_pc,
+                    .draw_buffer = late_draws.data(),
+                    .draw_offset = engine::culling::late_draws_offset,
+                    .count_buffer = late_draws.data(),
+                    .max_draw_count = max_draw_size,
+                    .stride = sizeof(engine::culling::CulledDrawCommand),
+                });
+                engine::rendering::end();
+            }
+
             engine::rendering::mark("Editor: visbuffer material post processing");
             engine::visbuffer::count_materials(visbuffer, draw_id_buffer.address(), engine::get_current_frame());
             engine::visbuffer::get_offsets(visbuffer, engine::get_current_frame());
@@ -0,0 +1,229 @@
+#include "meshlets.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace meshlets {
+    using engine::model::meshlet_max_triangles;
+    using engine::model::meshlet_max_vertices;
+
+    // below this many full meshlets the per draw culling is about as good
+    static constexpr uint32_t min_meshlet_count = 8;
+    // cones wider than this barely ever face away from the camera as a whole, they're marked as not cullable
+    static constexpr float min_cone_dot = 0.1f;
+
+    engine::model::Meshlet bounds(std::span<const uint32_t> indices, std::span<const uint32_t> vertices,
+                                  const glm::vec3* positions) {
+        auto min = glm::vec3{std::numeric_limits<float>::max()};
+        auto max = glm::vec3{std::numeric_limits<float>::lowest()};
+        for (auto v : vertices) {
+            min = glm::min(min, positions[v]);
+            max = glm::max(max, positions[v]);
+        }
+
+        auto center = (min + max) * 0.5f;
+        float radius = 0.0f;
+        for (auto v : vertices) {
+            radius = std::max(radius, glm::distance(center, positions[v]));
+        }
+
+        std::vector<glm::vec3> normals{};
+        normals.reserve(indices.size() / 3);
+        auto axis = glm::vec3{0.0f};
+        for (std::size_t i = 0; i < indices.size(); i += 3) {
+            auto a = positions[indices[i]];
+            auto n = glm::cross(positions[indices[i + 1]] - a, positions[indices[i + 2]] - a);
+            auto length = glm::length(n);
+            if (length <= 0.0f) continue;
+
+            normals.emplace_back(n / length);
+            axis += normals.back();
+        }
+
+        float cutoff = 1.0f;
+        auto axis_length = glm::length(axis);
+        if (axis_length > 0.0f) {
+            axis /= axis_length;
+
+            float min_dot = 1.0f;
+            for (auto n : normals) {
+                min_dot = std::min(min_dot, glm::dot(axis, n));
+            }
+
+            // the sine of the spread turns into the cosine of the widest view angle every triangle faces away from
+            if (min_dot > min_cone_dot) cutoff = std::sqrt(1.0f - min_dot * min_dot);
+        }
+
+        return engine::model::Meshlet{
+            .center = center,
+            .radius = radius,
+            .cone_axis = axis,
+            .cone_cutoff = cutoff,
+        };
+    }
+
+    void build(engine::Mesh& mesh) {
+        free(mesh.meshlets);
+        mesh.meshlets = nullptr;
+        mesh.meshlet_count = 0;
+
+        if (mesh.vertex_topology != engine::Topology::TriangleList || mesh.indices == nullptr ||
+            mesh.positions == nullptr || mesh.index_count < 3 * meshlet_max_triangles * min_meshlet_count) {
+            return;
+        }
+
+        uint32_t triangle_count = mesh.index_count / 3;
+        const auto* indices = mesh.indices;
+        const auto* positions = mesh.positions;
+
+        // triangles around every vertex
+        std::vector<uint32_t> adjacency_offsets(mesh.vertex_count + 1, 0);
+        for (uint32_t i = 0; i < triangle_count * 3; i++) {
+            adjacency_offsets[indices[i] + 1]++;
+        }
+        for (uint32_t v = 0; v < mesh.vertex_count; v++) {
+            adjacency_offsets[v + 1] += adjacency_offsets[v];
+        }
+
+        std::vector<uint32_t> adjacency(triangle_count * 3);
+        {
+            std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+            for (uint32_t i = 0; i < triangle_count * 3; i++) {
+                adjacency[fill[indices[i]]++] = i / 3;
+            }
+        }
+
+        auto triangle_center = [&](uint32_t t) {
+            return (positions[indices[t * 3]] + positions[indices[t * 3 + 1]] + positions[indices[t * 3 + 2]]) /
+                   3.0f;
+        };
+
+        std::vector<bool> emitted(triangle_count, false);
+        // meshlet number + 1 of the meshlet a vertex was last added to
+        std::vector<uint32_t> vertex_meshlet(mesh.vertex_count, 0);
+
+        std::vector<uint32_t> order{};
+        order.reserve(triangle_count);
+        std::vector<engine::model::Meshlet> meshlets{};
+
+        std::vector<uint32_t> candidates{};
+        std::vector<uint32_t> vertices{};
+        uint32_t next_seed = 0;
+
+        while (order.size() < triangle_count) {
+            auto stamp = (uint32_t)meshlets.size() + 1;
+            auto first_triangle = (uint32_t)order.size();
+            auto center_sum = glm::vec3{0.0f};
+
+            candidates.clear();
+            vertices.clear();
+
+            auto new_vertex_count = [&](uint32_t t) {
+                uint32_t count = 0;
+                for (uint32_t c = 0; c < 3; c++) {
+                    count += vertex_meshlet[indices[t * 3 + c]] != stamp;
+                }
+                return count;
+            };
+
+            while (true) {
+                // the triangle adding the fewest vertices, ties go to the one closest to the meshlet
+                auto best = std::numeric_limits<uint32_t>::max();
+                uint32_t best_new = 4;
+                float best_distance = std::numeric_limits<float>::max();
+
+                auto center = vertices.empty() ? glm::vec3{0.0f} : center_sum / (float)vertices.size();
+                for (std::size_t c = 0; c < candidates.size();) {
+                    auto t = candidates[c];
+                    if (emitted[t]) {
+                        candidates[c] = candidates.back();
+                        candidates.pop_back();
+                        continue;
+                    }
+
+                    auto new_count = new_vertex_count(t);
+                    auto distance = glm::distance(center, triangle_center(t));
+                    if (new_count < best_new || (new_count == best_new && distance < best_distance)) {
+                        best = t;
+                        best_new = new_count;
+                        best_distance = distance;
+                    }
+                    c++;
+                }
+
+                // nothing connected is left, carry on with the next triangle in index order
+                if (best == std::numeric_limits<uint32_t>::max()) {
+                    while (next_seed < triangle_count && emitted[next_seed]) next_seed++;
+                    if (next_seed == triangle_count) break;
+
+                    best = next_seed;
+                    best_new = new_vertex_count(best);
+                }
+
+                if (vertices.size() + best_new > meshlet_max_vertices ||
+                    order.size() - first_triangle + 1 > meshlet_max_triangles) {
+                    break;
+                }
+
+                emitted[best] = true;
+                order.emplace_back(best);
+
+                for (uint32_t c = 0; c < 3; c++) {
+                    auto v = indices[best * 3 + c];
+                    if (vertex_meshlet[v] == stamp) continue;
+
+                    vertex_meshlet[v] = stamp;
+                    vertices.emplace_back(v);
+                    center_sum += positions[v];
+
+                    for (auto a = adjacency_offsets[v]; a < adjacency_offsets[v + 1]; a++) {
+                        if (!emitted[adjacency[a]]) candidates.emplace_back(adjacency[a]);
+                    }
+                }
+            }
+
+            auto meshlet_triangles = (uint32_t)order.size() - first_triangle;
+            std::vector<uint32_t> meshlet_indices{};
+            meshlet_indices.reserve(meshlet_triangles * 3);
+            for (auto t = first_triangle; t < order.size(); t++) {
+                for (uint32_t c = 0; c < 3; c++) {
+                    meshlet_indices.emplace_back(indices[order[t] * 3 + c]);
+                }
+            }
+
+            auto meshlet = bounds(meshlet_indices, vertices, positions);
+            meshlet.first_index = first_triangle * 3;
+            meshlet.triangle_count = meshlet_triangles;
+            meshlet.vertex_count = (uint32_t)vertices.size();
+            meshlets.emplace_back(meshlet);
+        }
+
+        std::vector<uint32_t> reordered(mesh.index_count);
+        for (uint32_t t = 0; t < triangle_count; t++) {
+            std::memcpy(&reordered[t * 3], &indices[order[t] * 3], 3 * sizeof(uint32_t));
+        }
+        // a trailing partial triangle isn't drawn anyway, it stays at the end
+        for (auto i = triangle_count * 3; i < mesh.index_count; i++) {
+            reordered[i] = indices[i];
+        }
+        std::memcpy(mesh.indices, reordered.data(), reordered.size() * sizeof(uint32_t));
+
+        if (!mesh.indexed_tangents && mesh.tangents != nullptr) {
+            std::vector<glm::vec4> tangents(mesh.tangents, mesh.tangents + mesh.index_count);
+            for (uint32_t t = 0; t < triangle_count; t++) {
+                std::memcpy(&mesh.tangents[t * 3], &tangents[order[t] * 3], 3 * sizeof(glm::vec4));
+            }
+        }
+
+        mesh.meshlet_count = (uint32_t)meshlets.size();
+        mesh.meshlets = (engine::model::Meshlet*)malloc(meshlets.size() * sizeof(engine::model::Meshlet));
+        std::memcpy(mesh.meshlets, meshlets.data(), meshlets.size() * sizeof(engine::model::Meshlet));
+    }
+}
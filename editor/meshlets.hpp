@@ -0,0 +1,10 @@
+#pragma once
+
+#include "goliath/model.hpp"
+
+namespace meshlets {
+    // reorders the triangles of the full mesh so every `model::Meshlet` is a contiguous index range and fills in the
+    // meshlets with their bounds. per index tangents are reordered along. lods and vertices are left untouched, only
+    // indexed triangle lists above a few meshlets worth of triangles get any
+    void build(engine::Mesh& mesh);
+}
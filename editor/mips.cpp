@@ -0,0 +1,94 @@
+#include "mips.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+
+namespace mips {
+    // .goi files and the texture loader don't go past this
+    static constexpr uint32_t max_levels = 16;
+
+    uint32_t channel_count(VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_R8_UNORM: return 1;
+            case VK_FORMAT_R8G8_UNORM: return 2;
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_SRGB: return 4;
+            default: return 0;
+        }
+    }
+
+    const std::array<float, 256>& srgb_to_linear() {
+        static const auto table = [] {
+            std::array<float, 256> table{};
+            for (uint32_t i = 0; i < 256; i++) {
+                float c = i / 255.0f;
+                table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return table;
+        }();
+
+        return table;
+    }
+
+    uint8_t linear_to_srgb(float c) {
+        c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+        return (uint8_t)std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f);
+    }
+
+    uint32_t level_count(uint32_t width, uint32_t height, VkFormat format) {
+        if (channel_count(format) == 0) return 1;
+        return std::min<uint32_t>(std::bit_width(std::max(width, height)), max_levels);
+    }
+
+    uint8_t* downsample(const uint8_t* texels, uint32_t width, uint32_t height, VkFormat format) {
+        uint32_t channels = channel_count(format);
+        assert(channels != 0 && "Unsupported source format");
+
+        const bool srgb = format == VK_FORMAT_R8G8B8A8_SRGB;
+        const auto& to_linear = srgb_to_linear();
+
+        uint32_t out_width = std::max(width / 2, 1u);
+        uint32_t out_height = std::max(height / 2, 1u);
+        auto* out = (uint8_t*)malloc((size_t)out_width * out_height * channels);
+
+        for (uint32_t y = 0; y < out_height; y++) {
+            uint32_t y0 = std::min(y * 2, height - 1);
+            uint32_t y1 = std::min(y * 2 + 1, height - 1);
+            for (uint32_t x = 0; x < out_width; x++) {
+                uint32_t x0 = std::min(x * 2, width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, width - 1);
+
+                const uint8_t* quad[4]{
+                    texels + ((size_t)y0 * width + x0) * channels,
+                    texels + ((size_t)y0 * width + x1) * channels,
+                    texels + ((size_t)y1 * width + x0) * channels,
+                    texels + ((size_t)y1 * width + x1) * channels,
+                };
+
+                uint8_t* dst = out + ((size_t)y * out_width + x) * channels;
+                for (uint32_t c = 0; c < channels; c++) {
+                    // alpha is linear even in srgb formats
+                    if (srgb && c < 3) {
+                        float sum = 0.0f;
+                        for (auto* texel : quad) {
+                            sum += to_linear[texel[c]];
+                        }
+                        dst[c] = linear_to_srgb(sum / 4.0f);
+                    } else {
+                        uint32_t sum = 0;
+                        for (auto* texel : quad) {
+                            sum += texel[c];
+                        }
+                        dst[c] = (uint8_t)((sum + 2) / 4);
+                    }
+                }
+            }
+        }
+
+        return out;
+    }
+}
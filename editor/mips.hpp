@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <vulkan/vulkan_core.h>
+
+namespace mips {
+    // levels of a full chain down to 1x1, 1 for formats `downsample` doesn't understand
+    uint32_t level_count(uint32_t width, uint32_t height, VkFormat format);
+
+    // 2x2 box filter over tightly packed 8-bit `format` texels, srgb colour is filtered in linear space
+    // returns malloc'd `max(width / 2, 1)`x`max(height / 2, 1)` texels
+    uint8_t* downsample(const uint8_t* texels, uint32_t width, uint32_t height, VkFormat format);
+}
@@ -0,0 +1,349 @@
+#include "optimize.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <vector>
+
+namespace optimize {
+    // size of the FIFO the statistics simulate, close to what current hardware reuses
+    static constexpr uint32_t fifo_size = 16;
+    // LRU cache the triangle scoring models
+    static constexpr uint32_t cache_size = 32;
+    static constexpr uint32_t max_valence_score = 32;
+    // the overdraw sort may raise the ACMR of the cache optimized order by this much
+    static constexpr float overdraw_threshold = 1.05f;
+    // clusters are cut where the cache restarts anyway, but never below this many triangles
+    static constexpr uint32_t min_cluster_triangles = 16;
+
+    float acmr(std::span<const uint32_t> indices, uint32_t vertex_count) {
+        if (indices.size() < 3) return 0.0f;
+
+        // a vertex is cached while fewer than `fifo_size` misses happened since it was loaded
+        std::vector<uint32_t> loaded_at(vertex_count, 0);
+        uint32_t time = fifo_size + 1;
+        uint32_t misses = 0;
+        for (auto v : indices) {
+            if (time - loaded_at[v] > fifo_size) {
+                loaded_at[v] = time++;
+                misses++;
+            }
+        }
+
+        return (float)misses / (float)(indices.size() / 3);
+    }
+
+    // Forsyth's linear speed vertex cache optimization, returns the new triangle order
+    std::vector<uint32_t> cache_order(std::span<const uint32_t> indices, uint32_t vertex_count) {
+        auto triangle_count = (uint32_t)(indices.size() / 3);
+
+        // the last triangle's vertices score a bit lower so strips don't keep going the same way
+        std::array<float, cache_size> cache_scores{};
+        for (uint32_t i = 0; i < cache_size; i++) {
+            cache_scores[i] = i < 3 ? 0.75f : std::pow(1.0f - (float)(i - 3) / (float)(cache_size - 3), 1.5f);
+        }
+        // vertices with few triangles left get finished first so they don't turn into lone triangles later
+        std::array<float, max_valence_score> valence_scores{};
+        for (uint32_t i = 1; i < max_valence_score; i++) {
+            valence_scores[i] = 2.0f / std::sqrt((float)i);
+        }
+
+        std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+        for (uint32_t i = 0; i < triangle_count * 3; i++) {
+            adjacency_offsets[indices[i] + 1]++;
+        }
+        for (uint32_t v = 0; v < vertex_count; v++) {
+            adjacency_offsets[v + 1] += adjacency_offsets[v];
+        }
+
+        // the first `remaining[v]` triangles of every vertex are the ones not emitted yet
+        std::vector<uint32_t> adjacency(triangle_count * 3);
+        std::vector<uint32_t> remaining(vertex_count, 0);
+        for (uint32_t i = 0; i < triangle_count * 3; i++) {
+            auto v = indices[i];
+            adjacency[adjacency_offsets[v] + remaining[v]++] = i / 3;
+        }
+
+        std::vector<int32_t> cache_position(vertex_count, -1);
+        auto vertex_score = [&](uint32_t v) {
+            if (remaining[v] == 0) return -1.0f;
+
+            auto score = valence_scores[std::min(remaining[v], max_valence_score - 1)];
+            if (cache_position[v] >= 0) score += cache_scores[cache_position[v]];
+            return score;
+        };
+
+        std::vector<float> vertex_scores(vertex_count);
+        for (uint32_t v = 0; v < vertex_count; v++) {
+            vertex_scores[v] = vertex_score(v);
+        }
+
+        std::vector<float> triangle_scores(triangle_count);
+        for (uint32_t t = 0; t < triangle_count; t++) {
+            triangle_scores[t] = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] +
+                                 vertex_scores[indices[t * 3 + 2]];
+        }
+
+        std::vector<bool> emitted(triangle_count, false);
+        std::vector<uint32_t> order{};
+        order.reserve(triangle_count);
+
+        std::vector<uint32_t> cache{};
+        std::vector<uint32_t> next_cache{};
+        cache.reserve(cache_size + 3);
+        next_cache.reserve(cache_size + 3);
+
+        auto best = (uint32_t)(std::max_element(triangle_scores.begin(), triangle_scores.end()) -
+                               triangle_scores.begin());
+        uint32_t next_unemitted = 0;
+
+        while (order.size() < triangle_count) {
+            // nothing in the cache has triangles left, restart from the first one that isn't done
+            if (best == std::numeric_limits<uint32_t>::max()) {
+                while (emitted[next_unemitted]) next_unemitted++;
+                best = next_unemitted;
+            }
+
+            emitted[best] = true;
+            order.emplace_back(best);
+
+            next_cache.clear();
+            for (uint32_t c = 0; c < 3; c++) {
+                auto v = indices[best * 3 + c];
+                next_cache.emplace_back(v);
+
+                auto* live = &adjacency[adjacency_offsets[v]];
+                auto* it = std::find(live, live + remaining[v], best);
+                std::swap(*it, live[remaining[v] - 1]);
+                remaining[v]--;
+            }
+            for (auto v : cache) {
+                if (v != next_cache[0] && v != next_cache[1] && v != next_cache[2]) next_cache.emplace_back(v);
+            }
+
+            for (uint32_t i = 0; i < next_cache.size(); i++) {
+                auto v = next_cache[i];
+                cache_position[v] = i < cache_size ? (int32_t)i : -1;
+                vertex_scores[v] = vertex_score(v);
+            }
+
+            // every triangle that still touches a vertex whose score changed
+            best = std::numeric_limits<uint32_t>::max();
+            float best_score = -std::numeric_limits<float>::max();
+            for (auto v : next_cache) {
+                for (uint32_t a = 0; a < remaining[v]; a++) {
+                    auto t = adjacency[adjacency_offsets[v] + a];
+                    auto score = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] +
+                                 vertex_scores[indices[t * 3 + 2]];
+                    triangle_scores[t] = score;
+
+                    if (score > best_score) {
+                        best = t;
+                        best_score = score;
+                    }
+                }
+            }
+
+            if (next_cache.size() > cache_size) next_cache.resize(cache_size);
+            std::swap(cache, next_cache);
+        }
+
+        return order;
+    }
+
+    // splits `order` where the cache restarts and sorts the pieces so the ones on the outside of the mesh, facing
+    // away from its center, draw first
+    void overdraw_order(std::span<const uint32_t> indices, const glm::vec3* positions, uint32_t vertex_count,
+                        std::vector<uint32_t>& order) {
+        struct Cluster {
+            uint32_t begin;
+            uint32_t end;
+            glm::vec3 center{0.0f};
+            glm::vec3 normal{0.0f};
+            float key = 0.0f;
+        };
+
+        std::vector<Cluster> clusters{};
+        std::vector<uint32_t> loaded_at(vertex_count, 0);
+        uint32_t time = fifo_size + 1;
+        uint32_t begin = 0;
+        for (uint32_t i = 0; i < order.size(); i++) {
+            uint32_t misses = 0;
+            for (uint32_t c = 0; c < 3; c++) {
+                auto v = indices[order[i] * 3 + c];
+                if (time - loaded_at[v] > fifo_size) {
+                    loaded_at[v] = time++;
+                    misses++;
+                }
+            }
+
+            if (misses == 3 && i - begin >= min_cluster_triangles) {
+                clusters.emplace_back(Cluster{.begin = begin, .end = i});
+                begin = i;
+            }
+        }
+        clusters.emplace_back(Cluster{.begin = begin, .end = (uint32_t)order.size()});
+        if (clusters.size() < 2) return;
+
+        // area weighted, so slivers don't pull the centers around
+        auto mesh_center = glm::vec3{0.0f};
+        float mesh_area = 0.0f;
+        for (auto& cluster : clusters) {
+            float area = 0.0f;
+            for (auto i = cluster.begin; i < cluster.end; i++) {
+                auto a = positions[indices[order[i] * 3]];
+                auto b = positions[indices[order[i] * 3 + 1]];
+                auto c = positions[indices[order[i] * 3 + 2]];
+
+                auto n = glm::cross(b - a, c - a);
+                auto triangle_area = glm::length(n);
+                cluster.center += (a + b + c) * (triangle_area / 3.0f);
+                cluster.normal += n;
+                area += triangle_area;
+            }
+
+            mesh_center += cluster.center;
+            mesh_area += area;
+            if (area > 0.0f) cluster.center /= area;
+
+            auto normal_length = glm::length(cluster.normal);
+            if (normal_length > 0.0f) cluster.normal /= normal_length;
+        }
+        if (mesh_area <= 0.0f) return;
+        mesh_center /= mesh_area;
+
+        for (auto& cluster : clusters) {
+            cluster.key = glm::dot(cluster.center - mesh_center, cluster.normal);
+        }
+        std::stable_sort(clusters.begin(), clusters.end(),
+                         [](const Cluster& a, const Cluster& b) { return a.key > b.key; });
+
+        std::vector<uint32_t> sorted{};
+        sorted.reserve(order.size());
+        for (const auto& cluster : clusters) {
+            sorted.insert(sorted.end(), order.begin() + cluster.begin, order.begin() + cluster.end);
+        }
+        order = std::move(sorted);
+    }
+
+    // rewrites the per index `data` of every triangle in `order`
+    template <typename T> void permute_triangles(T* data, std::span<const uint32_t> order) {
+        std::vector<T> copy(data, data + order.size() * 3);
+        for (std::size_t t = 0; t < order.size(); t++) {
+            std::memcpy(&data[t * 3], &copy[order[t] * 3], 3 * sizeof(T));
+        }
+    }
+
+    std::vector<uint32_t> ordered(std::span<const uint32_t> indices, std::span<const uint32_t> order) {
+        std::vector<uint32_t> out(order.size() * 3);
+        for (std::size_t t = 0; t < order.size(); t++) {
+            std::memcpy(&out[t * 3], &indices[order[t] * 3], 3 * sizeof(uint32_t));
+        }
+        return out;
+    }
+
+    void triangles(engine::Mesh& mesh) {
+        if (mesh.vertex_topology != engine::Topology::TriangleList || mesh.indices == nullptr) return;
+
+        bool per_index_tangents = !mesh.indexed_tangents && mesh.tangents != nullptr;
+
+        // meshlets are drawn on their own in whatever order culling emits them, so only their insides get reordered.
+        // their vertices are numbered locally so every meshlet costs its own size and not the mesh's
+        constexpr auto unused = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> local_ids(mesh.meshlet_count != 0 ? mesh.vertex_count : 0, unused);
+        std::vector<uint32_t> local_indices{};
+        for (uint32_t i = 0; i < mesh.meshlet_count; i++) {
+            const auto& meshlet = mesh.meshlets[i];
+            auto* indices = mesh.indices + meshlet.first_index;
+
+            uint32_t local_count = 0;
+            local_indices.clear();
+            for (uint32_t j = 0; j < meshlet.triangle_count * 3; j++) {
+                auto& id = local_ids[indices[j]];
+                if (id == unused) id = local_count++;
+                local_indices.emplace_back(id);
+            }
+            for (uint32_t j = 0; j < meshlet.triangle_count * 3; j++) {
+                local_ids[indices[j]] = unused;
+            }
+
+            auto order = cache_order(local_indices, local_count);
+            permute_triangles(indices, order);
+            if (per_index_tangents) permute_triangles(mesh.tangents + meshlet.first_index, order);
+        }
+
+        if (mesh.meshlet_count == 0 && mesh.index_count >= 3) {
+            std::span<const uint32_t> indices{mesh.indices, mesh.index_count / 3 * 3};
+            auto order = cache_order(indices, mesh.vertex_count);
+
+            if (mesh.positions != nullptr) {
+                auto cache_acmr = acmr(ordered(indices, order), mesh.vertex_count);
+
+                auto sorted = order;
+                overdraw_order(indices, mesh.positions, mesh.vertex_count, sorted);
+                if (acmr(ordered(indices, sorted), mesh.vertex_count) <= cache_acmr * overdraw_threshold) {
+                    order = std::move(sorted);
+                }
+            }
+
+            permute_triangles(mesh.indices, order);
+            if (per_index_tangents) permute_triangles(mesh.tangents, order);
+        }
+
+        // lods are only ever drawn whole and far away, the cache order is enough
+        for (uint32_t lod = 0; lod < mesh.lod_count; lod++) {
+            const auto& mesh_lod = mesh.lods[lod];
+            auto* lod_indices = mesh.lod_indices + (mesh_lod.first_index - mesh.index_count);
+
+            auto order = cache_order({lod_indices, mesh_lod.index_count}, mesh.vertex_count);
+            permute_triangles(lod_indices, order);
+        }
+    }
+
+    void vertices(engine::Mesh& mesh) {
+        if (mesh.indices == nullptr || mesh.vertex_count == 0) return;
+
+        constexpr auto unused = std::numeric_limits<uint32_t>::max();
+        std::vector<uint32_t> remap(mesh.vertex_count, unused);
+        uint32_t next = 0;
+
+        auto assign = [&](uint32_t* indices, uint32_t count) {
+            for (uint32_t i = 0; i < count; i++) {
+                auto& to = remap[indices[i]];
+                if (to == unused) to = next++;
+            }
+        };
+        assign(mesh.indices, mesh.index_count);
+        assign(mesh.lod_indices, mesh.lod_index_count);
+        for (auto& to : remap) {
+            if (to == unused) to = next++;
+        }
+
+        auto rewrite = [&](uint32_t* indices, uint32_t count) {
+            for (uint32_t i = 0; i < count; i++) {
+                indices[i] = remap[indices[i]];
+            }
+        };
+        rewrite(mesh.indices, mesh.index_count);
+        rewrite(mesh.lod_indices, mesh.lod_index_count);
+
+        auto reorder = [&]<typename T>(T* data) {
+            if (data == nullptr) return;
+
+            std::vector<T> copy(data, data + mesh.vertex_count);
+            for (uint32_t v = 0; v < mesh.vertex_count; v++) {
+                data[remap[v]] = copy[v];
+            }
+        };
+        reorder(mesh.positions);
+        reorder(mesh.normals);
+        if (mesh.indexed_tangents) reorder(mesh.tangents);
+        for (auto* texcoord : mesh.texcoords) {
+            reorder(texcoord);
+        }
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "goliath/model.hpp"
+
+#include <cstdint>
+#include <span>
+
+namespace optimize {
+    // average cache misses per triangle of a simulated FIFO post transform cache, 0.5 is about the best a regular
+    // grid gets and 3 means no vertex is ever reused
+    float acmr(std::span<const uint32_t> indices, uint32_t vertex_count);
+
+    // reorders the triangles of the full mesh and every lod for the post transform cache, then sorts the clusters
+    // of the full mesh so outward facing ones on the hull draw first and hide what's behind them. the overdraw sort
+    // is dropped if it'd cost more than a few percent of the cache hits. meshes with meshlets keep them and only get
+    // the triangles inside every meshlet reordered. per index tangents are reordered along, only indexed triangle
+    // lists are touched
+    void triangles(engine::Mesh& mesh);
+
+    // renumbers the vertices in the order the indices first use them, so the vertex fetch walks memory forward.
+    // unreferenced vertices end up at the back
+    void vertices(engine::Mesh& mesh);
+}
@@ -1,3 +1,182 @@
 #include "textures.hpp"
+#include "bc.hpp"
+#include "goliath/texture.hpp"
+#include "goliath/transport2.hpp"
+#include "mips.hpp"
+#include "state.hpp"
+
+#include "xxhash.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 engine::Textures* game_textures;
+
+// `Textures::add` isn't safe to call from several threads, the importers run on the workers
+static std::mutex add_mutex{};
+
+uint64_t content_hash(const EncodedTexture& texture, const engine::Sampler& sampler) {
+    auto* state = XXH3_createState();
+    XXH3_64bits_reset(state);
+    XXH3_64bits_update(state, &texture.width, sizeof(uint32_t));
+    XXH3_64bits_update(state, &texture.height, sizeof(uint32_t));
+    XXH3_64bits_update(state, &texture.format, sizeof(VkFormat));
+    XXH3_64bits_update(state, &texture.mip_levels, sizeof(uint32_t));
+    XXH3_64bits_update(state, &sampler, sizeof(engine::Sampler));
+    XXH3_64bits_update(state, texture.payload.data(), texture.payload.size());
+
+    auto hash = XXH3_64bits_digest(state);
+    XXH3_freeState(state);
+    return hash;
+}
+
+static engine::Textures::gid add_to_game_textures(EncodedTexture& texture, std::string name,
+                                                  engine::Sampler sampler) {
+    auto hash = content_hash(texture, sampler);
+
+    std::lock_guard lock{add_mutex};
+    if (auto existing = state::dependency_graph->find_content(hash); existing) {
+        const auto* gid = std::get_if<engine::Textures::gid>(&*existing);
+        if (gid && gid->id() < game_textures->get_names().size() && !game_textures->is_deleted(*gid)) return *gid;
+    }
+
+    auto gid = game_textures->add(texture.payload, texture.width, texture.height, texture.format, std::move(name),
+                                  sampler, texture.mip_levels);
+    state::dependency_graph->add_content(hash, gid);
+    return gid;
+}
+
+TextureSink texture_sink = add_to_game_textures;
+
+EncodedTexture encode_texture(std::span<uint8_t> texels, uint32_t width, uint32_t height, VkFormat format) {
+    uint32_t level_count = mips::level_count(width, height, format);
+    auto block_format = bc::pick_format(format, texels);
+
+    // levels[0] is `texels` itself, the rest is malloc'd by `downsample`
+    std::vector<uint8_t*> levels{texels.data()};
+    for (uint32_t mip = 1; mip < level_count; mip++) {
+        levels.emplace_back(mips::downsample(levels.back(), std::max(width >> (mip - 1), 1u),
+                                             std::max(height >> (mip - 1), 1u), format));
+    }
+
+    // the .goi payload stores the smallest level first
+    std::vector<uint8_t> payload{};
+    for (uint32_t mip = level_count; mip-- > 0;) {
+        uint32_t level_width = std::max(width >> mip, 1u);
+        uint32_t level_height = std::max(height >> mip, 1u);
+        uint32_t texels_size = engine::transport2::image_size(format, level_width, level_height);
+
+        auto offset = payload.size();
+        if (block_format != format) {
+            payload.resize(offset + bc::encoded_size(level_width, level_height, block_format));
+            bc::encode({levels[mip], texels_size}, level_width, level_height, format, block_format,
+                       payload.data() + offset);
+        } else {
+            payload.resize(offset + texels_size);
+            std::memcpy(payload.data() + offset, levels[mip], texels_size);
+        }
+    }
+
+    for (uint32_t mip = 1; mip < level_count; mip++) {
+        free(levels[mip]);
+    }
+
+    return EncodedTexture{
+        .payload = std::move(payload),
+        .width = width,
+        .height = height,
+        .format = block_format,
+        .mip_levels = level_count,
+    };
+}
+
+engine::Textures::gid add_texture(std::span<uint8_t> texels, uint32_t width, uint32_t height, VkFormat format,
+                                  std::string name, engine::Sampler sampler) {
+    auto texture = encode_texture(texels, width, height, format);
+    return texture_sink(texture, std::move(name), sampler);
+}
+
+void expand_rgb(std::span<const uint8_t> rgb, uint8_t* rgba, uint32_t channel_size) {
+    std::size_t in_pixel = 3 * channel_size;
+    std::size_t out_pixel = 4 * channel_size;
+    std::size_t count = rgb.size() / in_pixel;
+    const auto* src = rgb.data();
+
+    std::size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    // every pixel of a 16 byte load moves up by its index times the channel size, the masks keep its 3 channels
+    // and zero the alpha. the loads read 4 bytes past the pixels they use, so the last few go through the scalar path
+    if (channel_size == 1) {
+        const auto m0 = _mm_setr_epi32(0x00FFFFFF, 0, 0, 0);
+        const auto m1 = _mm_setr_epi32(0, 0x00FFFFFF, 0, 0);
+        const auto m2 = _mm_setr_epi32(0, 0, 0x00FFFFFF, 0);
+        const auto m3 = _mm_setr_epi32(0, 0, 0, 0x00FFFFFF);
+        for (; i + 6 <= count; i += 4) {
+            auto v = _mm_loadu_si128((const __m128i*)(src + i * 3));
+            auto out = _mm_or_si128(_mm_or_si128(_mm_and_si128(v, m0), _mm_and_si128(_mm_slli_si128(v, 1), m1)),
+                                    _mm_or_si128(_mm_and_si128(_mm_slli_si128(v, 2), m2),
+                                                 _mm_and_si128(_mm_slli_si128(v, 3), m3)));
+            _mm_storeu_si128((__m128i*)(rgba + i * 4), out);
+        }
+    } else if (channel_size == 2) {
+        const auto m0 = _mm_setr_epi32(-1, 0x0000FFFF, 0, 0);
+        const auto m1 = _mm_setr_epi32(0, 0, -1, 0x0000FFFF);
+        for (; i + 3 <= count; i += 2) {
+            auto v = _mm_loadu_si128((const __m128i*)(src + i * 6));
+            auto out = _mm_or_si128(_mm_and_si128(v, m0), _mm_and_si128(_mm_slli_si128(v, 2), m1));
+            _mm_storeu_si128((__m128i*)(rgba + i * 8), out);
+        }
+    }
+#elif defined(__ARM_NEON)
+    if (channel_size == 1) {
+        for (; i + 16 <= count; i += 16) {
+            auto v = vld3q_u8(src + i * 3);
+            vst4q_u8(rgba + i * 4, uint8x16x4_t{{v.val[0], v.val[1], v.val[2], vdupq_n_u8(0)}});
+        }
+    } else if (channel_size == 2) {
+        for (; i + 8 <= count; i += 8) {
+            auto v = vld3q_u16((const uint16_t*)(src + i * 6));
+            vst4q_u16((uint16_t*)(rgba + i * 8), uint16x8x4_t{{v.val[0], v.val[1], v.val[2], vdupq_n_u16(0)}});
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        std::memcpy(rgba + i * out_pixel, src + i * in_pixel, in_pixel);
+        std::memset(rgba + i * out_pixel + in_pixel, 0, out_pixel - in_pixel);
+    }
+}
+
+std::optional<EncodedTexture> load_texture(const std::filesystem::path& path) {
+    auto img = engine::Image::load8(path.string().c_str());
+    if (img.components == 3) {
+        img.destroy();
+        img = engine::Image::load8(path.string().c_str(), 4);
+    }
+
+    if (img.data == nullptr) return std::nullopt;
+
+    auto texture = encode_texture({(uint8_t*)img.data, img.size}, img.width, img.height, img.format);
+    img.destroy();
+    return texture;
+}
+
+engine::Textures::gid import_texture(const std::filesystem::path& path, std::string name, engine::Sampler sampler) {
+    if (path.extension() == ".goi") {
+        std::lock_guard lock{add_mutex};
+        return game_textures->add(path, std::move(name), sampler);
+    }
+
+    auto texture = load_texture(path);
+    if (!texture) return engine::Textures::gid{0, 0};
+
+    return texture_sink(*texture, std::move(name), sampler);
+}
@@ -2,4 +2,42 @@
 
 #include "goliath/textures.hpp"
 
+#include <optional>
+#include <vector>
+
 extern engine::Textures* game_textures;
+
+// a .goi payload, every mip level smallest first
+struct EncodedTexture {
+    std::vector<uint8_t> payload;
+    uint32_t width;
+    uint32_t height;
+    VkFormat format;
+    uint32_t mip_levels;
+};
+
+// builds the full mip chain of tightly packed `format` texels, block compressed when the format allows
+EncodedTexture encode_texture(std::span<uint8_t> texels, uint32_t width, uint32_t height, VkFormat format);
+
+// XXH3 of everything that ends up in the .goi and the registry entry, the key into the dependency graph's content
+// index
+uint64_t content_hash(const EncodedTexture& texture, const engine::Sampler& sampler);
+
+// where `add_texture` hands the encoded texture off to, adds it to `game_textures` unless the cook swaps it out.
+// texels already in the project come back as the existing gid. called from the importers' workers
+using TextureSink = engine::Textures::gid (*)(EncodedTexture& texture, std::string name, engine::Sampler sampler);
+extern TextureSink texture_sink;
+
+// encodes tightly packed `format` texels and adds them through `texture_sink`
+engine::Textures::gid add_texture(std::span<uint8_t> texels, uint32_t width, uint32_t height, VkFormat format,
+                                  std::string name, engine::Sampler sampler);
+
+// widens tightly packed RGB texels with 1 or 2 byte channels to RGBA with a zero alpha, `rgba` has to fit
+// `rgb.size() / 3 * 4` bytes
+void expand_rgb(std::span<const uint8_t> rgb, uint8_t* rgba, uint32_t channel_size);
+
+// loads an image file on the calling thread and encodes it, nullopt if stb can't read it
+std::optional<EncodedTexture> load_texture(const std::filesystem::path& path);
+
+// loads an image file on the calling thread and adds it through `texture_sink`
+engine::Textures::gid import_texture(const std::filesystem::path& path, std::string name, engine::Sampler sampler);
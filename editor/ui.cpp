@@ -238,6 +238,9 @@ namespace ui {
                 }
 
                 if (changed) {
+                    if (scene::selected_instance() != -1) {
+                        engine::scenes::mark_transforms_dirty(scene::selected_scene(), scene::selected_instance(), 1);
+                    }
                     engine::scenes::update_buffers(scene::selected_scene());
                     update_instance_transform();
                 }
@@ -642,6 +645,7 @@ namespace ui {
 
             if (!value_changed) return;
 
+            engine::scenes::mark_transforms_dirty(scene::selected_scene(), scene::selected_instance(), 1);
             engine::scenes::update_buffers(scene::selected_scene());
             update_instance_transform();
         } else if (scene::selected_light() != -1) {
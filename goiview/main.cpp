@@ -13,25 +13,49 @@
 
 using namespace engine::game_interface2;
 
+// mirrors the .goi layout Textures writes, files without the magic are the old single level layout
 struct Metadata {
+    static constexpr uint32_t goi_magic = 0x32494F47; // "GOI2"
+
+    uint32_t magic = goi_magic;
+    uint32_t width;
+    uint32_t height;
+    VkFormat format;
+    uint32_t mip_levels = 1;
+};
+
+struct LegacyMetadata {
     uint32_t width;
     uint32_t height;
     VkFormat format;
 };
 
+// only reads the base level, it's stored last in the file
 std::pair<std::span<uint8_t>, Metadata> read_goi(std::filesystem::path path) {
-    std::ifstream file{path, std::ios::binary | std::ios::ate};
-    auto size_signed = file.tellg();
-    if (size_signed < 0) {
+    std::ifstream file{path, std::ios::binary};
+    if (!file) {
         assert(false && "texture somehow isn't on disk");
     }
 
     Metadata metadata{};
-    size_t image_size = (uint32_t)size_signed - sizeof(Metadata);
+    file.read((char*)&metadata, sizeof(uint32_t));
+    file.seekg(0, std::ios::beg);
+    if (metadata.magic == Metadata::goi_magic) {
+        file.read((char*)&metadata, sizeof(Metadata));
+    } else {
+        LegacyMetadata legacy{};
+        file.read((char*)&legacy, sizeof(LegacyMetadata));
+        metadata = Metadata{
+            .width = legacy.width,
+            .height = legacy.height,
+            .format = legacy.format,
+        };
+    }
+
+    size_t image_size = engine::transport2::image_size(metadata.format, metadata.width, metadata.height);
     uint8_t* image_data = (uint8_t*)malloc(image_size);
 
-    file.seekg(0, std::ios::beg);
-    file.read((char*)&metadata, sizeof(Metadata));
+    file.seekg(-(std::streamoff)image_size, std::ios::end);
     file.read((char*)image_data, image_size);
 
     return {{image_data, image_size}, metadata};
@@ -0,0 +1,48 @@
+#version 460
+
+#include "library/culling.glsl"
+
+#extension GL_EXT_buffer_reference_uvec2 : require
+#extension GL_KHR_shader_subgroup_ballot : require
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+
+layout(push_constant, std430) uniform Push {
+    CullView view;
+
+    CullTaskDatas task_datas;
+    CullTasks tasks;
+    Clusters clusters;
+
+    CulledDrawCmds indirect_draws;
+    DrawIDs draw_ids;
+
+    CullStats stats;
+
+    uint max_draw_count;
+};
+
+void main() {
+    uint gid = gl_GlobalInvocationID.x;
+    if (gid == 0) stats.clusters = clusters.size;
+    if (gid >= clusters.size) return;
+
+    uvec2 cluster = clusters.data[gid];
+    CullInput data = read_cull_input(task_datas, tasks, cluster.x);
+    Meshlet meshlet = read_meshlet(data.draw_id.group, data.meshlet_offset, cluster.y);
+
+    bool visible = is_meshlet_visible(view, data.transform, meshlet);
+
+    // one atomic per subgroup instead of one per culled cluster
+    uint culled = subgroupBallotBitCount(subgroupBallot(!visible));
+    if (subgroupElect() && culled != 0) atomicAdd(stats.clusters_culled, culled);
+
+    if (!visible) return;
+
+    uint slot = atomicAdd(draw_ids.current_size, 1);
+    if (slot >= max_draw_count) return;
+
+    write_draw_id(draw_ids, slot, data.draw_id);
+
+    write_culled_draw_cmd(indirect_draws, slot, CulledDrawCmd(meshlet.triangle_count * 3, 1, meshlet.first_index, 0, slot));
+}
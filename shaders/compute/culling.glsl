@@ -1,35 +1,78 @@
 #version 460
 
-#include "library/mesh_data.glsl"
-#include "library/culled_data.glsl"
+#include "library/culling.glsl"
 
 #extension GL_EXT_buffer_reference_uvec2 : require
+#extension GL_KHR_shader_subgroup_ballot : require
 
 layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
 
+const uint PHASE_FRUSTUM = 0;
+// only draws that were visible last frame, the rest is left to `culling_late`
+const uint PHASE_EARLY = 1;
+
 layout(push_constant, std430) uniform Push {
+    CullView view;
+
     CullTaskDatas task_datas;
     CullTasks tasks;
 
     CulledDrawCmds indirect_draws;
     DrawIDs draw_ids;
 
+    CullStats stats;
+    Visibility visibility;
+    Clusters clusters;
+
     uint max_draw_count;
+    uint max_visibility_id;
+    uint phase;
+    uint max_cluster_count;
 };
 
 void main() {
     uint gid = gl_GlobalInvocationID.x;
+    if (gid == 0 && phase == PHASE_FRUSTUM) stats.tested = tasks.task_count;
     if (gid >= tasks.task_count) return;
 
-    CullTask task = read_cull_task(tasks, gid);
-    CullTaskData task_data = read_cull_task_data(task_datas, task.data_id);
+    CullInput data = read_cull_input(task_datas, tasks, gid);
+
+    if (phase == PHASE_EARLY) {
+        uint id = data.task.visibility_id;
+        if (id >= max_visibility_id || visibility.data[id] == 0) return;
+    }
+
+    bool visible = is_visible(view.view_proj, data.transform, data.bb_min, data.bb_max);
+
+    if (phase == PHASE_FRUSTUM) {
+        // one atomic per subgroup instead of one per culled task
+        uint culled = subgroupBallotBitCount(subgroupBallot(!visible));
+        if (subgroupElect() && culled != 0) atomicAdd(stats.culled, culled);
+    }
+
+    if (!visible) return;
+
+    select_lod(data, view.view_proj, view.lod_error);
+
+    // the meshlets get culled one by one in `cluster_culling`, the whole draw is kept if they don't fit
+    if (can_split(data)) {
+        uint base = atomicAdd(clusters.count, data.meshlet_count);
+        uint end = base + data.meshlet_count;
+        if (end <= max_cluster_count) {
+            for (uint i = 0; i < data.meshlet_count; i++) {
+                clusters.data[base + i] = uvec2(gid, i);
+            }
+
+            atomicMax(clusters.size, end);
+            atomicMax(clusters.dispatch_x, (end + 31) / 32);
+            return;
+        }
+    }
 
     uint slot = atomicAdd(draw_ids.current_size, 1);
     if (slot >= max_draw_count) return;
 
-    VertexData verts = VertexData(task_data.verts);
-    uint mat_id = read_mesh_data(verts, task_data.verts_start_offset / 4).material_id;
-    write_draw_id(draw_ids, slot, DrawID(verts, task_data.verts_start_offset, mat_id, task_data.transforms, task.transform_offset));
+    write_draw_id(draw_ids, slot, data.draw_id);
 
-    write_culled_draw_cmd(indirect_draws, slot, CulledDrawCmd(task.vertex_count, 1, task.first_vertex, 0, slot));
+    write_culled_draw_cmd(indirect_draws, slot, CulledDrawCmd(data.task.vertex_count, 1, data.task.first_vertex, 0, slot));
 }
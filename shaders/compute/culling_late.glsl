@@ -0,0 +1,104 @@
+#version 460
+
+#include "library/culling.glsl"
+
+#extension GL_EXT_buffer_reference_uvec2 : require
+#extension GL_KHR_shader_subgroup_ballot : require
+
+layout(local_size_x = 32, local_size_y = 1, local_size_z = 1) in;
+
+// farthest depth of every texel, built from the depth the early phase left behind
+layout(set = 0, binding = 0) uniform sampler2D hiz;
+
+layout(buffer_reference, std430) buffer LateDraws {
+    uint count;
+    uint _pad[3];
+    uint data[];
+};
+
+layout(push_constant, std430) uniform Push {
+    CullView view;
+
+    CullTaskDatas task_datas;
+    CullTasks tasks;
+
+    LateDraws late_draws;
+    DrawIDs draw_ids;
+
+    CullStats stats;
+    Visibility visibility;
+
+    uint max_draw_count;
+    uint max_visibility_id;
+};
+
+bool is_occluded(mat4 transform, vec3 bb_min, vec3 bb_max) {
+    if (bb_min == bb_max) return false;
+
+    // crosses the camera plane, the projected bounds would be meaningless
+    vec3 ndc_min;
+    vec3 ndc_max;
+    if (!project_bounds(view.view_proj, transform, bb_min, bb_max, ndc_min, ndc_max)) return false;
+
+    vec2 uv_min = clamp(ndc_min.xy * 0.5 + 0.5, 0.0, 1.0);
+    vec2 uv_max = clamp(ndc_max.xy * 0.5 + 0.5, 0.0, 1.0);
+    float nearest = ndc_min.z;
+
+    // the level where the bounds cover at most 2x2 texels
+    vec2 size = (uv_max - uv_min) * vec2(textureSize(hiz, 0));
+    int level = clamp(int(ceil(log2(max(max(size.x, size.y), 1.0)))), 0, textureQueryLevels(hiz) - 1);
+
+    ivec2 level_size = textureSize(hiz, level);
+    ivec2 lo = clamp(ivec2(uv_min * vec2(level_size)), ivec2(0), level_size - 1);
+    ivec2 hi = clamp(ivec2(uv_max * vec2(level_size)), ivec2(0), level_size - 1);
+
+    float depth = max(max(texelFetch(hiz, lo, level).r, texelFetch(hiz, ivec2(hi.x, lo.y), level).r),
+                      max(texelFetch(hiz, ivec2(lo.x, hi.y), level).r, texelFetch(hiz, hi, level).r));
+
+    return nearest > depth;
+}
+
+void main() {
+    uint gid = gl_GlobalInvocationID.x;
+    if (gid == 0) stats.tested = tasks.task_count;
+    if (gid >= tasks.task_count) return;
+
+    CullInput data = read_cull_input(task_datas, tasks, gid);
+
+    uint id = data.task.visibility_id;
+    bool has_id = id < max_visibility_id;
+    bool drawn_early = has_id && visibility.data[id] != 0;
+
+    bool in_frustum = is_visible(view.view_proj, data.transform, data.bb_min, data.bb_max);
+    bool occluded = in_frustum && is_occluded(data.transform, data.bb_min, data.bb_max);
+    bool visible = in_frustum && !occluded;
+
+    if (has_id) visibility.data[id] = visible ? 1 : 0;
+
+    // one atomic per subgroup instead of one per culled task
+    uint culled = subgroupBallotBitCount(subgroupBallot(!visible));
+    uint occluded_count = subgroupBallotBitCount(subgroupBallot(occluded));
+    if (subgroupElect()) {
+        if (culled != 0) atomicAdd(stats.culled, culled);
+        if (occluded_count != 0) atomicAdd(stats.occluded, occluded_count);
+    }
+
+    // draws from the early phase stay drawn even if they turned out to be occluded
+    if (!visible || drawn_early) return;
+
+    // disoccluded draws aren't split into meshlets, they only show up for a frame before the early phase takes them
+    select_lod(data, view.view_proj, view.lod_error);
+
+    uint slot = atomicAdd(draw_ids.current_size, 1);
+    if (slot >= max_draw_count) return;
+
+    write_draw_id(draw_ids, slot, data.draw_id);
+
+    uint late_slot = atomicAdd(late_draws.count, 1);
+    uint start = late_slot * 5;
+    late_draws.data[start] = data.task.vertex_count;
+    late_draws.data[start + 1] = 1;
+    late_draws.data[start + 2] = data.task.first_vertex;
+    late_draws.data[start + 3] = 0;
+    late_draws.data[start + 4] = slot;
+}
@@ -65,7 +65,7 @@ void main() {
     write_cull_task_data(task_datas, task_data_slot, CullTaskData(uvec2(group), uvec2(transforms), draw_cmd.start_offset));
 
     for (uint i = 0; i < draw_cmd.instance_count; i++) {
-        write_cull_task(tasks, start_task_slot, CullTask(task_data_slot, draw_cmd.transform_offset == -1 ? transform_offset : draw_cmd.transform_offset, draw_cmd.vert_count, draw_cmd.first_vertex));
+        write_cull_task(tasks, start_task_slot, CullTask(task_data_slot, draw_cmd.transform_offset == -1 ? transform_offset : draw_cmd.transform_offset, draw_cmd.vert_count, draw_cmd.first_vertex, 0xFFFFFFFFu));
 
         start_task_slot++;
     }
@@ -0,0 +1,110 @@
+#version 460
+
+#include "library/mesh_data.glsl"
+#include "library/culled_data.glsl"
+
+#extension GL_EXT_buffer_reference_uvec2 : require
+
+layout (local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+struct IndirectDraw {
+    uint vert_count;
+    uint instance_count;
+    uint first_vertex;
+    uint first_instance;
+    uint start_offset;
+    uint transform_offset;
+};
+
+layout(buffer_reference, std430) readonly buffer IndirectDraws {
+    uint data[];
+};
+
+struct Instance {
+    VertexData group;
+    IndirectDraws indirect_draws;
+    uint draw_count;
+    uint transform_offset;
+    uint first_draw;
+};
+
+layout(buffer_reference, std430) readonly buffer Instances {
+    uint data[];
+};
+
+layout(buffer_reference, std430) readonly buffer Transforms {
+    mat4 transform[];
+};
+
+layout(push_constant, std430) uniform Push {
+    Instances instances;
+
+    CullTaskDatas task_datas;
+    CullTasks tasks;
+
+    Transforms transforms;
+    uint instance_count;
+    uint draw_count;
+
+    uint max_task_count;
+};
+
+Instance read_instance(uint ix) {
+    uint start = ix * 8;
+    Instance instance;
+
+    instance.group = VertexData(uvec2(instances.data[start], instances.data[start + 1]));
+    instance.indirect_draws = IndirectDraws(uvec2(instances.data[start + 2], instances.data[start + 3]));
+    instance.draw_count = instances.data[start + 4];
+    instance.transform_offset = instances.data[start + 5];
+    instance.first_draw = instances.data[start + 6];
+
+    return instance;
+}
+
+// last instance whose first draw is at or before `draw`
+uint find_instance(uint draw) {
+    uint lo = 0;
+    uint hi = instance_count;
+
+    while (hi - lo > 1) {
+        uint mid = (lo + hi) / 2;
+        if (instances.data[mid * 8 + 6] <= draw) lo = mid;
+        else hi = mid;
+    }
+
+    return lo;
+}
+
+IndirectDraw read_indirect_draw(IndirectDraws indirect_draws, uint ix) {
+    uint start = ix * 6;
+    IndirectDraw cmd;
+
+    cmd.vert_count = indirect_draws.data[start];
+    cmd.instance_count = indirect_draws.data[start + 1];
+    cmd.first_vertex = indirect_draws.data[start + 2];
+    cmd.first_instance = indirect_draws.data[start + 3];
+    cmd.start_offset = indirect_draws.data[start + 4];
+    cmd.transform_offset = indirect_draws.data[start + 5];
+
+    return cmd;
+}
+
+void main() {
+    uint gid = gl_GlobalInvocationID.x;
+    if (gid >= draw_count) return;
+
+    Instance instance = read_instance(find_instance(gid));
+    IndirectDraw draw_cmd = read_indirect_draw(instance.indirect_draws, gid - instance.first_draw);
+
+    uint task_data_slot = atomicAdd(task_datas.data_count, 1);
+    uint start_task_slot = atomicAdd(tasks.task_count, draw_cmd.instance_count);
+
+    write_cull_task_data(task_datas, task_data_slot, CullTaskData(uvec2(instance.group), uvec2(transforms), draw_cmd.start_offset));
+
+    for (uint i = 0; i < draw_cmd.instance_count; i++) {
+        write_cull_task(tasks, start_task_slot, CullTask(task_data_slot, draw_cmd.transform_offset == -1 ? instance.transform_offset : draw_cmd.transform_offset, draw_cmd.vert_count, draw_cmd.first_vertex, i == 0 ? gid : 0xFFFFFFFFu));
+
+        start_task_slot++;
+    }
+}
@@ -0,0 +1,29 @@
+#version 460
+
+layout(local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+layout(set = 0, binding = 0) uniform sampler2D src;
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D dst;
+
+layout(push_constant, std430) uniform Push {
+    uvec2 src_size;
+    uvec2 dst_size;
+};
+
+void main() {
+    uvec2 pos = gl_GlobalInvocationID.xy;
+    if (any(greaterThanEqual(pos, dst_size))) return;
+
+    // every source texel the destination texel overlaps, the sizes don't have to be multiples of each other
+    uvec2 start = pos * src_size / dst_size;
+    uvec2 end = min(max(((pos + 1) * src_size + dst_size - 1) / dst_size, start + 1), src_size);
+
+    float depth = 0.0;
+    for (uint y = start.y; y < end.y; y++) {
+        for (uint x = start.x; x < end.x; x++) {
+            depth = max(depth, texelFetch(src, ivec2(x, y), 0).r);
+        }
+    }
+
+    imageStore(dst, ivec2(pos), vec4(depth));
+}
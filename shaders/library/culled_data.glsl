@@ -134,6 +134,8 @@ struct CullTask {
     uint transform_offset;
     uint vertex_count;
     uint first_vertex;
+    // stable across frames for the same draw, -1 when the draw has none
+    uint visibility_id;
 };
 
 layout(buffer_reference, std430) buffer CullTasks {
@@ -142,24 +144,26 @@ layout(buffer_reference, std430) buffer CullTasks {
 };
 
 CullTask read_cull_task(CullTasks tasks, uint ix) {
-    uint start = ix * 4;
+    uint start = ix * 5;
     CullTask task;
 
     task.data_id = tasks.data[start];
     task.transform_offset = tasks.data[start + 1];
     task.vertex_count = tasks.data[start + 2];
     task.first_vertex = tasks.data[start + 3];
+    task.visibility_id = tasks.data[start + 4];
 
     return task;
 }
 
 void write_cull_task(CullTasks tasks, uint ix, CullTask task) {
-    uint start = ix * 4;
+    uint start = ix * 5;
 
     tasks.data[start] = task.data_id;
     tasks.data[start + 1] = task.transform_offset;
     tasks.data[start + 2] = task.vertex_count;
     tasks.data[start + 3] = task.first_vertex;
+    tasks.data[start + 4] = task.visibility_id;
 }
 
 #endif
@@ -0,0 +1,166 @@
+#ifndef _CULLING_
+#define _CULLING_
+
+#include "library/mesh_data.glsl"
+#include "library/culled_data.glsl"
+
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+
+layout(buffer_reference, std430) buffer CullStats {
+    uint tested;
+    uint culled;
+    uint occluded;
+    uint clusters;
+    uint clusters_culled;
+};
+
+// `culling::set_view`
+layout(buffer_reference, std430) readonly buffer CullView {
+    mat4 view_proj;
+    vec3 camera_position;
+    float lod_error;
+};
+
+// meshlets of visible tasks left for `cluster_culling`, the header doubles as its indirect dispatch
+layout(buffer_reference, std430) buffer Clusters {
+    uint dispatch_x;
+    uint dispatch_y;
+    uint dispatch_z;
+    uint count;
+    // every entry below it is written, `count` keeps growing past the capacity
+    uint size;
+    uint _pad[3];
+    uvec2 data[];
+};
+
+// one entry per visibility id, non zero when the draw passed the late phase last frame
+layout(buffer_reference, std430) buffer Visibility {
+    uint data[];
+};
+
+vec4 frustum_row(mat4 view_proj, uint i) {
+    return vec4(view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]);
+}
+
+// same test as `culling::is_visible`
+bool is_visible(mat4 view_proj, mat4 transform, vec3 bb_min, vec3 bb_max) {
+    if (bb_min == bb_max) return true;
+
+    vec3 center = (transform * vec4((bb_min + bb_max) * 0.5, 1.0)).xyz;
+    vec3 local_extent = (bb_max - bb_min) * 0.5;
+    vec3 extent = abs(transform[0].xyz) * local_extent.x + abs(transform[1].xyz) * local_extent.y + abs(transform[2].xyz) * local_extent.z;
+
+    for (uint i = 0; i < 6; i++) {
+        vec4 plane = frustum_row(view_proj, 3) + (i % 2 == 0 ? 1.0 : -1.0) * frustum_row(view_proj, i / 2);
+        if (dot(plane.xyz, center) + plane.w + dot(abs(plane.xyz), extent) < 0.0) return false;
+    }
+
+    return true;
+}
+
+// the planes aren't normalized, so the radius is scaled by their length instead
+bool is_sphere_visible(mat4 view_proj, vec3 center, float radius) {
+    for (uint i = 0; i < 6; i++) {
+        vec4 plane = frustum_row(view_proj, 3) + (i % 2 == 0 ? 1.0 : -1.0) * frustum_row(view_proj, i / 2);
+        if (dot(plane.xyz, center) + plane.w < -radius * length(plane.xyz)) return false;
+    }
+
+    return true;
+}
+
+// ndc bounds of the transformed box, false when part of it is behind the camera
+bool project_bounds(mat4 view_proj, mat4 transform, vec3 bb_min, vec3 bb_max, out vec3 ndc_min, out vec3 ndc_max) {
+    ndc_min = vec3(1e30);
+    ndc_max = vec3(-1e30);
+    for (uint i = 0; i < 8; i++) {
+        vec3 corner = mix(bb_min, bb_max, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+        vec4 clip = view_proj * transform * vec4(corner, 1.0);
+        if (clip.w <= 0.0) return false;
+
+        vec3 ndc = clip.xyz / clip.w;
+        ndc_min = min(ndc_min, ndc);
+        ndc_max = max(ndc_max, ndc);
+    }
+
+    return true;
+}
+
+struct CullInput {
+    CullTask task;
+    DrawID draw_id;
+    mat4 transform;
+    vec3 bb_min;
+    vec3 bb_max;
+    uint lod_count;
+    uint vertex_count;
+    uint meshlet_offset;
+    uint meshlet_count;
+};
+
+CullInput read_cull_input(CullTaskDatas task_datas, CullTasks tasks, uint ix) {
+    CullInput data;
+    data.task = read_cull_task(tasks, ix);
+    CullTaskData task_data = read_cull_task_data(task_datas, data.task.data_id);
+
+    VertexData verts = VertexData(task_data.verts);
+    MeshData mesh_data = read_mesh_data(verts, task_data.verts_start_offset / 4);
+
+    data.draw_id = DrawID(verts, task_data.verts_start_offset, mesh_data.material_id, task_data.transforms, data.task.transform_offset);
+    data.transform = read_draw_id_transform(data.draw_id) * mesh_data.transform;
+    data.bb_min = mesh_data.min;
+    data.bb_max = mesh_data.max;
+    data.lod_count = mesh_data.lod_count;
+    data.vertex_count = mesh_data.vertex_count;
+    data.meshlet_offset = mesh_data.meshlet_offset;
+    data.meshlet_count = mesh_data.meshlet_count;
+
+    return data;
+}
+
+// switches the task to the coarsest lod whose error, projected with the bounds, stays under `lod_error` of the
+// screen. boxes reaching behind the camera keep the full mesh
+void select_lod(inout CullInput data, mat4 view_proj, float lod_error) {
+    if (data.lod_count == 0) return;
+
+    vec3 ndc_min;
+    vec3 ndc_max;
+    if (!project_bounds(view_proj, data.transform, data.bb_min, data.bb_max, ndc_min, ndc_max)) return;
+
+    vec2 size = (ndc_max.xy - ndc_min.xy) * 0.5;
+    float screen_size = max(size.x, size.y);
+
+    for (uint lod = data.lod_count; lod > 0; lod--) {
+        MeshLod mesh_lod = read_mesh_lod(data.draw_id.group, data.draw_id.start_offset / 4, lod - 1);
+        if (mesh_lod.error * screen_size > lod_error) continue;
+
+        data.task.first_vertex = mesh_lod.first_index;
+        data.task.vertex_count = mesh_lod.index_count;
+        return;
+    }
+}
+
+// only tasks drawing the whole mesh can be split up, lods and sub-ranges of the indices are drawn as they are
+bool can_split(CullInput data) {
+    return data.meshlet_count != 0 && data.task.first_vertex == 0 && data.task.vertex_count == data.vertex_count;
+}
+
+// frustum test of the bounding sphere, then the normal cone decides if every triangle faces away from the camera
+bool is_meshlet_visible(CullView view, mat4 transform, Meshlet meshlet) {
+    vec3 center = (transform * vec4(meshlet.center, 1.0)).xyz;
+    vec3 scale = vec3(length(transform[0].xyz), length(transform[1].xyz), length(transform[2].xyz));
+    float max_scale = max(scale.x, max(scale.y, scale.z));
+
+    if (!is_sphere_visible(view.view_proj, center, meshlet.radius * max_scale)) return false;
+    if (meshlet.cone_cutoff >= 1.0) return true;
+
+    // the cone doesn't survive non uniform scale, mirroring flips which side is the back
+    float min_scale = min(scale.x, min(scale.y, scale.z));
+    if (max_scale - min_scale > max_scale * 1e-3 || determinant(mat3(transform)) < 0.0) return true;
+
+    vec3 axis = normalize(mat3(transform) * meshlet.cone_axis);
+    vec3 to_center = center - view.camera_position;
+    return dot(to_center, axis) < meshlet.cone_cutoff * length(to_center) + meshlet.radius * max_scale;
+}
+
+#endif
@@ -11,6 +11,29 @@ struct MeshData {
     mat4 transform;
     vec3 min;
     vec3 max;
+    uint lod_count;
+    // byte offset into the group like `offsets.start`, the meshlets follow the 4 lods
+    uint meshlet_offset;
+    uint meshlet_count;
+};
+
+// the lod chain follows the bounding box, `MeshLod`s are 3 uints each
+const uint mesh_lods_offset = offsets_size + 3 + 16 + 6;
+
+struct MeshLod {
+    uint first_index;
+    uint index_count;
+    float error;
+};
+
+// 12 uints each, see `model::Meshlet`
+struct Meshlet {
+    vec3 center;
+    float radius;
+    vec3 cone_axis;
+    float cone_cutoff;
+    uint first_index;
+    uint triangle_count;
 };
 
 MeshData read_mesh_data(VertexData verts, uint start_offset) {
@@ -26,13 +49,45 @@ MeshData read_mesh_data(VertexData verts, uint start_offset) {
         data.transform[i/4][i%4] = uintBitsToFloat(verts.data[start_offset + 3 + i]);
     }
 
-    data.min.x = uintBitsToFloat(verts.data[start_offset + 4 + 16]);
-    data.min.y = uintBitsToFloat(verts.data[start_offset + 4 + 16 + 1]);
-    data.min.z = uintBitsToFloat(verts.data[start_offset + 4 + 16 + 2]);
+    data.min.x = uintBitsToFloat(verts.data[start_offset + 3 + 16]);
+    data.min.y = uintBitsToFloat(verts.data[start_offset + 3 + 16 + 1]);
+    data.min.z = uintBitsToFloat(verts.data[start_offset + 3 + 16 + 2]);
+
+    data.max.x = uintBitsToFloat(verts.data[start_offset + 3 + 16 + 3]);
+    data.max.y = uintBitsToFloat(verts.data[start_offset + 3 + 16 + 4]);
+    data.max.z = uintBitsToFloat(verts.data[start_offset + 3 + 16 + 5]);
+
+    data.lod_count = verts.data[start_offset + 3 + 16 + 6];
+    data.meshlet_offset = verts.data[start_offset + 3 + 16 + 6 + 1 + 4 * 3];
+    data.meshlet_count = verts.data[start_offset + 3 + 16 + 6 + 1 + 4 * 3 + 1];
+
+    return data;
+}
+
+// `lod` 0 is the first simplified level, the full mesh has no entry
+MeshLod read_mesh_lod(VertexData verts, uint start_offset, uint lod) {
+    uint start = start_offset + mesh_lods_offset + 1 + lod * 3;
+
+    MeshLod data;
+    data.first_index = verts.data[start];
+    data.index_count = verts.data[start + 1];
+    data.error = uintBitsToFloat(verts.data[start + 2]);
+
+    return data;
+}
+
+Meshlet read_meshlet(VertexData verts, uint meshlet_offset, uint meshlet) {
+    uint start = meshlet_offset / 4 + meshlet * 12;
 
-    data.max.x = uintBitsToFloat(verts.data[start_offset + 4 + 16 + 3]);
-    data.max.y = uintBitsToFloat(verts.data[start_offset + 4 + 16 + 4]);
-    data.max.z = uintBitsToFloat(verts.data[start_offset + 4 + 16 + 5]);
+    Meshlet data;
+    data.center = vec3(uintBitsToFloat(verts.data[start]), uintBitsToFloat(verts.data[start + 1]),
+                       uintBitsToFloat(verts.data[start + 2]));
+    data.radius = uintBitsToFloat(verts.data[start + 3]);
+    data.cone_axis = vec3(uintBitsToFloat(verts.data[start + 4]), uintBitsToFloat(verts.data[start + 5]),
+                          uintBitsToFloat(verts.data[start + 6]));
+    data.cone_cutoff = uintBitsToFloat(verts.data[start + 7]);
+    data.first_index = verts.data[start + 8];
+    data.triangle_count = verts.data[start + 9];
 
     return data;
 }
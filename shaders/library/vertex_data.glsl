@@ -21,11 +21,15 @@ struct Offsets {
     uint texcoord2_offset;
     uint texcoord3_offset;
     bool indexed_tangents;
+    bool compact;
+    bool short_indices;
 };
 
 const uint offsets_size = 12;
 
-const uint STRIDE_MASK = 0x7FFFFFFFu;
+const uint STRIDE_MASK = 0x1FFFFFFFu;
+const uint SHORT_INDICES_MASK = 0x20000000u;
+const uint COMPACT_VERTICES_MASK = 0x40000000u;
 const uint INDEXED_TANGENTS_MASK = 0x80000000u;
 
 Offsets read_offsets(const VertexData verts, const uint start_offset) {
@@ -46,10 +50,24 @@ Offsets read_offsets(const VertexData verts, const uint start_offset) {
 
     offsets.stride = stride & STRIDE_MASK;
     offsets.indexed_tangents = (stride & INDEXED_TANGENTS_MASK) != 0;
+    offsets.compact = (stride & COMPACT_VERTICES_MASK) != 0;
+    offsets.short_indices = (stride & SHORT_INDICES_MASK) != 0;
 
     return offsets;
 }
 
+vec3 decode_octahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+vec4 decode_tangent(uint e) {
+    vec2 xy = vec2(bitfieldExtract(int(e), 0, 15), bitfieldExtract(int(e), 15, 15)) / 16383.0;
+    return vec4(decode_octahedral(clamp(xy, -1.0, 1.0)), (e & 0x80000000u) != 0 ? -1.0 : 1.0);
+}
+
 struct Vertex {
     vec3 pos;
     vec3 normal;
@@ -66,11 +84,44 @@ Vertex load_vertex(const VertexData verts, const Offsets offs, const uint index,
     uint ix = index;
     uint start = relative ? offs.relative_start/4 : offs.start/4;
     if (offs.indices_offset != uint(-1)) {
-        ix = verts.data[start + offs.indices_offset/4 + ix];
+        if (offs.short_indices) {
+            uint pair = verts.data[start + offs.indices_offset/4 + ix/2];
+            ix = (pair >> ((ix & 1) * 16)) & 0xFFFFu;
+        } else {
+            ix = verts.data[start + offs.indices_offset/4 + ix];
+        }
     }
 
     uint stride = offs.stride/4;
 
+    // see `Mesh::compact_vertices`
+    if (offs.compact) {
+        if (offs.position_offset != uint(-1)) {
+            uint decode = start + offs.position_offset/4 - 6;
+            vec3 min_pos = vec3(uintBitsToFloat(verts.data[decode]), uintBitsToFloat(verts.data[decode + 1]), uintBitsToFloat(verts.data[decode + 2]));
+            vec3 scale = vec3(uintBitsToFloat(verts.data[decode + 3]), uintBitsToFloat(verts.data[decode + 4]), uintBitsToFloat(verts.data[decode + 5]));
+
+            uint xy = verts.data[start + offs.position_offset/4 + ix*stride];
+            uint z = verts.data[start + offs.position_offset/4 + ix*stride + 1];
+            vert.pos = min_pos + vec3(xy & 0xFFFFu, xy >> 16, z & 0xFFFFu) * scale;
+        }
+
+        if (offs.normal_offset != uint(-1)) {
+            vert.normal = decode_octahedral(unpackSnorm2x16(verts.data[start + offs.normal_offset/4 + ix*stride]));
+        }
+
+        if (offs.tangent_offset != uint(-1)) {
+            vert.tangent = decode_tangent(verts.data[start + offs.tangent_offset/4 + (offs.indexed_tangents ? ix*stride : ix)]);
+        }
+
+        if (offs.texcoord0_offset != uint(-1)) vert.texcoord0 = unpackHalf2x16(verts.data[start + offs.texcoord0_offset/4 + ix*stride]);
+        if (offs.texcoord1_offset != uint(-1)) vert.texcoord1 = unpackHalf2x16(verts.data[start + offs.texcoord1_offset/4 + ix*stride]);
+        if (offs.texcoord2_offset != uint(-1)) vert.texcoord2 = unpackHalf2x16(verts.data[start + offs.texcoord2_offset/4 + ix*stride]);
+        if (offs.texcoord3_offset != uint(-1)) vert.texcoord3 = unpackHalf2x16(verts.data[start + offs.texcoord3_offset/4 + ix*stride]);
+
+        return vert;
+    }
+
     if (offs.position_offset != uint(-1)) {
         vert.pos.x = uintBitsToFloat(verts.data[start + offs.position_offset/4 + ix*stride]);
         vert.pos.y = uintBitsToFloat(verts.data[start + offs.position_offset/4 + ix*stride + 1]);
@@ -9,6 +9,10 @@ namespace engine {
         vma_ptrs::flush_alloc(_allocation, start, size);
     }
 
+    void Buffer::invalidate_mapped(uint32_t start, uint32_t size) {
+        vma_ptrs::invalidate_alloc(_allocation, start, size);
+    }
+
     Buffer Buffer::create(const char* name, uint32_t size, VkBufferUsageFlags usage, std::optional<std::pair<void**, bool*>> host, VmaAllocationCreateFlags alloc_flags) {
         Buffer buf{};
 
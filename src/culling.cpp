@@ -1,29 +1,158 @@
 #include "goliath/culling.hpp"
 #include "goliath/buffer.hpp"
 #include "goliath/compute.hpp"
+#include "goliath/descriptor_pool.hpp"
 #include "goliath/engine.hpp"
 #include "goliath/fs.hpp"
 #include "goliath/push_constant.hpp"
 #include "goliath/rendering.hpp"
+#include "goliath/samplers.hpp"
 #include "goliath/synchronization.hpp"
+#include "goliath/texture.hpp"
+#include <bit>
+#include <cassert>
+#include <format>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
 #include <vulkan/vulkan_core.h>
 
 namespace engine::culling {
     using FlattenDrawPC =
         engine::PushConstant<uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint32_t, uint32_t, uint32_t>;
-    using CullingPC = engine::PushConstant<uint64_t, uint64_t, uint64_t, uint64_t, uint32_t>;
+    using FlattenInstancesPC =
+        engine::PushConstant<uint64_t, uint64_t, uint64_t, uint64_t, uint32_t, uint32_t, uint32_t>;
+    using CullingPC = engine::PushConstant<uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t,
+                                           uint64_t, uint32_t, uint32_t, uint32_t, uint32_t>;
+    using CullingLatePC = engine::PushConstant<uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t,
+                                               uint32_t, uint32_t>;
+    using ClusterCullingPC =
+        engine::PushConstant<uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint32_t>;
+    using HiZReducePC = engine::PushConstant<glm::uvec2, glm::uvec2>;
+
+    // has to match the phases in culling.glsl
+    enum struct Phase : uint32_t {
+        Frustum,
+        Early,
+    };
 
     ComputePipeline flatten_draw_pipeline;
+    ComputePipeline flatten_instances_pipeline;
     ComputePipeline culling_pipeline;
+    ComputePipeline culling_late_pipeline;
+    ComputePipeline cluster_culling_pipeline;
+    ComputePipeline hiz_reduce_pipeline;
+
+    VkDescriptorSetLayout hiz_reduce_layout;
+    VkDescriptorSetLayout hiz_sample_layout;
+    VkSampler hiz_sampler;
 
     uint32_t max_task_count = 0;
     uint64_t task_capacity;
     Buffer task_buffers[frames_in_flight]{};
     Buffer task_data_buffers[frames_in_flight]{};
 
-    constexpr uint32_t task_size = 16;
+    constexpr uint32_t task_size = 20;
     constexpr uint32_t task_data_size = 36;
 
+    // written by the culling shader, read back once the frame that wrote them is done
+    struct StatsBuffer {
+        Buffer buffer{};
+        CullStats* host = nullptr;
+        bool coherent = false;
+    };
+
+    StatsBuffer stats_buffers[frames_in_flight]{};
+    CullStats last_stats{};
+
+    // matches `CullView` in library/culling.glsl, the view doesn't fit the push constants next to all the addresses
+    struct CullView {
+        glm::mat4 view_proj;
+        glm::vec3 camera_position;
+        float lod_error;
+    };
+
+    struct ViewBuffer {
+        Buffer buffer{};
+        CullView* host = nullptr;
+        bool coherent = false;
+    };
+
+    ViewBuffer view_buffers[frames_in_flight]{};
+
+    // `Clusters` in library/culling.glsl, a header that's also the indirect dispatch of `cluster_culling` followed by
+    // (task, meshlet) pairs
+    constexpr uint32_t clusters_header_size = 32;
+    constexpr uint32_t cluster_size = 8;
+    // meshlets a task can be split into on average before the rest is drawn whole
+    constexpr uint32_t clusters_per_task = 16;
+    Buffer cluster_buffers[frames_in_flight]{};
+
+    // indexed by the tasks' visibility ids, survives across frames
+    Buffer visibility_buffer{};
+    bool reset_visibility = true;
+    Buffer late_draw_buffers[frames_in_flight]{};
+
+    static constexpr uint32_t max_hiz_levels = 16;
+    struct HiZ {
+        GPUImage image{};
+        VkImageView view = nullptr;
+        std::array<VkImageView, max_hiz_levels> level_views{};
+        uint32_t level_count = 0;
+    };
+
+    HiZ hizs[frames_in_flight]{};
+    glm::uvec2 hiz_depth_extent{0};
+    glm::uvec2 hiz_extent{0};
+
+    void destroy(HiZ& hiz) {
+        if (hiz.level_count == 0) return;
+
+        for (uint32_t level = 0; level < hiz.level_count; level++) {
+            gpu_image_view::destroy(hiz.level_views[level]);
+        }
+        gpu_image_view::destroy(hiz.view);
+        gpu_image::destroy(hiz.image);
+
+        hiz = HiZ{};
+    }
+
+    Frustum frustum_from(const glm::mat4& view_proj) {
+        auto row = [&](int i) { return glm::vec4{view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]}; };
+
+        return Frustum{{
+            row(3) + row(0),
+            row(3) - row(0),
+            row(3) + row(1),
+            row(3) - row(1),
+            row(3) + row(2),
+            row(3) - row(2),
+        }};
+    }
+
+    bool is_visible(const Frustum& frustum, const glm::mat4& transform, collisions::AABB bounding_box) {
+        // meshes without a bounding box are never culled
+        if (bounding_box.min == bounding_box.max) return true;
+
+        auto center = glm::vec3{transform * glm::vec4{(bounding_box.min + bounding_box.max) * 0.5f, 1.0f}};
+        auto local_extent = (bounding_box.max - bounding_box.min) * 0.5f;
+
+        auto extent = glm::vec3{0.0f};
+        for (int i = 0; i < 3; i++) {
+            extent += glm::abs(glm::vec3{transform[i]}) * local_extent[i];
+        }
+
+        for (const auto& plane : frustum.planes) {
+            auto normal = glm::vec3{plane};
+            if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extent) < 0.0f) return false;
+        }
+
+        return true;
+    }
+
+    CullStats get_stats() {
+        return last_stats;
+    }
+
     void init(uint32_t max_tasks) {
         resize(max_tasks);
 
@@ -34,6 +163,14 @@ namespace engine::culling {
             compute::create(ComputePipelineBuilder{}.shader(flatten_draw_module).push_constant(FlattenDrawPC::size));
         free(flatten_draw_spv);
 
+        uint32_t flatten_instances_size;
+        auto* flatten_instances_spv =
+            util::read_file(fs::runtime_file("./flatten_instances.spv"), &flatten_instances_size);
+        auto flatten_instances_module = engine::shader::create({flatten_instances_spv, flatten_instances_size});
+        flatten_instances_pipeline = compute::create(
+            ComputePipelineBuilder{}.shader(flatten_instances_module).push_constant(FlattenInstancesPC::size));
+        free(flatten_instances_spv);
+
         uint32_t culling_size;
         auto* culling_spv = util::read_file(fs::runtime_file("./culling.spv"), &culling_size);
         auto culling_module = engine::shader::create({culling_spv, culling_size});
@@ -41,18 +178,96 @@ namespace engine::culling {
             compute::create(ComputePipelineBuilder{}.shader(culling_module).push_constant(CullingPC::size));
         free(culling_spv);
 
+        hiz_reduce_layout = descriptor::create_layout(DescriptorSet<descriptor::Binding{
+                                                                        .count = 1,
+                                                                        .type = descriptor::Binding::SampledImage,
+                                                                        .stages = VK_SHADER_STAGE_COMPUTE_BIT,
+                                                                    },
+                                                                    descriptor::Binding{
+                                                                        .count = 1,
+                                                                        .type = descriptor::Binding::StorageImage,
+                                                                        .stages = VK_SHADER_STAGE_COMPUTE_BIT,
+                                                                    }>{});
+        hiz_sample_layout = descriptor::create_layout(DescriptorSet<descriptor::Binding{
+            .count = 1,
+            .type = descriptor::Binding::SampledImage,
+            .stages = VK_SHADER_STAGE_COMPUTE_BIT,
+        }>{});
+        hiz_sampler = sampler::create(Sampler{}
+                                          .min_filter(FilterMode::Nearest)
+                                          .mag_filter(FilterMode::Nearest)
+                                          .mipmap(MipMapMode::Nearest)
+                                          .address(AddressMode::ClampToEdge));
+
+        uint32_t culling_late_size;
+        auto* culling_late_spv = util::read_file(fs::runtime_file("./culling_late.spv"), &culling_late_size);
+        auto culling_late_module = engine::shader::create({culling_late_spv, culling_late_size});
+        culling_late_pipeline = compute::create(ComputePipelineBuilder{}
+                                                    .shader(culling_late_module)
+                                                    .descriptor_layout(0, hiz_sample_layout)
+                                                    .push_constant(CullingLatePC::size));
+        free(culling_late_spv);
+
+        uint32_t cluster_culling_size;
+        auto* cluster_culling_spv = util::read_file(fs::runtime_file("./cluster_culling.spv"), &cluster_culling_size);
+        auto cluster_culling_module = engine::shader::create({cluster_culling_spv, cluster_culling_size});
+        cluster_culling_pipeline = compute::create(
+            ComputePipelineBuilder{}.shader(cluster_culling_module).push_constant(ClusterCullingPC::size));
+        free(cluster_culling_spv);
+
+        uint32_t hiz_reduce_size;
+        auto* hiz_reduce_spv = util::read_file(fs::runtime_file("./hiz_reduce.spv"), &hiz_reduce_size);
+        auto hiz_reduce_module = engine::shader::create({hiz_reduce_spv, hiz_reduce_size});
+        hiz_reduce_pipeline = compute::create(ComputePipelineBuilder{}
+                                                  .shader(hiz_reduce_module)
+                                                  .descriptor_layout(0, hiz_reduce_layout)
+                                                  .push_constant(HiZReducePC::size));
+        free(hiz_reduce_spv);
+
+        for (auto& stats : stats_buffers) {
+            stats.buffer = Buffer::create("culling stats buffer", sizeof(CullStats),
+                                          VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT, {{(void**)&stats.host, &stats.coherent}});
+            *stats.host = CullStats{};
+            if (!stats.coherent) stats.buffer.flush_mapped(0, sizeof(CullStats));
+        }
+
+        for (auto& view : view_buffers) {
+            view.buffer = Buffer::create("culling view buffer", sizeof(CullView), VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT,
+                                         {{(void**)&view.host, &view.coherent}});
+        }
+
         engine::shader::destroy(flatten_draw_module);
+        engine::shader::destroy(flatten_instances_module);
         engine::shader::destroy(culling_module);
+        engine::shader::destroy(culling_late_module);
+        engine::shader::destroy(cluster_culling_module);
+        engine::shader::destroy(hiz_reduce_module);
     }
 
     void destroy() {
         for (size_t i = 0; i < frames_in_flight; i++) {
             task_buffers[i].destroy();
             task_data_buffers[i].destroy();
+            stats_buffers[i].buffer.destroy();
+            stats_buffers[i] = StatsBuffer{};
+            view_buffers[i].buffer.destroy();
+            view_buffers[i] = ViewBuffer{};
+            late_draw_buffers[i].destroy();
+            cluster_buffers[i].destroy();
+            destroy(hizs[i]);
         }
+        visibility_buffer.destroy();
 
         compute::destroy(flatten_draw_pipeline);
+        compute::destroy(flatten_instances_pipeline);
         compute::destroy(culling_pipeline);
+        compute::destroy(culling_late_pipeline);
+        compute::destroy(cluster_culling_pipeline);
+        compute::destroy(hiz_reduce_pipeline);
+
+        descriptor::destroy_layout(hiz_reduce_layout);
+        descriptor::destroy_layout(hiz_sample_layout);
+        sampler::destroy(hiz_sampler);
     }
 
     void resize(uint32_t max_tasks) {
@@ -60,7 +275,15 @@ namespace engine::culling {
         for (size_t i = 0; i < frames_in_flight; i++) {
             task_buffers[i].destroy();
             task_data_buffers[i].destroy();
+            late_draw_buffers[i].destroy();
+            cluster_buffers[i].destroy();
         }
+        visibility_buffer.destroy();
+
+        visibility_buffer =
+            Buffer::create("culling visibility buffer", max_tasks * sizeof(uint32_t),
+                           VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT, std::nullopt);
+        reset_visibility = true;
 
         for (size_t i = 0; i < frames_in_flight; i++) {
             task_buffers[i] =
@@ -69,6 +292,18 @@ namespace engine::culling {
             task_data_buffers[i] =
                 Buffer::create("culling task data buffer", max_tasks * task_data_size,
                                VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT, std::nullopt);
+            late_draw_buffers[i] = Buffer::create("culling late draws buffer",
+                                                  late_draws_offset + max_tasks * sizeof(CulledDrawCommand),
+                                                  VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT |
+                                                      VK_BUFFER_USAGE_2_TRANSFER_DST_BIT |
+                                                      VK_BUFFER_USAGE_2_INDIRECT_BUFFER_BIT,
+                                                  std::nullopt);
+            cluster_buffers[i] = Buffer::create("culling clusters buffer",
+                                                clusters_header_size + max_tasks * clusters_per_task * cluster_size,
+                                                VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT |
+                                                    VK_BUFFER_USAGE_2_TRANSFER_DST_BIT |
+                                                    VK_BUFFER_USAGE_2_INDIRECT_BUFFER_BIT,
+                                                std::nullopt);
         }
     }
 
@@ -91,7 +326,29 @@ namespace engine::culling {
         });
     }
 
-    void cull(uint32_t max_draw_count, uint64_t draw_id_addr, uint64_t indirect_draw_addr) {
+    void bind_flatten_instances() {
+        flatten_instances_pipeline.bind();
+    }
+
+    void flatten_instances(uint64_t instances_addr, uint32_t instance_count, uint32_t draw_count,
+                           uint64_t transforms_addr) {
+        if (instance_count == 0 || draw_count == 0) return;
+
+        uint8_t pc[FlattenInstancesPC::size]{};
+        FlattenInstancesPC::write(pc, instances_addr, task_data_buffers[engine::get_current_frame()].address(),
+                                  task_buffers[engine::get_current_frame()].address(), transforms_addr,
+                                  instance_count, draw_count, max_task_count);
+
+        flatten_instances_pipeline.dispatch(ComputePipeline::DispatchParams{
+            .push_constant = pc,
+            .group_count_x = (uint32_t)std::ceil(draw_count / 64.0f),
+            .group_count_y = 1,
+            .group_count_z = 1,
+        });
+    }
+
+    // the tasks are written by the flatten shaders right before
+    void sync_tasks_for_cull() {
         auto& task_data_buffer = task_data_buffers[engine::get_current_frame()];
         auto& task_buffer = task_buffers[engine::get_current_frame()];
 
@@ -129,11 +386,155 @@ namespace engine::culling {
         engine::synchronization::apply_barrier(task_data_barrier);
         engine::synchronization::apply_barrier(task_barrier);
         engine::synchronization::end_barriers();
+    }
+
+    // the previous frame recorded into this slot is done by now, its counters can be taken and reset
+    StatsBuffer& take_stats() {
+        auto& stats = stats_buffers[engine::get_current_frame()];
+        if (!stats.coherent) stats.buffer.invalidate_mapped(0, sizeof(CullStats));
+        last_stats = *stats.host;
+        *stats.host = CullStats{};
+        if (!stats.coherent) stats.buffer.flush_mapped(0, sizeof(CullStats));
+
+        return stats;
+    }
+
+    void set_view(const glm::mat4& view_proj, glm::vec3 camera_position, float lod_error) {
+        auto& view = view_buffers[engine::get_current_frame()];
+        *view.host = CullView{
+            .view_proj = view_proj,
+            .camera_position = camera_position,
+            .lod_error = lod_error,
+        };
+        if (!view.coherent) view.buffer.flush_mapped(0, sizeof(CullView));
+    }
+
+    // empties the clusters with a dispatch of 0 groups before the culling shader appends to them
+    void reset_clusters() {
+        auto& cluster_buffer = cluster_buffers[engine::get_current_frame()];
+
+        uint32_t header[clusters_header_size / sizeof(uint32_t)]{0, 1, 1, 0, 0};
+        vkCmdUpdateBuffer(get_cmd_buf(), cluster_buffer.data(), 0, clusters_header_size, header);
+
+        VkBufferMemoryBarrier2 cluster_barrier{};
+        cluster_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+        cluster_barrier.pNext = nullptr;
+        cluster_barrier.buffer = cluster_buffer;
+        cluster_barrier.offset = 0;
+        cluster_barrier.size = clusters_header_size;
+        cluster_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        cluster_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        cluster_barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        cluster_barrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        cluster_barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+        cluster_barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+
+        engine::synchronization::begin_barriers();
+        engine::synchronization::apply_barrier(cluster_barrier);
+        engine::synchronization::end_barriers();
+    }
+
+    // tests the meshlets the culling shader left behind, appending their draws behind the ones it wrote
+    void cull_clusters(uint32_t max_draw_count, uint64_t draw_id_addr, uint64_t indirect_draw_addr, StatsBuffer& stats) {
+        auto& cluster_buffer = cluster_buffers[engine::get_current_frame()];
+
+        // the clusters and their dispatch size, and the draw count both shaders bump
+        VkMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        barrier.pNext = nullptr;
+        barrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+        barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        barrier.dstAccessMask =
+            VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+        barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+
+        engine::synchronization::begin_barriers();
+        engine::synchronization::apply_barrier(barrier);
+        engine::synchronization::end_barriers();
+
+        uint8_t pc[ClusterCullingPC::size]{};
+        ClusterCullingPC::write(pc, view_buffers[engine::get_current_frame()].buffer.address(),
+                                task_data_buffers[engine::get_current_frame()].address(),
+                                task_buffers[engine::get_current_frame()].address(), cluster_buffer.address(),
+                                indirect_draw_addr, draw_id_addr, stats.buffer.address(), max_draw_count);
+
+        cluster_culling_pipeline.bind();
+        cluster_culling_pipeline.dispatch_indirect(ComputePipeline::IndirectDispatchParams{
+            .push_constant = pc,
+            .indirect_buffer = cluster_buffer,
+            .buffer_offset = 0,
+        });
+    }
+
+    void cull(uint32_t max_draw_count, uint64_t draw_id_addr, uint64_t indirect_draw_addr) {
+        auto& stats = take_stats();
+        sync_tasks_for_cull();
+        reset_clusters();
+
+        uint8_t pc[CullingPC::size]{};
+        CullingPC::write(pc, view_buffers[engine::get_current_frame()].buffer.address(),
+                         task_data_buffers[engine::get_current_frame()].address(),
+                         task_buffers[engine::get_current_frame()].address(), indirect_draw_addr, draw_id_addr,
+                         stats.buffer.address(), 0, cluster_buffers[engine::get_current_frame()].address(),
+                         max_draw_count, 0, (uint32_t)Phase::Frustum, max_task_count * clusters_per_task);
+
+        culling_pipeline.bind();
+        culling_pipeline.dispatch(ComputePipeline::DispatchParams{
+            .push_constant = pc,
+            .group_count_x = (uint32_t)std::ceil(max_task_count / 32.0f),
+            .group_count_y = 1,
+            .group_count_z = 1,
+        });
+
+        cull_clusters(max_draw_count, draw_id_addr, indirect_draw_addr, stats);
+    }
+
+    void cull_early(uint32_t max_draw_count, uint64_t draw_id_addr, uint64_t indirect_draw_addr) {
+        auto& stats = take_stats();
+        sync_tasks_for_cull();
+        reset_clusters();
+
+        VkBufferMemoryBarrier2 visibility_barrier{};
+        visibility_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+        visibility_barrier.pNext = nullptr;
+        visibility_barrier.buffer = visibility_buffer;
+        visibility_barrier.offset = 0;
+        visibility_barrier.size = visibility_buffer.size();
+        visibility_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        visibility_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        visibility_barrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+        visibility_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        visibility_barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        visibility_barrier.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+
+        // nothing counts as visible after a resize, the late phase fills it back in
+        if (reset_visibility) {
+            engine::synchronization::begin_barriers();
+            engine::synchronization::apply_barrier(visibility_barrier);
+            engine::synchronization::end_barriers();
+
+            vkCmdFillBuffer(get_cmd_buf(), visibility_buffer.data(), 0, visibility_buffer.size(), 0);
+
+            visibility_barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+            visibility_barrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+            reset_visibility = false;
+        }
+
+        // written by the late phase of the last frame
+        visibility_barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+        visibility_barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+
+        engine::synchronization::begin_barriers();
+        engine::synchronization::apply_barrier(visibility_barrier);
+        engine::synchronization::end_barriers();
 
         uint8_t pc[CullingPC::size]{};
-        CullingPC::write(pc, task_data_buffers[engine::get_current_frame()].address(),
+        CullingPC::write(pc, view_buffers[engine::get_current_frame()].buffer.address(),
+                         task_data_buffers[engine::get_current_frame()].address(),
                          task_buffers[engine::get_current_frame()].address(), indirect_draw_addr, draw_id_addr,
-                         max_draw_count);
+                         stats.buffer.address(), visibility_buffer.address(),
+                         cluster_buffers[engine::get_current_frame()].address(), max_draw_count, max_task_count,
+                         (uint32_t)Phase::Early, max_task_count * clusters_per_task);
 
         culling_pipeline.bind();
         culling_pipeline.dispatch(ComputePipeline::DispatchParams{
@@ -142,6 +543,229 @@ namespace engine::culling {
             .group_count_y = 1,
             .group_count_z = 1,
         });
+
+        cull_clusters(max_draw_count, draw_id_addr, indirect_draw_addr, stats);
+    }
+
+    void resize_hiz(glm::uvec2 depth_extent) {
+        for (auto& hiz : hizs) {
+            destroy(hiz);
+        }
+
+        hiz_depth_extent = depth_extent;
+        // a power of two below the depth size, so every level is exactly half of the one before
+        hiz_extent = glm::uvec2{std::bit_floor(std::max(depth_extent.x, 1u)), std::bit_floor(std::max(depth_extent.y, 1u))};
+        auto level_count = std::min((uint32_t)std::bit_width(std::max(hiz_extent.x, hiz_extent.y)), max_hiz_levels);
+
+        for (size_t i = 0; i < frames_in_flight; i++) {
+            auto& hiz = hizs[i];
+            hiz.level_count = level_count;
+            hiz.image = gpu_image::upload(std::format("Hi-Z pyramid #{}", i).c_str(),
+                                          GPUImageInfo{}
+                                              .format(VK_FORMAT_R32_SFLOAT)
+                                              .width(hiz_extent.x)
+                                              .height(hiz_extent.y)
+                                              .mip_levels(level_count)
+                                              .aspect_mask(VK_IMAGE_ASPECT_COLOR_BIT)
+                                              .new_layout(VK_IMAGE_LAYOUT_GENERAL)
+                                              .usage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT),
+                                          VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT);
+            hiz.view = gpu_image_view::create(
+                GPUImageView{hiz.image}.aspect_mask(VK_IMAGE_ASPECT_COLOR_BIT).level_count(level_count));
+
+            for (uint32_t level = 0; level < level_count; level++) {
+                hiz.level_views[level] = gpu_image_view::create(
+                    GPUImageView{hiz.image}.aspect_mask(VK_IMAGE_ASPECT_COLOR_BIT).base_mip_level(level).level_count(1));
+            }
+        }
+    }
+
+    VkImageMemoryBarrier2 hiz_barrier(HiZ& hiz, VkPipelineStageFlags2 src_stage, VkAccessFlags2 src_access,
+                                      VkAccessFlags2 dst_access) {
+        return VkImageMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .pNext = nullptr,
+            .srcStageMask = src_stage,
+            .srcAccessMask = src_access,
+            .dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            .dstAccessMask = dst_access,
+            .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = hiz.image.image,
+            .subresourceRange =
+                VkImageSubresourceRange{
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .baseMipLevel = 0,
+                    .levelCount = VK_REMAINING_MIP_LEVELS,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+        };
+    }
+
+    VkImageMemoryBarrier2 depth_barrier(VkImage depth, VkImageLayout old_layout, VkImageLayout new_layout,
+                                        VkPipelineStageFlags2 src_stage, VkAccessFlags2 src_access,
+                                        VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access) {
+        return VkImageMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .pNext = nullptr,
+            .srcStageMask = src_stage,
+            .srcAccessMask = src_access,
+            .dstStageMask = dst_stage,
+            .dstAccessMask = dst_access,
+            .oldLayout = old_layout,
+            .newLayout = new_layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = depth,
+            .subresourceRange =
+                VkImageSubresourceRange{
+                    .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                    .baseMipLevel = 0,
+                    .levelCount = 1,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                },
+        };
+    }
+
+    void build_hiz(VkImage depth, VkImageView depth_view) {
+        auto& hiz = hizs[engine::get_current_frame()];
+        assert(hiz.level_count != 0);
+
+        engine::synchronization::begin_barriers();
+        engine::synchronization::apply_barrier(depth_barrier(
+            depth, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT));
+        // the late phase of the last frame in this slot might still be sampling it
+        engine::synchronization::apply_barrier(hiz_barrier(hiz, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                                                           VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                                                           VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT));
+        engine::synchronization::end_barriers();
+
+        hiz_reduce_pipeline.bind();
+
+        auto src_extent = hiz_depth_extent;
+        auto dst_extent = hiz_extent;
+        for (uint32_t level = 0; level < hiz.level_count; level++) {
+            auto set = descriptor::new_set(hiz_reduce_layout);
+            descriptor::begin_update(set);
+            if (level == 0) {
+                descriptor::update_sampled_image(0, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, depth_view, hiz_sampler);
+            } else {
+                descriptor::update_sampled_image(0, VK_IMAGE_LAYOUT_GENERAL, hiz.level_views[level - 1], hiz_sampler);
+            }
+            descriptor::update_storage_image(1, VK_IMAGE_LAYOUT_GENERAL, hiz.level_views[level]);
+            descriptor::end_update();
+
+            uint8_t pc[HiZReducePC::size]{};
+            HiZReducePC::write(pc, src_extent, dst_extent);
+
+            hiz_reduce_pipeline.dispatch(ComputePipeline::DispatchParams{
+                .push_constant = pc,
+                .descriptor_indexes =
+                    {
+                        set,
+                        descriptor::null_set,
+                        descriptor::null_set,
+                        descriptor::null_set,
+                    },
+                .group_count_x = (uint32_t)std::ceil(dst_extent.x / 8.0f),
+                .group_count_y = (uint32_t)std::ceil(dst_extent.y / 8.0f),
+                .group_count_z = 1,
+            });
+
+            engine::synchronization::begin_barriers();
+            engine::synchronization::apply_barrier(hiz_barrier(
+                hiz, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT));
+            engine::synchronization::end_barriers();
+
+            src_extent = dst_extent;
+            dst_extent = glm::max(dst_extent / 2u, glm::uvec2{1});
+        }
+
+        engine::synchronization::begin_barriers();
+        engine::synchronization::apply_barrier(depth_barrier(
+            depth, VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+            VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT));
+        engine::synchronization::end_barriers();
+    }
+
+    void cull_late(uint32_t max_draw_count, Buffer& draw_id_buffer) {
+        auto& hiz = hizs[engine::get_current_frame()];
+        auto& stats = stats_buffers[engine::get_current_frame()];
+        auto& late_draw_buffer = late_draw_buffers[engine::get_current_frame()];
+
+        VkBufferMemoryBarrier2 visibility_barrier{};
+        visibility_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+        visibility_barrier.pNext = nullptr;
+        visibility_barrier.buffer = visibility_buffer;
+        visibility_barrier.offset = 0;
+        visibility_barrier.size = visibility_buffer.size();
+        visibility_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        visibility_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        visibility_barrier.srcAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+        visibility_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        visibility_barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+        visibility_barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+
+        // written by the early phase and read by the early raster, the late phase appends behind them
+        VkBufferMemoryBarrier2 draw_id_barrier = visibility_barrier;
+        draw_id_barrier.buffer = draw_id_buffer;
+        draw_id_barrier.size = draw_id_buffer.size();
+        draw_id_barrier.srcAccessMask =
+            VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+        draw_id_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                                       VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+
+        VkBufferMemoryBarrier2 late_draw_barrier = visibility_barrier;
+        late_draw_barrier.buffer = late_draw_buffer;
+        late_draw_barrier.size = late_draw_buffer.size();
+        late_draw_barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        late_draw_barrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+
+        engine::synchronization::begin_barriers();
+        engine::synchronization::apply_barrier(visibility_barrier);
+        engine::synchronization::apply_barrier(draw_id_barrier);
+        engine::synchronization::apply_barrier(late_draw_barrier);
+        engine::synchronization::end_barriers();
+
+        auto set = descriptor::new_set(hiz_sample_layout);
+        descriptor::begin_update(set);
+        descriptor::update_sampled_image(0, VK_IMAGE_LAYOUT_GENERAL, hiz.view, hiz_sampler);
+        descriptor::end_update();
+
+        uint8_t pc[CullingLatePC::size]{};
+        CullingLatePC::write(pc, view_buffers[engine::get_current_frame()].buffer.address(),
+                             task_data_buffers[engine::get_current_frame()].address(),
+                             task_buffers[engine::get_current_frame()].address(), late_draw_buffer.address(),
+                             draw_id_buffer.address(), stats.buffer.address(), visibility_buffer.address(), max_draw_count,
+                             max_task_count);
+
+        culling_late_pipeline.bind();
+        culling_late_pipeline.dispatch(ComputePipeline::DispatchParams{
+            .push_constant = pc,
+            .descriptor_indexes =
+                {
+                    set,
+                    descriptor::null_set,
+                    descriptor::null_set,
+                    descriptor::null_set,
+                },
+            .group_count_x = (uint32_t)std::ceil(max_task_count / 32.0f),
+            .group_count_y = 1,
+            .group_count_z = 1,
+        });
+    }
+
+    Buffer& late_draws() {
+        return late_draw_buffers[engine::get_current_frame()];
     }
 
     void sync_for_draw(Buffer& draw_id_buffer, Buffer& indirect_draw_buffer) {
@@ -180,11 +804,31 @@ namespace engine::culling {
         engine::synchronization::apply_barrier(indirect_draw_barrier);
     }
 
+    void sync_late_for_draw() {
+        auto& late_draw_buffer = late_draw_buffers[engine::get_current_frame()];
+
+        VkBufferMemoryBarrier2 late_draw_barrier{};
+        late_draw_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+        late_draw_barrier.pNext = nullptr;
+        late_draw_barrier.buffer = late_draw_buffer;
+        late_draw_barrier.offset = 0;
+        late_draw_barrier.size = late_draw_buffer.size();
+        late_draw_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        late_draw_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        late_draw_barrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+        late_draw_barrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        late_draw_barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+        late_draw_barrier.dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+
+        engine::synchronization::apply_barrier(late_draw_barrier);
+    }
+
     void clear_buffers(Buffer& draw_ids, Buffer& indirect_draws, VkAccessFlags2 draw_ids_src_access,
                        VkPipelineStageFlags2 draw_ids_src_stage, VkAccessFlags2 indirect_draws_access,
                        VkPipelineStageFlags2 indirect_draws_stage) {
         auto& task_data_buffer = task_data_buffers[engine::get_current_frame()];
         auto& task_buffer = task_buffers[engine::get_current_frame()];
+        auto& late_draw_buffer = late_draw_buffers[engine::get_current_frame()];
 
         VkBufferMemoryBarrier2 task_data_barrier{};
         task_data_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
@@ -246,11 +890,25 @@ namespace engine::culling {
         indirect_draws_barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
         indirect_draws_barrier.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
 
+        VkBufferMemoryBarrier2 late_draws_barrier{};
+        late_draws_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+        late_draws_barrier.pNext = nullptr;
+        late_draws_barrier.buffer = late_draw_buffer;
+        late_draws_barrier.offset = 0;
+        late_draws_barrier.size = late_draw_buffer.size();
+        late_draws_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        late_draws_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        late_draws_barrier.srcAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+        late_draws_barrier.srcStageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+        late_draws_barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        late_draws_barrier.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+
         engine::synchronization::begin_barriers();
         engine::synchronization::apply_barrier(task_barrier);
         engine::synchronization::apply_barrier(task_data_barrier);
         engine::synchronization::apply_barrier(draw_ids_barrier);
         engine::synchronization::apply_barrier(indirect_draws_barrier);
+        engine::synchronization::apply_barrier(late_draws_barrier);
         engine::synchronization::end_barriers();
 
         auto cmd_buf = get_cmd_buf();
@@ -260,5 +918,6 @@ namespace engine::culling {
 
         vkCmdFillBuffer(cmd_buf, task_buffer.data(), 0, task_buffer.size(), 0);
         vkCmdFillBuffer(cmd_buf, task_data_buffer.data(), 0, task_data_buffer.size(), 0);
+        vkCmdFillBuffer(cmd_buf, late_draw_buffer.data(), 0, late_draw_buffer.size(), 0);
     }
 }
@@ -121,6 +121,16 @@ namespace engine {
             });
         if (err) return std::unexpected(*err);
 
+        auto content_path = metadata_dir / "content.json";
+        if (std::filesystem::exists(content_path)) {
+            auto j = util::read_json(content_path);
+            if (!j) return std::unexpected(std::pair{content_path, j.error()});
+
+            for (const auto& entry : *j) {
+                graph->content[entry["hash"].get<uint64_t>()] = entry["asset"].get<AssetGID>();
+            }
+        }
+
         graph->build_r_deps();
 
         return graph;
@@ -164,6 +174,14 @@ namespace engine {
                 }
             }
         });
+
+        auto content_json = nlohmann::json::array();
+        for (const auto& [hash, gid] : content) {
+            content_json.emplace_back(nlohmann::json{{"hash", hash}, {"asset", gid}});
+        }
+
+        std::ofstream o{alternative_dir / "content.json"};
+        o << content_json;
     }
 
     void DependencyGraph::build_r_deps() {
@@ -178,7 +196,7 @@ namespace engine {
                         auto r_dep = get_asset(dep);
                         if (!r_dep) continue;
 
-                        r_dep->get().deps.emplace_back(construct_gid<GID>(dim, assets[i].generation, i));
+                        r_dep->get().r_deps.emplace_back(construct_gid<GID>(dim, assets[i].generation, i));
                     }
                 }
             }
@@ -336,6 +336,7 @@ namespace engine {
         VkPhysicalDeviceFeatures features{};
         features.multiDrawIndirect = true;
         features.independentBlend = true;
+        features.textureCompressionBC = true;
         // features.robustBufferAccess = true;
 
         auto physical_device_selected = vkb::PhysicalDeviceSelector{vkb_inst}
@@ -427,7 +428,7 @@ namespace engine {
         fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
         VK_CHECK(vkCreateFence(device(), &fence_info, nullptr, &state->barriers_cmd_buf_fence));
 
-        transport2::init();
+        transport2::init(opts.transport);
         imgui::init();
         event::register_glfw_callbacks();
         descriptor::create_empty_set();
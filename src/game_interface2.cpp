@@ -138,6 +138,12 @@ namespace engine::game_interface2 {
                                          *count = ret.size();
                                          return ret.data();
                                      },
+                                 .instance_count =
+                                     [](auto scene_ix) { return scenes::get_instance_models(scene_ix).size(); },
+                                 .set_instance_transforms =
+                                     [](auto scene_ix, auto first, const auto* transforms, auto count) {
+                                         scenes::set_instance_transforms(scene_ix, first, {transforms, count});
+                                     },
                              },
                              .fatal = [](const char* message) { throw GameFatalException(message); }};
     }
@@ -48,6 +48,17 @@ namespace engine::gpu_group {
                                    VK_BUFFER_USAGE_2_TRANSFER_DST_BIT | usage_flags, std::nullopt),
         };
 
+        // serialize straight into the staging arena, malloc is only the fallback when the arena is full
+        if (auto reservation = transport2::reserve(needed_data_size, 16, false)) {
+            uint8_t* data = reservation->data;
+            for (const auto& upload_func : upload_ptrs) {
+                data = upload_func(data);
+            }
+
+            group.ticket = transport2::upload(priority, *reservation, group.data, 0, stage, access);
+            return group;
+        }
+
         uint8_t* data = (uint8_t*)malloc(needed_data_size);
         uint8_t* start_of_data = data;
         for (const auto& upload_func : upload_ptrs) {
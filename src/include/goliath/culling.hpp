@@ -1,7 +1,12 @@
 #pragma once
 
 #include "goliath/buffer.hpp"
+#include "goliath/collisions.hpp"
+#include <array>
 #include <cstdint>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
 
 #include <volk.h>
 
@@ -16,6 +21,39 @@ namespace engine::culling {
         uint32_t draw_id;
     };
 
+    // one per scene instance, `first_draw` is the sum of `draw_count` over the instances before it
+    struct InstanceDescriptor {
+        uint64_t group_addr;
+        uint64_t draw_buffer_addr;
+        uint32_t draw_count;
+        uint32_t transform_offset;
+        uint32_t first_draw;
+        uint32_t _pad{};
+    };
+
+    // planes point inwards, a point `p` is inside when `dot(plane, vec4(p, 1.0f)) >= 0` for all of them
+    struct Frustum {
+        std::array<glm::vec4, 6> planes;
+    };
+
+    Frustum frustum_from(const glm::mat4& view_proj);
+    // cpu reference of the test `cull` runs on the gpu, `transform` is the instance and mesh transform combined
+    bool is_visible(const Frustum& frustum, const glm::mat4& transform, collisions::AABB bounding_box);
+
+    struct CullStats {
+        uint32_t tested = 0;
+        // includes the occluded ones
+        uint32_t culled = 0;
+        // only counted by `cull_late`
+        uint32_t occluded = 0;
+        // meshlets of the visible draws, tested one by one instead of the draw
+        uint32_t clusters = 0;
+        uint32_t clusters_culled = 0;
+    };
+
+    // counters of the last frame that finished on the gpu
+    CullStats get_stats();
+
     void init(uint32_t max_tasks);
     void destroy();
     void resize(uint32_t max_draw_count);
@@ -24,10 +62,37 @@ namespace engine::culling {
     void flatten(uint64_t group_addr, uint32_t draw_count, uint64_t draw_buffer_addr, uint64_t transforms_addr,
                  uint32_t default_transform_offset);
 
+    // flattens every draw of `instance_count` descriptors at `instances_addr` in a single dispatch
+    void bind_flatten_instances();
+    void flatten_instances(uint64_t instances_addr, uint32_t instance_count, uint32_t draw_count,
+                           uint64_t transforms_addr);
+
+    // camera every cull of this frame uses. the surviving tasks draw the coarsest lod whose simplification error
+    // covers at most `lod_error` of the screen once projected, 0 keeps every mesh at full detail unless a lod is lossless
+    void set_view(const glm::mat4& view_proj, glm::vec3 camera_position, float lod_error);
+
+    // drops every task whose mesh bounding box lies outside of the frustum. tasks drawing a whole mesh with meshlets
+    // are split up and every meshlet gets its own frustum and back facing cone test and draw
     void cull(uint32_t max_draw_count, uint64_t draw_id_addr, uint64_t indirect_draw_addr);
 
     void sync_for_draw(Buffer& draw_id_buffer, Buffer& indirect_draw_addr);
 
+    // two-phase occlusion culling, a frame goes `cull_early`, raster, `build_hiz`, `cull_late` and a second raster
+    // of `late_draws` on top of the first one. the early phase only lets through what passed the late phase last
+    // frame, the late phase tests everything against the depth pyramid and draws what the early one missed
+    void resize_hiz(glm::uvec2 depth_extent);
+    void cull_early(uint32_t max_draw_count, uint64_t draw_id_addr, uint64_t indirect_draw_addr);
+    // `depth` has to be in DEPTH_ATTACHMENT_OPTIMAL and sampleable, it's left in DEPTH_ATTACHMENT_OPTIMAL
+    void build_hiz(VkImage depth, VkImageView depth_view);
+    // keeps appending to the draw ids of `cull_early`, the draw commands go to `late_draws`. draws are never split
+    // into meshlets here
+    void cull_late(uint32_t max_draw_count, Buffer& draw_id_buffer);
+
+    // `CulledDrawCommand`s of the late phase start at `late_draws_offset`, their count is the first uint
+    static constexpr uint32_t late_draws_offset = 16;
+    Buffer& late_draws();
+    void sync_late_for_draw();
+
     void clear_buffers(Buffer& draw_ids, Buffer& indirect_draws,
                        VkAccessFlags2 draw_ids_src_access = VK_ACCESS_2_SHADER_READ_BIT,
                        VkPipelineStageFlags2 draw_ids_src_stage = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
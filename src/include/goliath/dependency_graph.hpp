@@ -6,6 +6,7 @@
 #include "goliath/util.hpp"
 #include <functional>
 #include <mutex>
+#include <unordered_map>
 #include <utility>
 
 namespace engine {
@@ -49,6 +50,29 @@ namespace engine {
 
         void add_dep(AssetGID asset, AssetGID dep);
 
+        // number of assets depending on `gid`, a shared asset is only dropped by `deep_remove` once this hits 0
+        uint32_t ref_count(AssetGID gid) {
+            std::lock_guard lock{mutex};
+            return (uint32_t)get_r_deps(gid).size();
+        }
+
+        // project wide index from the XXH3 of an asset's contents to the asset, so identical data imported twice
+        // maps to the same gid. entries go away with their asset, the caller still has to check the gid is alive
+        std::optional<AssetGID> find_content(uint64_t hash) {
+            std::lock_guard lock{mutex};
+            auto it = content.find(hash);
+            if (it == content.end()) return std::nullopt;
+            return it->second;
+        }
+
+        // replaces whatever `gid` was indexed under before, for assets written over in place
+        void add_content(uint64_t hash, AssetGID gid) {
+            std::lock_guard lock{mutex};
+            std::erase_if(content, [&](const auto& entry) { return entry.second == gid; });
+            content[hash] = gid;
+            modified();
+        }
+
         static std::expected<DependencyGraph*, std::pair<std::filesystem::path, util::ReadJsonErr>>
         init(std::filesystem::path metadata_dir);
         void save(std::filesystem::path alternative_dir = "");
@@ -92,6 +116,8 @@ namespace engine {
         std::vector<Asset> texture_deps;
         std::vector<std::vector<Asset>> material_deps;
 
+        std::unordered_map<uint64_t, AssetGID> content{};
+
         void modified() {
             want_save = true;
         }
@@ -103,6 +129,8 @@ namespace engine {
         std::optional<std::reference_wrapper<Asset>> _remove_asset(
             AssetGID gid,
             std::optional<std::reference_wrapper<std::vector<std::pair<AssetGID, AssetGID>>>> removals = std::nullopt) {
+            std::erase_if(content, [&](const auto& entry) { return entry.second == gid; });
+
             auto asset_ = get_asset(gid);
             if (!asset_) return std::nullopt;
             auto& asset = asset_->get();
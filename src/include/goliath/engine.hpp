@@ -1,6 +1,7 @@
 #pragma once
 
 #include "goliath/texture.hpp"
+#include "goliath/transport2.hpp"
 
 #include <volk.h>
 #include <vulkan/vk_enum_string_helper.h>
@@ -29,6 +30,7 @@ namespace engine {
         const char* window_name;
         uint32_t texture_capacity = 1000;
         bool fullscreen = true;
+        transport2::Config transport{};
     };
 
     void init(Init opts);
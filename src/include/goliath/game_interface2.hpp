@@ -217,6 +217,8 @@ namespace engine::game_interface2 {
         struct ScenesServicePtrs {
             Buffer (*instance_transforms_buffer)(size_t scene_ix, transport2::ticket* ticket);
             const models::gid* (*used_models)(size_t scene_ix, size_t* count);
+            size_t (*instance_count)(size_t scene_ix);
+            void (*set_instance_transforms)(size_t scene_ix, size_t first, const glm::mat4* transforms, size_t count);
         };
 
         class ScenesService {
@@ -239,6 +241,16 @@ namespace engine::game_interface2 {
                 auto ptr = ptrs.used_models(scene_ix, &count);
                 return {ptr, count};
             }
+
+            size_t instance_count(size_t scene_ix) {
+                return ptrs.instance_count(scene_ix);
+            }
+
+            // overwrites the transforms of instances [`first`, `first` + `transforms.size()`), only those are
+            // uploaded before the next draw
+            void set_instance_transforms(size_t scene_ix, size_t first, std::span<const glm::mat4> transforms) {
+                ptrs.set_instance_transforms(scene_ix, first, transforms.data(), transforms.size());
+            }
         };
 
         AssetsService assets;
@@ -67,6 +67,20 @@ namespace engine {
         // thread unsafe, call from one thread only
         Buffer get_buffer();
 
+        struct UploadStats {
+            // bytes handed to transport2 by the last `process`
+            uint32_t frame_bytes = 0;
+            uint32_t frame_ranges = 0;
+            bool frame_full_upload = false;
+
+            uint64_t total_bytes = 0;
+        };
+
+        UploadStats get_upload_stats() {
+            std::lock_guard lock{mutex};
+            return upload_stats;
+        }
+
         bool want_to_save() {
             std::lock_guard lock{mutex};
             auto res = want_save;
@@ -124,6 +138,8 @@ namespace engine {
             std::vector<uint32_t> generations{};
             std::vector<uint32_t> ref_counts{};
             std::vector<bool> deleted{};
+            // deleted slots keep their space in `data` and get reused last in first out
+            std::vector<uint32_t> free_ids{};
 
             std::vector<uint8_t> data{};
         };
@@ -137,15 +153,41 @@ namespace engine {
         std::array<Buffer, 2> gpu_buffers{};
         transport2::ticket next_buffer_ticket{};
 
+        struct DirtyRange {
+            uint32_t offset;
+            uint32_t size;
+        };
+
+        // both buffers track what they're missing on their own, a buffer gets everything that changed since it was
+        // last written to once it's the one being uploaded to. a layout change always rewrites the whole buffer
+        std::array<bool, 2> full_upload{true, true};
+        std::array<std::vector<DirtyRange>, 2> dirty_ranges{};
+
+        UploadStats upload_stats{};
+
+        uint32_t header_size() const {
+            return sizeof(uint32_t) + offsets.size() * sizeof(uint32_t);
+        }
+
+        // writes [`offset`, `offset` + `size`) of the buffer's contents to `out`
+        void write_contents(uint8_t* out, uint32_t offset, uint32_t size) const;
+        void mark_layout_changed();
+        void mark_instance_dirty(uint32_t mat_id, uint32_t inst_id);
+
         std::vector<std::string> names{};
         std::vector<Material> schemas{};
         std::vector<uint32_t> offsets{};
         std::vector<Instance> instances{};
 
+        // ids of the deleted schemas, reused last in first out
         std::vector<uint32_t> deleted{};
+        std::vector<bool> schema_deleted{};
 
         bool is_deleted(uint32_t mat_id) const {
-            return std::find(deleted.begin(), deleted.end(), mat_id) != deleted.end();
+            return mat_id < schema_deleted.size() && schema_deleted[mat_id];
         }
+
+        // lays every schema's instances out back to back
+        void recompute_offsets();
     };
 }
@@ -4,11 +4,13 @@
 #include "goliath/materials.hpp"
 #include "goliath/collisions.hpp"
 #include "goliath/rendering.hpp"
+#include "goliath/util.hpp"
 #include <cstdint>
 #include <cstring>
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/ext/vector_float3.hpp>
 #include <glm/ext/vector_float4.hpp>
+#include <span>
 #include <volk.h>
 
 namespace engine::model {
@@ -23,11 +25,13 @@ namespace engine::model {
         uint32_t tangent_offset = (uint32_t)-1;
         std::array<uint32_t, 4> texcoords_offset = {(uint32_t)-1, (uint32_t)-1, (uint32_t)-1, (uint32_t)-1};
 
-        static constexpr uint32_t STRIDE_MASK = 0x7FFFFFFFu;
+        static constexpr uint32_t STRIDE_MASK = 0x1FFFFFFFu;
+        static constexpr uint32_t SHORT_INDICES_MASK = 0x20000000u;
+        static constexpr uint32_t COMPACT_VERTICES_MASK = 0x40000000u;
         static constexpr uint32_t INDEXED_TANGENTS_MASK = 0x80000000u;
 
         void set_stride(uint32_t value) {
-            stride = (stride & INDEXED_TANGENTS_MASK) | (value & STRIDE_MASK);
+            stride = (stride & ~STRIDE_MASK) | (value & STRIDE_MASK);
         }
 
         uint32_t get_stride() const {
@@ -42,6 +46,68 @@ namespace engine::model {
         bool get_indexed_tangetns() const {
             return (stride & INDEXED_TANGENTS_MASK) != 0;
         }
+
+        // see `Mesh::compact_vertices`
+        void set_compact_vertices(bool value) {
+            if (value) stride |= COMPACT_VERTICES_MASK;
+            else stride &= ~COMPACT_VERTICES_MASK;
+        }
+
+        bool get_compact_vertices() const {
+            return (stride & COMPACT_VERTICES_MASK) != 0;
+        }
+
+        // see `Mesh::short_indices`
+        void set_short_indices(bool value) {
+            if (value) stride |= SHORT_INDICES_MASK;
+            else stride &= ~SHORT_INDICES_MASK;
+        }
+
+        bool get_short_indices() const {
+            return (stride & SHORT_INDICES_MASK) != 0;
+        }
+    };
+
+    // levels after the full mesh, each roughly halves the triangles of the one before
+    static constexpr uint32_t max_lod_count = 4;
+
+    struct MeshLod {
+        // into the mesh's indices, which the indices of every lod directly follow
+        uint32_t first_index = 0;
+        uint32_t index_count = 0;
+        // largest distance the simplified surface strays from the full mesh, relative to the largest side of its
+        // bounding box
+        float error = 0.0f;
+    };
+
+    static constexpr uint32_t meshlet_max_vertices = 64;
+    static constexpr uint32_t meshlet_max_triangles = 124;
+
+    // a cluster of the full mesh's triangles, small enough to be culled on its own
+    struct Meshlet {
+        // bounding sphere in mesh space
+        glm::vec3 center;
+        float radius;
+        // every triangle normal lies within `cone_axis` widened by the cone's half angle, `cone_cutoff` is its sine
+        // and 1 when the cluster can't be culled as back facing
+        glm::vec3 cone_axis;
+        float cone_cutoff;
+
+        // into the mesh's indices, the clusters partition the full mesh's triangles in order
+        uint32_t first_index;
+        uint32_t triangle_count;
+        uint32_t vertex_count;
+        uint32_t _pad{};
+    };
+
+    // the arrays of a mesh mapped from a .gom that stores them encoded, pointing into the mapping. the mapping
+    // doesn't decode them, so `Model::save` writes them back out as is
+    struct EncodedArrays {
+        std::span<const uint8_t> indices{};
+        std::span<const uint8_t> positions{};
+        std::span<const uint8_t> normals{};
+        std::span<const uint8_t> tangents{};
+        std::array<std::span<const uint8_t>, 4> texcoords{};
     };
 }
 
@@ -61,12 +127,42 @@ namespace engine {
         glm::vec4* tangents = nullptr;
         std::array<glm::vec2*, 4> texcoords = {nullptr, nullptr, nullptr, nullptr};
 
+        // simplified index lists of the same vertices, `lod_indices` holds every level back to back
+        uint32_t lod_count = 0;
+        std::array<model::MeshLod, model::max_lod_count> lods{};
+        uint32_t lod_index_count = 0;
+        uint32_t* lod_indices = nullptr;
+
+        uint32_t meshlet_count = 0;
+        model::Meshlet* meshlets = nullptr;
+
         collisions::AABB bounding_box;
 
-        uint32_t get_optimized_size() const;
-        void save_optimized(std::span<uint8_t> data) const;
+        // the GPU data stores positions as 16 bit fractions of `bounding_box`, normals and tangents octahedral and
+        // texcoords as half floats, 20 bytes instead of 48 for a vertex with one uv set. the decode block of the
+        // positions sits right before the interleaved vertices
+        bool compact_vertices = false;
+        // the GPU data stores the indices and lod indices as uint16_t, only meshes below 65536 vertices can
+        bool short_indices = false;
+
+        // exactly what `upload_data` would write, set for meshes mapped from a .gom so it's copied as is. the arrays
+        // of a mapped mesh may be missing, so `gpu_offset` keeps its layout
+        const uint8_t* gpu_data = nullptr;
+        uint32_t gpu_data_size = 0;
+        model::GPUOffset gpu_offset{};
+        // set instead of the arrays for meshes mapped from a v6 or newer .gom
+        model::EncodedArrays encoded{};
+
+        // reads a mesh of the legacy (v1) .gom layout
         static void load_optimized(Mesh& out, std::span<uint8_t> data);
 
+        // half floats lose too much precision on texcoords far outside of [0, 1]
+        bool can_compact_vertices() const;
+        bool can_short_indices() const;
+
+        // bytes the indices and lod indices take in the GPU data, the meshlets follow them
+        uint32_t gpu_indices_size() const;
+
         model::GPUOffset calc_offset(uint32_t start_offset, uint32_t* total_size) const;
         // returns data size it wrote to `buf`
         uint32_t upload_data(uint8_t* buf) const;
@@ -92,10 +188,14 @@ namespace engine {
             }
 
             out->bounding_box = bounding_box;
+            out->compact_vertices = compact_vertices;
+            out->short_indices = short_indices;
         }
 
         void destroy() {
             free(indices);
+            free(lod_indices);
+            free(meshlets);
             free(positions);
             free(normals);
             free(tangents);
@@ -115,17 +215,30 @@ namespace engine {
         uint32_t* mesh_indexes = nullptr;
         glm::mat4* mesh_transforms = nullptr;
 
+        // set when the model points straight into a mapped .gom, only `meshes` itself is allocated then
+        util::MappedFile mapping{};
+
         uint32_t get_save_size() const;
-        // [`data`, `data` + `get_optimized_size()`) must be a valid range
+        // [`data`, `data` + `get_save_size()`) must be a valid range
         void save(std::span<uint8_t> data) const;
 
-        static void load(Model& out, std::span<uint8_t> data);
+        // copies everything out of `data`, returns false if it fails the checksum
+        static bool load(Model& out, std::span<uint8_t> data);
+        // maps `path` and points `out` into the mapping, legacy files are loaded through `load` instead
+        static bool map(Model& out, const std::filesystem::path& path);
 
         void destroy() {
+            if (mapping.data != nullptr) {
+                free(meshes);
+                util::unmap_file(mapping);
+                return;
+            }
+
             for (std::size_t i = 0; i < mesh_count; i++) {
                 meshes[i].destroy();
             }
 
+            free(mesh_indexes);
             free(mesh_transforms);
             free(meshes);
         }
@@ -151,6 +264,11 @@ namespace engine::model {
         uint32_t vertex_count;
         glm::mat4 transform;
         collisions::AABB bounding_box;
+        uint32_t lod_count;
+        std::array<MeshLod, max_lod_count> lods;
+        // byte offset of the `Meshlet`s in the group, counted like `GPUOffset::start`
+        uint32_t meshlet_offset;
+        uint32_t meshlet_count;
     };
 
     std::pair<GPUModel, Buffer>
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "goliath/culling.hpp"
 #include "goliath/gpu_group.hpp"
 #include "goliath/model.hpp"
 #include <nlohmann/json.hpp>
@@ -40,12 +41,37 @@ namespace engine::models {
         gid model;
     };
 
+    // the registry json and its slots, which ids are taken and under which generation. `models::load`, `save` and
+    // `add` go through one, goliath-cook keeps its own since it never loads a model
+    struct Registry {
+        std::vector<std::string> names{};
+        std::vector<uint8_t> generations{};
+        std::vector<bool> deleted{};
+        // ids of the deleted slots, reused last in first out
+        std::vector<uint32_t> free_ids{};
+
+        void load(const nlohmann::json& j);
+        nlohmann::json save() const;
+
+        // takes the last freed slot with its generation bumped, or a new one at the end
+        gid alloc(std::string name);
+        bool free(gid gid);
+        bool is_alive(gid gid) const;
+
+        uint32_t size() const {
+            return names.size();
+        }
+    };
+
     void init(std::filesystem::path models_dir, Textures* textures, Materials* materials);
     void destroy();
 
     void to_json(nlohmann::json& j, const gid& gid);
     void from_json(const nlohmann::json& j, gid& gid);
 
+    // file name of `gid`'s .gom inside the models directory
+    std::filesystem::path make_model_path(gid gid);
+
     void load(const nlohmann::json& j);
     nlohmann::json save();
 
@@ -55,6 +81,8 @@ namespace engine::models {
     bool remove(gid gid);
 
     std::expected<std::string*, Err> get_name(gid gid);
+    // models are mapped from their .gom, a v6 or newer one only carries the GPU data and the mesh tables. the
+    // vertex and index arrays of its meshes are null, `Model::load` the file to get them
     std::expected<engine::Model*, Err> get_cpu_model(gid gid);
     std::expected<transport2::ticket, Err> get_ticket(gid gid);
     std::expected<engine::Buffer, Err> get_draw_buffer(gid gid);
@@ -86,4 +114,6 @@ namespace engine::models {
 
 namespace engine::culling {
     std::expected<void, models::Err> flatten(models::gid gid, uint64_t transforms_addr, uint32_t default_transform_offset);
+    // `first_draw` is left at 0 for the caller to fill in
+    std::expected<InstanceDescriptor, models::Err> describe(models::gid gid, uint32_t transform_offset);
 }
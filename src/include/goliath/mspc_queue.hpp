@@ -5,6 +5,8 @@
 #include <cstdio>
 #include <cstring>
 #include <emmintrin.h>
+#include <mutex>
+#include <span>
 #include <vector>
 
 namespace engine {
@@ -44,6 +46,29 @@ namespace engine {
             com.commit.store(slot + 1, std::memory_order_release);
         }
 
+        // reserves all slots at once so the tasks stay contiguous, `tasks` bigger than the queue go in chunks of `N`
+        void enqueue(std::span<const Task> tasks) {
+            while (!tasks.empty()) {
+                uint32_t count = (uint32_t)std::min<size_t>(tasks.size(), N);
+                uint32_t slot = pub.reserve.fetch_add(count, std::memory_order_relaxed);
+
+                while (slot + count - con.read.load(std::memory_order_acquire) > N) {
+                    _mm_pause();
+                }
+
+                for (uint32_t i = 0; i < count; i++) {
+                    buffer[(slot + i) % N] = tasks[i];
+                }
+
+                while (com.commit.load(std::memory_order_relaxed) != slot) {
+                    _mm_pause();
+                }
+
+                com.commit.store(slot + count, std::memory_order_release);
+                tasks = tasks.subspan(count);
+            }
+        }
+
         void drain(std::vector<Task>& tasks) {
             uint32_t start = con.read.load(std::memory_order_acquire);
             uint32_t end = com.commit.load(std::memory_order_acquire);
@@ -62,4 +87,207 @@ namespace engine {
             con.read.store(end, std::memory_order_release);
         }
     };
+
+    struct MSPCQueueStats {
+        // tasks enqueued but not drained yet
+        uint64_t size;
+        // largest `size` seen so far
+        uint64_t high_water;
+        // segments currently allocated, in use or pooled
+        uint32_t segments;
+    };
+
+    // unbounded `MSPCQueue`, grows by whole segments of `SegmentSize` tasks instead of making producers wait for the
+    // consumer. drained segments are pooled and reused once no producer can still be holding on to them
+    template <typename Task, size_t SegmentSize = 256>
+    class SegmentedMSPCQueue {
+        struct Segment {
+            std::atomic<uint32_t> reserve{0};
+            std::array<std::atomic<bool>, SegmentSize> ready{};
+            std::array<Task, SegmentSize> buffer{};
+            std::atomic<Segment*> next{nullptr};
+
+            // consumer only
+            uint32_t read = 0;
+        };
+
+        struct alignas(64) TailPtr {
+            std::atomic<Segment*> segment;
+        };
+
+        struct alignas(64) ProducerCount {
+            std::atomic<uint32_t> count{0};
+        };
+
+        struct alignas(64) Counters {
+            std::atomic<uint64_t> size{0};
+            std::atomic<uint64_t> high_water{0};
+            // bumped after every enqueue, `wait` parks on it
+            std::atomic<uint32_t> epoch{0};
+        };
+
+        TailPtr tail{};
+        ProducerCount producers{};
+        Counters counters{};
+
+        // consumer only
+        Segment* head;
+        std::vector<Segment*> retired{};
+
+        std::mutex segments_lock{};
+        std::vector<Segment*> free_segments{};
+        uint32_t segment_count = 1;
+
+        Segment* next_segment(Segment* segment) {
+            auto* next = segment->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                std::lock_guard lock{segments_lock};
+
+                next = segment->next.load(std::memory_order_acquire);
+                if (next == nullptr) {
+                    if (free_segments.empty()) {
+                        next = new Segment{};
+                        segment_count++;
+                    } else {
+                        next = free_segments.back();
+                        free_segments.pop_back();
+                    }
+
+                    segment->next.store(next, std::memory_order_release);
+                }
+            }
+
+            tail.segment.compare_exchange_strong(segment, next, std::memory_order_acq_rel);
+            return next;
+        }
+
+        // retired segments can only be referenced by producers that loaded `tail` before it moved past them
+        void recycle() {
+            if (retired.empty() || producers.count.load() != 0) return;
+
+            std::lock_guard lock{segments_lock};
+            for (auto* segment : retired) {
+                segment->reserve.store(0, std::memory_order_relaxed);
+                for (auto& ready : segment->ready) {
+                    ready.store(false, std::memory_order_relaxed);
+                }
+                segment->next.store(nullptr, std::memory_order_relaxed);
+                segment->read = 0;
+
+                free_segments.emplace_back(segment);
+            }
+            retired.clear();
+        }
+
+        bool has_ready() const {
+            auto* segment = head;
+            if (segment->read == SegmentSize) {
+                segment = segment->next.load(std::memory_order_acquire);
+                if (segment == nullptr) return false;
+            }
+
+            return segment->ready[segment->read].load(std::memory_order_acquire);
+        }
+
+      public:
+        SegmentedMSPCQueue() : head(new Segment{}) {
+            tail.segment.store(head, std::memory_order_relaxed);
+        }
+
+        SegmentedMSPCQueue(const SegmentedMSPCQueue&) = delete;
+        SegmentedMSPCQueue& operator=(const SegmentedMSPCQueue&) = delete;
+
+        ~SegmentedMSPCQueue() {
+            for (auto* segment = head; segment != nullptr;) {
+                auto* next = segment->next.load(std::memory_order_relaxed);
+                delete segment;
+                segment = next;
+            }
+
+            for (auto* segment : retired) {
+                delete segment;
+            }
+
+            for (auto* segment : free_segments) {
+                delete segment;
+            }
+        }
+
+        void enqueue(Task task) {
+            auto size = counters.size.fetch_add(1, std::memory_order_relaxed) + 1;
+            auto high_water = counters.high_water.load(std::memory_order_relaxed);
+            while (size > high_water &&
+                   !counters.high_water.compare_exchange_weak(high_water, size, std::memory_order_relaxed)) {
+            }
+
+            producers.count.fetch_add(1);
+            auto* segment = tail.segment.load();
+            while (true) {
+                uint32_t slot = segment->reserve.fetch_add(1, std::memory_order_relaxed);
+                if (slot < SegmentSize) {
+                    segment->buffer[slot] = std::move(task);
+                    segment->ready[slot].store(true, std::memory_order_release);
+                    break;
+                }
+
+                segment = next_segment(segment);
+            }
+            producers.count.fetch_sub(1, std::memory_order_release);
+
+            counters.epoch.fetch_add(1, std::memory_order_release);
+            counters.epoch.notify_one();
+        }
+
+        void enqueue(std::span<const Task> tasks) {
+            for (const auto& task : tasks) {
+                enqueue(task);
+            }
+        }
+
+        // appends every task that's ready, stops at the first slot a producer hasn't finished writing yet
+        void drain(std::vector<Task>& tasks) {
+            uint64_t drained = 0;
+            while (true) {
+                while (head->read < SegmentSize && head->ready[head->read].load(std::memory_order_acquire)) {
+                    tasks.emplace_back(std::move(head->buffer[head->read]));
+                    head->read++;
+                    drained++;
+                }
+
+                if (head->read < SegmentSize) break;
+
+                auto* next = head->next.load(std::memory_order_acquire);
+                if (next == nullptr) break;
+
+                retired.emplace_back(head);
+                head = next;
+            }
+
+            if (drained != 0) counters.size.fetch_sub(drained, std::memory_order_relaxed);
+            recycle();
+        }
+
+        // blocks the consumer until something got enqueued or `wake` was called, can still return with nothing to
+        // drain when the newest task landed behind one that's only half written
+        void wait() {
+            auto epoch = counters.epoch.load(std::memory_order_acquire);
+            if (has_ready()) return;
+
+            counters.epoch.wait(epoch, std::memory_order_acquire);
+        }
+
+        void wake() {
+            counters.epoch.fetch_add(1, std::memory_order_release);
+            counters.epoch.notify_all();
+        }
+
+        MSPCQueueStats stats() {
+            std::lock_guard lock{segments_lock};
+            return MSPCQueueStats{
+                .size = counters.size.load(std::memory_order_relaxed),
+                .high_water = counters.high_water.load(std::memory_order_relaxed),
+                .segments = segment_count,
+            };
+        }
+    };
 }
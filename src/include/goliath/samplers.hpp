@@ -42,7 +42,7 @@ namespace engine {
             _info.minFilter = VK_FILTER_LINEAR;
             _info.magFilter = VK_FILTER_LINEAR;
             _info.unnormalizedCoordinates = false;
-            _info.maxLod = 0.0f;
+            _info.maxLod = VK_LOD_CLAMP_NONE;
             _info.minLod = 0.0f;
             _info.mipLodBias = 0.0f;
         };
@@ -37,7 +37,11 @@ namespace engine::scenes {
     std::string& get_name(size_t scene_ix);
     std::span<std::string> get_instance_names(size_t scene_ix);
     std::span<const models::gid> get_instance_models(size_t scene_ix);
+    // writing through the span has to be followed by `mark_transforms_dirty`
     std::span<glm::mat4> get_instance_transforms(size_t scene_ix);
+    // only the marked matrices get uploaded, at the latest when the transforms buffer is fetched next
+    void mark_transforms_dirty(size_t scene_ix, size_t first, size_t count);
+    void set_instance_transforms(size_t scene_ix, size_t first, std::span<const glm::mat4> transforms);
     Buffer get_instance_transforms_buffer(size_t scene_ix, transport2::ticket& ticket);
     std::span<const models::gid> get_used_models(size_t scene_ix);
 
@@ -94,3 +98,10 @@ namespace engine::scenes {
 
     Iterator draw(size_t scene_ix, transport2::ticket& t, uint64_t& transforms_addr);
 }
+
+namespace engine::culling {
+    // flattens every instance of the scene whose model is on the gpu with one dispatch, binds its own pipeline
+    transport2::ticket flatten_scene(size_t scene_ix);
+    // runs `culling::is_visible` over the same draws on the cpu, only models that still have their cpu data count
+    CullStats reference_cull(size_t scene_ix, const glm::mat4& view_proj);
+}
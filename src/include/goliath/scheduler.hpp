@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+
+namespace engine::scheduler {
+    struct job {
+        uint64_t value;
+
+        static constexpr uint64_t id_mask = 0x00000000FFFFFFFFu;
+        static constexpr uint64_t gen_mask = 0xFFFFFFFF00000000u;
+        static constexpr uint64_t gen_shift = 32;
+
+        job() : value(-1) {}
+        job(uint64_t generation, uint64_t id) : value((id & id_mask) | ((generation & 0xFFFFFFFFu) << gen_shift)) {}
+
+        uint32_t id() const {
+            return value & id_mask;
+        }
+
+        uint32_t gen() const {
+            return (value & gen_mask) >> gen_shift;
+        }
+
+        bool operator==(job other) const {
+            return value == other.value;
+        }
+    };
+
+    enum struct Priority {
+        High,
+        Normal,
+        // io and other background work that shouldn't hold up anything else
+        Low,
+    };
+
+    using JobFn = std::function<void()>;
+
+    // one scheduler is shared by the whole engine, its workers are started on first use and leave one core
+    // for the main thread
+    uint32_t worker_count();
+
+    // `fn` runs once every job in `dependencies` is done, finished or invalid jobs count as done
+    job submit(JobFn fn, Priority priority = Priority::Normal, std::span<const job> dependencies = {});
+
+    bool is_done(job job);
+    // runs other jobs while it waits, so it can be called from inside a job too. outside of the workers it leaves
+    // `Priority::Low` jobs alone, those can block on the main thread
+    void wait(job job);
+    void wait(std::span<const job> jobs);
+
+    // calls `fn(begin, end)` on ranges of at most `grain` items covering [0, `count`) and returns once all of them
+    // finished, the calling thread takes part
+    void parallel_for(uint32_t count, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& fn,
+                      Priority priority = Priority::Normal);
+}
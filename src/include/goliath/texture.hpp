@@ -36,10 +36,20 @@ namespace engine {
         void get_format();
     };
 
+    // a single mip level with its own ticket, either from `data` or from a staging reservation
+    struct GPUImageLevel {
+        uint32_t mip;
+        void* data = nullptr;
+        std::optional<transport2::FreeFn*> own = std::nullopt;
+        std::optional<transport2::Reservation> staged = std::nullopt;
+        transport2::ticket* ticket;
+    };
+
     struct GPUImageInfo {
         VkImageCreateInfo _image_info{};
         void* _img_data = nullptr;
         std::optional<transport2::FreeFn*> _own_data = std::nullopt;
+        std::optional<transport2::Reservation> _staged = std::nullopt;
         bool _priority = false;
         transport2::ticket* _ticket;
         uint32_t _width = 0;
@@ -47,6 +57,7 @@ namespace engine {
         uint32_t _size = 0;
         VkImageLayout _new_image_layout = VK_IMAGE_LAYOUT_UNDEFINED;
         VkImageAspectFlags _aspect_mask = VK_IMAGE_ASPECT_COLOR_BIT;
+        std::vector<GPUImageLevel> _levels{};
 
         GPUImageInfo() {
             _image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -130,6 +141,37 @@ namespace engine {
             return std::move(*this);
         }
 
+        GPUImageInfo&& staged(transport2::Reservation reservation, transport2::ticket& ticket, bool priority) {
+            _priority = priority;
+            _ticket = &ticket;
+            _staged = reservation;
+            return std::move(*this);
+        }
+
+        // levels are uploaded in the order they're added, each one becomes usable as soon as its ticket is ready
+        GPUImageInfo&& level(uint32_t mip, void* ptr, std::optional<transport2::FreeFn*> own,
+                             transport2::ticket& ticket, bool priority) {
+            _priority = priority;
+            _levels.emplace_back(GPUImageLevel{
+                .mip = mip,
+                .data = ptr,
+                .own = own,
+                .ticket = &ticket,
+            });
+            return std::move(*this);
+        }
+
+        GPUImageInfo&& level(uint32_t mip, transport2::Reservation reservation, transport2::ticket& ticket,
+                             bool priority) {
+            _priority = priority;
+            _levels.emplace_back(GPUImageLevel{
+                .mip = mip,
+                .staged = reservation,
+                .ticket = &ticket,
+            });
+            return std::move(*this);
+        }
+
         GPUImageInfo&& width(uint32_t width) {
             _width = width;
             _image_info.extent.width = width;
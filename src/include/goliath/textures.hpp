@@ -51,6 +51,30 @@ namespace engine {
             gid gid;
         };
 
+        // the registry json and its slots, which ids are taken, under which generation and with which sampler.
+        // slot 0 is the default texture and never gets written out. goliath-cook keeps one to hand out gids
+        // without a GPU
+        struct Registry {
+            std::vector<std::string> names{"Default texture"};
+            std::vector<uint8_t> generations{0};
+            std::vector<bool> deleted{false};
+            // ids of the deleted slots, reused last in first out
+            std::vector<uint32_t> free_ids{};
+            std::vector<Sampler> sampler_prototypes{Sampler{}};
+
+            void load(const nlohmann::json& j);
+            nlohmann::json save() const;
+
+            // takes the last freed slot with its generation bumped, or a new one at the end
+            Textures::gid alloc(std::string name, Sampler sampler);
+            bool free(Textures::gid gid);
+            bool is_alive(Textures::gid gid) const;
+
+            uint32_t size() const {
+                return names.size();
+            }
+        };
+
         ~Textures();
 
         static Textures* make(const char* textures_directry, size_t texture_capacity = 1000) {
@@ -61,10 +85,15 @@ namespace engine {
         nlohmann::json save() const;
 
         gid add(std::filesystem::path path, std::string name, Sampler sampler);
+        // `image` holds `mip_levels` tightly packed levels, smallest one first
         gid add(std::span<uint8_t> image, uint32_t width, uint32_t height, VkFormat format, std::string name,
-                Sampler sampler);
+                Sampler sampler, uint32_t mip_levels = 1);
         bool remove(gid gid);
 
+        // writes the .goi `add` would without touching the GPU, `image` is laid out the same way
+        static void write(const std::filesystem::path& path, std::span<const uint8_t> image, uint32_t width,
+                          uint32_t height, VkFormat format, uint32_t mip_levels = 1);
+
         std::expected<std::string*, textures::Err> get_name(gid gid);
         std::expected<VkImage, textures::Err> get_image(gid gid);
         std::expected<VkImageView, textures::Err> get_image_view(gid gid);
@@ -94,30 +123,38 @@ namespace engine {
 
         TexturePool texture_pool;
 
-        std::vector<std::string> names{};
-        std::vector<uint8_t> generations{};
-        std::vector<bool> deleted{};
+        Registry registry{};
 
         std::vector<uint32_t> ref_counts{};
         std::vector<GPUImage> gpu_images{};
         std::vector<VkImageView> gpu_image_views{};
-        std::vector<Sampler> sampler_prototypes{};
         std::vector<VkSampler> samplers{};
 
-        std::deque<std::pair<transport2::ticket, Textures::gid>> finalize_queue{};
+        // a mip level on its way to the GPU, once it lands the texture's view is widened down to it
+        struct PendingLevel {
+            transport2::ticket ticket;
+            Textures::gid gid;
+            VkImage image;
+            uint32_t mip;
+            uint32_t mip_levels;
+        };
+        std::deque<PendingLevel> finalize_queue{};
 
-        std::optional<Textures::gid> find_empty_gid() {
-            for (uint32_t i = 0; i < deleted.size(); i++) {
-                if (deleted[i]) {
-                    return gid{generations[i], i};
-                }
-            }
+        // a view the texture pool bound before a more detailed level landed, the frames still in flight may use it
+        struct RetiredView {
+            // `upload_frame` it can be destroyed at
+            uint64_t frame;
+            VkImageView view;
+        };
+        std::deque<RetiredView> retired_views{};
+        // counts `process_uploads` calls, which happen once a frame
+        uint64_t upload_frame = 0;
 
-            return std::nullopt;
-        }
+        // `registry.alloc` plus the slot's GPU side, growing the texture pool when the slot is a new one
+        Textures::gid new_gid(std::string name, Sampler sampler);
 
         void set_default_texture(gid gid) {
-            if (generations[gid.id()] != gid.gen()) return;
+            if (registry.generations[gid.id()] != gid.gen()) return;
 
             texture_pool.update(gid.id(), gpu_image_views[0], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, samplers[0]);
         }
@@ -130,4 +167,7 @@ namespace engine {
 
     void to_json(nlohmann::json& j, const Textures::gid& gid);
     void from_json(const nlohmann::json& j, Textures::gid& gid);
+
+    // file name of `gid`'s .goi inside the textures directory
+    std::filesystem::path make_texture_path(Textures::gid gid);
 }
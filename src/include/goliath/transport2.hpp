@@ -29,6 +29,26 @@ namespace engine::transport2 {
         }
     };
 
+    enum struct IdleMode {
+        // keeps the worker spinning on `_mm_pause`, lowest latency but pins a core
+        Spin,
+        // spins for `spin_count` iterations and then parks the worker until `upload` wakes it up
+        Park,
+    };
+
+    struct Config {
+        IdleMode idle_mode = IdleMode::Park;
+        uint32_t spin_count = 4096;
+
+        // size of the persistently mapped staging ring all uploads are sub-allocated from
+        uint32_t staging_arena_size = 32 * 1024 * 1024;
+        // how many batches can be submitted before the worker has to wait for the oldest one to finish,
+        // a single batch never takes more than `staging_arena_size / max_in_flight` bytes of the arena
+        uint32_t max_in_flight = 4;
+    };
+
+    void set_idle_mode(IdleMode mode, uint32_t spin_count);
+
     bool is_ready(ticket ticket);
 
     VkSemaphoreSubmitInfo wait_on(std::span<ticket> tickets);
@@ -37,9 +57,50 @@ namespace engine::transport2 {
 
     ticket upload(bool priority, void* src, std::optional<FreeFn*> own, uint32_t size, VkBuffer dst, uint32_t dst_offset, VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access);
 
+    struct BufferUpload {
+        void* src;
+        std::optional<FreeFn*> own;
+        uint32_t size;
+        VkBuffer dst;
+        uint32_t dst_offset;
+        VkPipelineStageFlags2 dst_stage;
+        VkAccessFlags2 dst_access;
+    };
+
+    // submits all of `uploads` in one go, `tickets` receives a ticket per upload and has to be at least as big
+    void upload(bool priority, std::span<const BufferUpload> uploads, std::span<ticket> tickets);
+
     ticket upload(bool priority, VkFormat format, VkExtent3D dimension, void* src, std::optional<FreeFn*> own, VkImage dst,
                   VkImageSubresourceLayers dst_layers, VkOffset3D dst_offset, VkImageLayout current_layout, VkImageLayout dst_layout, VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access);
 
+    // a range of the staging arena the caller writes the upload data into directly, skipping the copy `upload` does
+    struct Reservation {
+        uint8_t* data;
+        uint32_t offset;
+        uint32_t size;
+        uint64_t allocation;
+    };
+
+    // blocks until `size` contiguous bytes of the staging arena are free, with `wait` unset it returns std::nullopt
+    // instead, as it does when `size` is bigger than the whole arena
+    // every reservation has to be handed to `upload` or `release`, holding on to one stalls the arena, so threads
+    // that submit other threads' reservations (like the main thread) shouldn't wait
+    std::optional<Reservation> reserve(uint32_t size, uint32_t alignment = 16, bool wait = true);
+    void release(Reservation reservation);
+
+    // the alignment `reserve` needs for image data of `format`
+    uint32_t image_alignment(VkFormat format);
+    // byte size of a tightly packed `width`x`height` image of `format`, block compressed formats round up to whole blocks
+    uint32_t image_size(VkFormat format, uint32_t width, uint32_t height);
+
+    ticket upload(bool priority, Reservation src, VkBuffer dst, uint32_t dst_offset, VkPipelineStageFlags2 dst_stage,
+                  VkAccessFlags2 dst_access);
+
+    // layers are expected to be tightly packed one after another in `src`
+    ticket upload(bool priority, VkFormat format, VkExtent3D dimension, Reservation src, VkImage dst,
+                  VkImageSubresourceLayers dst_layers, VkOffset3D dst_offset, VkImageLayout current_layout,
+                  VkImageLayout dst_layout, VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access);
+
     void unqueue(ticket t, bool free = false);
 
     uint64_t get_timeline();
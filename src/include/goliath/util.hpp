@@ -65,6 +65,16 @@ namespace engine::util {
     uint8_t* read_file(const std::filesystem::path& path, uint32_t* size);
     void save_file(const std::filesystem::path& path, uint8_t* data, uint32_t size);
 
+    // a private copy-on-write mapping, writes through `data` never reach the file
+    struct MappedFile {
+        uint8_t* data = nullptr;
+        uint64_t size = 0;
+        void* _handle = nullptr;
+    };
+
+    std::optional<MappedFile> map_file(const std::filesystem::path& path);
+    void unmap_file(MappedFile& file);
+
     enum struct ReadJsonErr {
         ParseErr,
         FileErr,
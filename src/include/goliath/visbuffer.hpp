@@ -27,11 +27,11 @@ namespace engine {
         std::array<GPUImage, frames_in_flight> images;
         std::array<VkImageView, frames_in_flight> image_views;
 
-        RenderingAttachement attach(uint32_t current_frame) {
+        RenderingAttachement attach(uint32_t current_frame, LoadOp load_op = LoadOp::Clear) {
             return RenderingAttachement{}
                 .set_image(image_views[current_frame % frames_in_flight], VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL)
                 .set_clear_color(glm::vec4{0.0f})
-                .set_load_op(LoadOp::Clear)
+                .set_load_op(load_op)
                 .set_store_op(StoreOp::Store);
         }
     };
@@ -14,6 +14,7 @@ namespace engine::vma_ptrs {
     void destroy_image(VkImage img, VmaAllocation alloc);
 
     void flush_alloc(VmaAllocation alloc, VkDeviceSize offset, VkDeviceSize size);
+    void invalidate_alloc(VmaAllocation alloc, VkDeviceSize offset, VkDeviceSize size);
     void set_name(VmaAllocation alloc, const char* name);
     void get_memory_type_properties(uint32_t mem_type, VkMemoryPropertyFlags* flags);
 
@@ -2,6 +2,7 @@
 #include "goliath/buffer.hpp"
 #include "goliath/transport2.hpp"
 
+#include <algorithm>
 #include <optional>
 #include <vulkan/vulkan_core.h>
 
@@ -22,17 +23,19 @@ namespace engine {
         std::vector<nlohmann::json> arr = j;
 
         for (const auto& j : arr) {
-            auto mat_ix = j["ix"];
-            if (j.contains("deleted")) {
-                ms->deleted.emplace_back(mat_ix);
-                continue;
-            }
-
+            uint32_t mat_ix = j["ix"];
             while (ms->names.size() <= mat_ix) {
                 ms->names.emplace_back();
                 ms->schemas.emplace_back();
                 ms->offsets.emplace_back();
                 ms->instances.emplace_back();
+                ms->schema_deleted.emplace_back(false);
+            }
+
+            if (j.contains("deleted")) {
+                ms->deleted.emplace_back(mat_ix);
+                ms->schema_deleted[mat_ix] = true;
+                continue;
             }
 
             ms->names[mat_ix] = j["name"];
@@ -54,6 +57,7 @@ namespace engine {
                 insts.generations[inst_ix] = j["gen"];
                 if (j.contains("deleted")) {
                     insts.deleted[inst_ix] = true;
+                    insts.free_ids.emplace_back(inst_ix);
                 } else {
                     insts.names[inst_ix] = j["name"];
                     insts.ref_counts[inst_ix] = j["ref_count"];
@@ -65,7 +69,8 @@ namespace engine {
             }
         }
 
-        ms->update = true;
+        ms->recompute_offsets();
+        ms->mark_layout_changed();
 
         return ms;
     }
@@ -101,6 +106,7 @@ namespace engine {
                         {"gen", insts.generations[j]},
                         {"deleted", true},
                     });
+                    continue;
                 }
 
                 insts_j.emplace_back(nlohmann::json{
@@ -144,31 +150,78 @@ namespace engine {
             next_buffer_ticket = {};
         }
 
+        upload_stats.frame_bytes = 0;
+        upload_stats.frame_ranges = 0;
+        upload_stats.frame_full_upload = false;
+
         if (!update) {
             return;
         }
 
+        auto back_buffer = (current_buffer + 1) % 2;
+        auto& buf = gpu_buffers[back_buffer];
+
         uint32_t instances_size = 0;
         for (size_t i = 0; i < instances.size(); i++) {
             instances_size += schemas[i].total_size * instances[i].names.size();
         }
 
-        auto upload_size = sizeof(uint32_t) + offsets.size() * sizeof(uint32_t) + instances_size;
-        auto upload = (uint8_t*)malloc(upload_size);
+        auto upload_size = header_size() + instances_size;
+        if (buf.size() < upload_size) full_upload[back_buffer] = true;
+
+        if (!full_upload[back_buffer]) {
+            auto& ranges = dirty_ranges[back_buffer];
+            std::sort(ranges.begin(), ranges.end(), [](auto a, auto b) { return a.offset < b.offset; });
+
+            // neighbouring instances are cheaper to upload as one range than as many tiny copies
+            static constexpr uint32_t merge_gap = 256;
+            std::vector<DirtyRange> merged{};
+            for (auto range : ranges) {
+                if (!merged.empty() && range.offset <= merged.back().offset + merged.back().size + merge_gap) {
+                    auto end = std::max(merged.back().offset + merged.back().size, range.offset + range.size);
+                    merged.back().size = end - merged.back().offset;
+                } else {
+                    merged.emplace_back(range);
+                }
+            }
+            ranges.clear();
+
+            std::vector<transport2::BufferUpload> uploads{};
+            for (auto range : merged) {
+                if (range.offset >= upload_size) continue;
+                auto size = std::min(range.size, upload_size - range.offset);
+
+                auto* data = (uint8_t*)malloc(size);
+                write_contents(data, range.offset, size);
+                uploads.emplace_back(transport2::BufferUpload{
+                    .src = data,
+                    .own = free,
+                    .size = size,
+                    .dst = buf,
+                    .dst_offset = range.offset,
+                    .dst_stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                    .dst_access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+                });
 
-        uint32_t off = 0;
-        auto offsets_size = offsets.size();
-        std::memcpy(upload, &offsets_size, sizeof(uint32_t));
-        off += sizeof(uint32_t);
+                upload_stats.frame_bytes += size;
+            }
 
-        std::memcpy(upload + off, offsets.data(), offsets_size * sizeof(uint32_t));
-        off += offsets_size * sizeof(uint32_t);
+            if (!uploads.empty()) {
+                std::vector<transport2::ticket> tickets(uploads.size());
+                transport2::upload(true, uploads, tickets);
+                next_buffer_ticket = tickets.back();
+            }
 
-        for (size_t i = 0; i < instances.size(); i++) {
-            std::memcpy(upload + off + offsets[i], instances[i].data.data(), instances[i].data.size());
+            upload_stats.frame_ranges = uploads.size();
+            upload_stats.total_bytes += upload_stats.frame_bytes;
+            update = false;
+            return;
         }
 
-        auto& buf = gpu_buffers[(current_buffer + 1) % 2];
+        auto reservation = transport2::reserve((uint32_t)upload_size, 16, false);
+        auto upload = reservation ? reservation->data : (uint8_t*)malloc(upload_size);
+        write_contents(upload, 0, upload_size);
+
         if (buf.size() < upload_size) {
             buf.destroy();
             buf =
@@ -176,13 +229,79 @@ namespace engine {
                                VK_BUFFER_USAGE_2_TRANSFER_DST_BIT | VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT, std::nullopt);
         }
 
-        next_buffer_ticket =
-            transport2::upload(true, upload, free, upload_size, gpu_buffers[(current_buffer + 1) % 2], 0,
-                               VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+        if (reservation) {
+            next_buffer_ticket =
+                transport2::upload(true, *reservation, buf, 0,
+                                   VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+        } else {
+            next_buffer_ticket =
+                transport2::upload(true, upload, free, upload_size, buf, 0,
+                                   VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+        }
+
+        full_upload[back_buffer] = false;
+        dirty_ranges[back_buffer].clear();
+
+        upload_stats.frame_bytes = upload_size;
+        upload_stats.frame_ranges = 1;
+        upload_stats.frame_full_upload = true;
+        upload_stats.total_bytes += upload_size;
 
         update = false;
     }
 
+    void Materials::write_contents(uint8_t* out, uint32_t offset, uint32_t size) const {
+        std::memset(out, 0, size);
+        auto end = offset + size;
+
+        auto copy = [&](uint32_t start, const uint8_t* src, uint32_t src_size) {
+            auto from = std::max(offset, start);
+            auto to = std::min(end, start + src_size);
+            if (from >= to) return;
+
+            std::memcpy(out + (from - offset), src + (from - start), to - from);
+        };
+
+        auto offsets_size = (uint32_t)offsets.size();
+        copy(0, (const uint8_t*)&offsets_size, sizeof(uint32_t));
+        copy(sizeof(uint32_t), (const uint8_t*)offsets.data(), offsets_size * sizeof(uint32_t));
+
+        for (size_t i = 0; i < instances.size(); i++) {
+            copy(header_size() + offsets[i], instances[i].data.data(), instances[i].data.size());
+        }
+    }
+
+    void Materials::recompute_offsets() {
+        uint32_t offset = 0;
+        for (size_t i = 0; i < offsets.size(); i++) {
+            offsets[i] = offset;
+            offset += instances[i].data.size();
+        }
+    }
+
+    void Materials::mark_layout_changed() {
+        full_upload = {true, true};
+        for (auto& ranges : dirty_ranges) {
+            ranges.clear();
+        }
+
+        update = true;
+    }
+
+    void Materials::mark_instance_dirty(uint32_t mat_id, uint32_t inst_id) {
+        auto size = schemas[mat_id].total_size;
+        auto range = DirtyRange{
+            .offset = header_size() + offsets[mat_id] + size * inst_id,
+            .size = size,
+        };
+
+        for (uint32_t b = 0; b < dirty_ranges.size(); b++) {
+            if (!full_upload[b]) dirty_ranges[b].emplace_back(range);
+        }
+
+        update = true;
+    }
+
     uint32_t Materials::add_schema(Material schema, std::string name) {
         std::lock_guard lock{mutex};
 
@@ -190,21 +309,23 @@ namespace engine {
         if (deleted.empty()) {
             names.emplace_back(name);
             schemas.emplace_back(schema);
-            offsets.emplace_back(offsets.back());
+            offsets.emplace_back(offsets.empty() ? 0 : offsets.back() + instances.back().data.size());
             instances.emplace_back();
+            schema_deleted.emplace_back(false);
 
             mat_id = names.size() - 1;
         } else {
             mat_id = deleted.back();
             deleted.pop_back();
 
+            // a deleted schema has no instances, so its offset is still where its instances go
             names[mat_id] = name;
             schemas[mat_id] = schema;
-            offsets[mat_id] = mat_id == 0 ? 0 : offsets[mat_id - 1];
             instances[mat_id] = {};
+            schema_deleted[mat_id] = false;
         }
 
-        update = true;
+        mark_layout_changed();
         want_save = true;
 
         return mat_id;
@@ -228,9 +349,12 @@ namespace engine {
 
         names[mat_id] = "";
         schemas[mat_id] = {};
+        instances[mat_id] = {};
 
         deleted.emplace_back(mat_id);
+        schema_deleted[mat_id] = true;
 
+        mark_layout_changed();
         want_save = true;
         return true;
     }
@@ -272,7 +396,7 @@ namespace engine {
         if (insts.generations[gid.id()] != gid.gen()) return;
         std::memcpy(insts.data.data() + size * gid.id(), new_data, size);
 
-        update = true;
+        mark_instance_dirty(gid.dim(), gid.id());
         want_save = true;
     }
 
@@ -285,11 +409,13 @@ namespace engine {
         auto& insts = instances[mat_id];
 
         uint32_t id = -1;
-        for (uint32_t i = 0; i < insts.deleted.size(); i++) {
-            if (insts.deleted[i]) id = i;
+        if (!insts.free_ids.empty()) {
+            id = insts.free_ids.back();
+            insts.free_ids.pop_back();
         }
 
-        if (id == -1) {
+        bool reused = id != -1;
+        if (!reused) {
             insts.deleted.emplace_back(false);
             insts.generations.emplace_back(0);
             insts.names.emplace_back(name);
@@ -317,12 +443,17 @@ namespace engine {
             }
         }
 
-        for (uint32_t i = mat_id + 1; i < schemas.size(); i++) {
-            offsets[i] += schema->total_size;
+        if (!reused) {
+            // a new slot moves every later schema's instances
+            for (uint32_t i = mat_id + 1; i < schemas.size(); i++) {
+                offsets[i] += schema->total_size;
+            }
+            mark_layout_changed();
+        } else {
+            mark_instance_dirty(mat_id, id);
         }
 
         want_save = true;
-        update = true;
         return {mat_id, insts.generations[id], id};
     }
 
@@ -336,14 +467,18 @@ namespace engine {
         if (insts.generations.size() <= gid.id()) return false;
         if (insts.generations[gid.id()] != gid.gen()) return false;
 
-        auto begin = insts.data.begin() + schema->total_size * gid.id();
-        insts.data.erase(begin, begin + schema->total_size);
+        if (insts.deleted[gid.id()]) return false;
+
+        // the slot keeps its space so no other instance moves
+        std::memset(insts.data.data() + schema->total_size * gid.id(), 0, schema->total_size);
 
         insts.generations[gid.id()]++;
         insts.deleted[gid.id()] = true;
         insts.names[gid.id()] = "";
         insts.ref_counts[gid.id()] = 0;
+        insts.free_ids.emplace_back(gid.id());
 
+        mark_instance_dirty(gid.dim(), gid.id());
         want_save = true;
         return true;
     }
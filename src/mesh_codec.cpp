@@ -0,0 +1,176 @@
+#include "mesh_codec_.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace engine::mesh_codec {
+    static constexpr uint32_t group_size = 16;
+    // every header byte holds the 2 bit widths of this many groups
+    static constexpr uint32_t groups_per_header = 4;
+
+    uint32_t zigzag(uint32_t delta) {
+        return (delta << 1) ^ (uint32_t)((int32_t)delta >> 31);
+    }
+
+    uint32_t unzigzag(uint32_t value) {
+        return (value >> 1) ^ (0u - (value & 1));
+    }
+
+    void encode_indices(std::vector<uint8_t>& out, std::span<const uint32_t> indices) {
+        uint32_t last = 0;
+        for (auto index : indices) {
+            auto value = zigzag(index - last);
+            last = index;
+
+            while (value >= 0x80) {
+                out.emplace_back((uint8_t)(value | 0x80));
+                value >>= 7;
+            }
+            out.emplace_back((uint8_t)value);
+        }
+    }
+
+    bool decode_indices(std::span<uint32_t> out, std::span<const uint8_t> data) {
+        std::size_t off = 0;
+        uint32_t last = 0;
+        for (auto& index : out) {
+            uint32_t value = 0;
+            for (uint32_t shift = 0;; shift += 7) {
+                if (off == data.size() || shift > 28) return false;
+
+                auto byte = data[off++];
+                value |= (uint32_t)(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0) break;
+            }
+
+            last += unzigzag(value);
+            index = last;
+        }
+
+        return true;
+    }
+
+    // 0, 2, 4 or 8 bits per byte
+    uint32_t group_bits(uint32_t mode) {
+        return mode == 0 ? 0 : 1u << mode;
+    }
+
+    void encode_plane(std::vector<uint8_t>& out, std::span<const uint8_t> plane) {
+        auto group_count = (uint32_t)((plane.size() + group_size - 1) / group_size);
+
+        for (uint32_t first = 0; first < group_count; first += groups_per_header) {
+            auto header_at = out.size();
+            out.emplace_back(0);
+
+            for (uint32_t g = first; g < first + groups_per_header && g < group_count; g++) {
+                uint8_t group[group_size]{};
+                auto begin = g * group_size;
+                auto count = std::min<std::size_t>(group_size, plane.size() - begin);
+                std::memcpy(group, plane.data() + begin, count);
+
+                uint8_t max = 0;
+                for (auto byte : group) max |= byte;
+
+                uint32_t mode = max == 0 ? 0 : max < 4 ? 1 : max < 16 ? 2 : 3;
+                out[header_at] |= (uint8_t)(mode << ((g - first) * 2));
+
+                auto bits = group_bits(mode);
+                if (bits == 0) continue;
+
+                auto per_byte = 8 / bits;
+                for (uint32_t i = 0; i < group_size; i += per_byte) {
+                    uint8_t packed = 0;
+                    for (uint32_t b = 0; b < per_byte; b++) {
+                        packed |= (uint8_t)(group[i + b] << (b * bits));
+                    }
+                    out.emplace_back(packed);
+                }
+            }
+        }
+    }
+
+    bool decode_plane(std::span<uint8_t> plane, std::span<const uint8_t> data, std::size_t& off) {
+        auto group_count = (uint32_t)((plane.size() + group_size - 1) / group_size);
+
+        for (uint32_t first = 0; first < group_count; first += groups_per_header) {
+            if (off == data.size()) return false;
+            auto header = data[off++];
+
+            for (uint32_t g = first; g < first + groups_per_header && g < group_count; g++) {
+                uint8_t group[group_size]{};
+
+                auto bits = group_bits((header >> ((g - first) * 2)) & 3);
+                if (bits != 0) {
+                    auto per_byte = 8 / bits;
+                    if (data.size() - off < group_size / per_byte) return false;
+
+                    uint8_t mask = (uint8_t)((1u << bits) - 1);
+                    for (uint32_t i = 0; i < group_size; i += per_byte) {
+                        auto packed = data[off++];
+                        for (uint32_t b = 0; b < per_byte; b++) {
+                            group[i + b] = (uint8_t)((packed >> (b * bits)) & mask);
+                        }
+                    }
+                }
+
+                auto begin = g * group_size;
+                auto count = std::min<std::size_t>(group_size, plane.size() - begin);
+                std::memcpy(plane.data() + begin, group, count);
+            }
+        }
+
+        return true;
+    }
+
+    void encode_vertices(std::vector<uint8_t>& out, const void* vertices, uint32_t count, uint32_t size) {
+        assert(size % 4 == 0);
+
+        const auto* bytes = (const uint8_t*)vertices;
+        std::vector<uint32_t> deltas(count);
+        std::vector<uint8_t> plane(count);
+        for (uint32_t word = 0; word < size / 4; word++) {
+            uint32_t last = 0;
+            for (uint32_t v = 0; v < count; v++) {
+                uint32_t value;
+                std::memcpy(&value, bytes + v * size + word * 4, sizeof(uint32_t));
+                deltas[v] = zigzag(value - last);
+                last = value;
+            }
+
+            for (uint32_t byte = 0; byte < 4; byte++) {
+                for (uint32_t v = 0; v < count; v++) {
+                    plane[v] = (uint8_t)(deltas[v] >> (byte * 8));
+                }
+                encode_plane(out, plane);
+            }
+        }
+    }
+
+    bool decode_vertices(void* out, uint32_t count, uint32_t size, std::span<const uint8_t> data) {
+        assert(size % 4 == 0);
+
+        auto* bytes = (uint8_t*)out;
+        std::vector<uint32_t> deltas(count);
+        std::vector<uint8_t> plane(count);
+        std::size_t off = 0;
+        for (uint32_t word = 0; word < size / 4; word++) {
+            std::fill(deltas.begin(), deltas.end(), 0);
+            for (uint32_t byte = 0; byte < 4; byte++) {
+                if (!decode_plane(plane, data, off)) return false;
+
+                for (uint32_t v = 0; v < count; v++) {
+                    deltas[v] |= (uint32_t)plane[v] << (byte * 8);
+                }
+            }
+
+            uint32_t last = 0;
+            for (uint32_t v = 0; v < count; v++) {
+                last += unzigzag(deltas[v]);
+                std::memcpy(bytes + v * size + word * 4, &last, sizeof(uint32_t));
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// lossless encodings for the arrays a .gom keeps next to the GPU data, decoded once on load so they only cost disk
+namespace engine::mesh_codec {
+    // zigzag varint deltas between consecutive indices, after the vertex fetch reorder most take a single byte
+    void encode_indices(std::vector<uint8_t>& out, std::span<const uint32_t> indices);
+    // returns false if `data` runs out before `out` is filled
+    bool decode_indices(std::span<uint32_t> out, std::span<const uint8_t> data);
+
+    // every 32 bit word is delta encoded against the same word of the vertex before, the deltas get split into byte
+    // planes and every 16 bytes of a plane are bit packed to the widest value in them. `size` has to be a multiple
+    // of 4
+    void encode_vertices(std::vector<uint8_t>& out, const void* vertices, uint32_t count, uint32_t size);
+    // returns false if `data` runs out before all `count` vertices are decoded
+    bool decode_vertices(void* out, uint32_t count, uint32_t size, std::span<const uint8_t> data);
+}
@@ -5,98 +5,506 @@
 #include "goliath/materials.hpp"
 #include "goliath/models.hpp"
 #include "goliath/rendering.hpp"
+#include "mesh_codec_.hpp"
 
+#include "xxHash/xxhash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/packing.hpp>
+#include <glm/vector_relational.hpp>
 #include <utility>
+#include <vector>
 #include <volk.h>
 
-namespace engine {
-    uint32_t Mesh::get_optimized_size() const {
-        uint32_t total_size = sizeof(Materials::gid) + sizeof(engine::Topology) + sizeof(uint32_t) +
-                              sizeof(uint32_t) + sizeof(bool) + sizeof(collisions::AABB) +
-                              (2 + texcoords.size()) * sizeof(bool);
-
-        if (indices != nullptr) total_size += index_count * sizeof(uint32_t);
-        if (positions != nullptr) total_size += vertex_count * sizeof(glm::vec3);
-        if (normals != nullptr) total_size += vertex_count * sizeof(glm::vec3);
-        if (tangents != nullptr) total_size += (indexed_tangents ? vertex_count : index_count) * sizeof(glm::vec4);
-        for (std::size_t i = 0; i < texcoords.size(); i++) {
-            if (texcoords[i] != nullptr) total_size += vertex_count * sizeof(glm::vec2);
+namespace engine::gom {
+    // a .gom is `Header`, the `MeshEntry` table and then every array, each section aligned to
+    // `section_alignment` so the file can be used in place once mapped. offsets are from the start of the file and
+    // 0 marks a missing array. every mesh stores its interleaved GPU data ready to be copied into the upload
+    // v3 appended the lod chain, v4 the meshlets and v5 the vertex encoding to `MeshEntry`, older files are still
+    // read with their shorter entries. since v6 only the GPU data is stored as is, the rest goes through
+    // `mesh_codec` and only `Model::load` decodes it. a mapped model keeps pointing at the encoded arrays and saves
+    // them back unchanged
+    static constexpr uint32_t magic = 0x324D4F47; // "GOM2"
+    static constexpr uint32_t version = 6;
+    static constexpr uint32_t oldest_version = 2;
+    static constexpr uint32_t encoded_version = 6;
+    static constexpr uint64_t section_alignment = 16;
+
+    struct alignas(16) Header {
+        uint32_t magic;
+        uint32_t version;
+        // XXH3 of everything after the header
+        uint64_t checksum = 0;
+        uint64_t file_size = 0;
+
+        collisions::AABB bounding_box;
+        uint32_t mesh_count;
+        uint32_t mesh_indices_count;
+
+        uint64_t meshes_offset = 0;
+        uint64_t mesh_indexes_offset = 0;
+        uint64_t mesh_transforms_offset = 0;
+    };
+
+    struct alignas(16) MeshEntry {
+        Materials::gid material_instance;
+        Topology vertex_topology;
+        uint32_t index_count;
+        uint32_t vertex_count;
+        uint32_t indexed_tangents;
+        collisions::AABB bounding_box;
+
+        uint64_t gpu_data_offset = 0;
+        uint64_t gpu_data_size = 0;
+
+        uint64_t indices_offset = 0;
+        uint64_t positions_offset = 0;
+        uint64_t normals_offset = 0;
+        uint64_t tangents_offset = 0;
+        std::array<uint64_t, 4> texcoords_offset{};
+
+        // the lod indices follow `indices` inside the GPU data
+        uint32_t lod_count = 0;
+        uint32_t lod_index_count = 0;
+        std::array<model::MeshLod, model::max_lod_count> lods{};
+
+        // the meshlets follow the lod indices inside the GPU data
+        uint64_t meshlets_offset = 0;
+        uint32_t meshlet_count = 0;
+
+        uint32_t compact_vertices = 0;
+
+        // `start` is 0
+        model::GPUOffset gpu_offset{};
+    };
+
+    // the arrays of a mesh besides its GPU data, as they're stored in the file
+    struct EncodedMesh {
+        // the lod indices follow the indices
+        std::vector<uint8_t> indices{};
+        std::vector<uint8_t> positions{};
+        std::vector<uint8_t> normals{};
+        std::vector<uint8_t> tangents{};
+        std::array<std::vector<uint8_t>, 4> texcoords{};
+    };
+
+    constexpr uint64_t align_section(uint64_t offset) {
+        return (offset + section_alignment - 1) & ~(section_alignment - 1);
+    }
+
+    // bytes of `MeshEntry` a file of `file_version` stores, its entries are `align_section` of it apart
+    uint64_t mesh_entry_size(uint32_t file_version) {
+        switch (file_version) {
+            case 2: return offsetof(MeshEntry, lod_count);
+            case 3: return offsetof(MeshEntry, meshlets_offset);
+            case 4: return offsetof(MeshEntry, compact_vertices);
+            case 5: return offsetof(MeshEntry, gpu_offset);
+            default: return sizeof(MeshEntry);
         }
+    }
 
-        return total_size;
+    // places every section of `model`, fills in `header`, `entries` and `encoded` and returns the file size
+    uint64_t layout(const Model& model, Header& header, std::span<MeshEntry> entries,
+                    std::span<EncodedMesh> encoded) {
+        uint64_t off = sizeof(Header);
+        auto place = [&](uint64_t size) {
+            off = align_section(off);
+            auto at = off;
+            off += size;
+            return at;
+        };
+
+        header = Header{
+            .magic = magic,
+            .version = version,
+            .bounding_box = model.bounding_box,
+            .mesh_count = model.mesh_count,
+            .mesh_indices_count = model.mesh_indices_count,
+        };
+        header.meshes_offset = place(model.mesh_count * sizeof(MeshEntry));
+        header.mesh_indexes_offset = place(model.mesh_indices_count * sizeof(uint32_t));
+        header.mesh_transforms_offset = place(model.mesh_indices_count * sizeof(glm::mat4));
+
+        for (uint32_t i = 0; i < model.mesh_count; i++) {
+            const auto& mesh = model.meshes[i];
+            auto& entry = entries[i];
+            auto& enc = encoded[i];
+
+            entry = MeshEntry{
+                .material_instance = mesh.material_instance,
+                .vertex_topology = mesh.vertex_topology,
+                .index_count = mesh.index_count,
+                .vertex_count = mesh.vertex_count,
+                .indexed_tangents = mesh.indexed_tangents,
+                .bounding_box = mesh.bounding_box,
+                .lod_count = mesh.lod_count,
+                .lod_index_count = mesh.lod_index_count,
+                .lods = mesh.lods,
+                .meshlet_count = mesh.meshlet_count,
+                .compact_vertices = mesh.compact_vertices,
+            };
+
+            uint32_t gpu_data_size;
+            entry.gpu_offset = mesh.calc_offset(0, &gpu_data_size);
+            entry.gpu_data_offset = place(gpu_data_size);
+            entry.gpu_data_size = gpu_data_size;
+
+            // the meshlets are stored as is inside the GPU data, so they aren't stored twice
+            if (mesh.meshlets != nullptr) {
+                entry.meshlets_offset =
+                    entry.gpu_data_offset + entry.gpu_offset.indices_offset + mesh.gpu_indices_size();
+            }
+
+            // a mapped mesh has no arrays to encode, its encoded ones are copied over from the mapping instead
+            auto place_encoded = [&](std::vector<uint8_t>& out, const void* vertices, std::span<const uint8_t> stored,
+                                     uint32_t count, uint32_t size) {
+                if (vertices != nullptr) mesh_codec::encode_vertices(out, vertices, count, size);
+                else if (!stored.empty()) out.assign(stored.begin(), stored.end());
+                else return (uint64_t)0;
+
+                return place(out.size());
+            };
+
+            if (mesh.indices != nullptr) {
+                mesh_codec::encode_indices(enc.indices, {mesh.indices, mesh.index_count});
+                if (mesh.lod_indices != nullptr) {
+                    mesh_codec::encode_indices(enc.indices, {mesh.lod_indices, mesh.lod_index_count});
+                }
+                entry.indices_offset = place(enc.indices.size());
+            } else if (!mesh.encoded.indices.empty()) {
+                enc.indices.assign(mesh.encoded.indices.begin(), mesh.encoded.indices.end());
+                entry.indices_offset = place(enc.indices.size());
+            }
+
+            entry.positions_offset = place_encoded(enc.positions, mesh.positions, mesh.encoded.positions,
+                                                   mesh.vertex_count, sizeof(glm::vec3));
+            entry.normals_offset =
+                place_encoded(enc.normals, mesh.normals, mesh.encoded.normals, mesh.vertex_count, sizeof(glm::vec3));
+            entry.tangents_offset = place_encoded(enc.tangents, mesh.tangents, mesh.encoded.tangents,
+                                                  mesh.indexed_tangents ? mesh.vertex_count : mesh.index_count,
+                                                  sizeof(glm::vec4));
+            for (std::size_t t = 0; t < mesh.texcoords.size(); t++) {
+                entry.texcoords_offset[t] = place_encoded(enc.texcoords[t], mesh.texcoords[t],
+                                                          mesh.encoded.texcoords[t], mesh.vertex_count,
+                                                          sizeof(glm::vec2));
+            }
+        }
+
+        header.file_size = off;
+        return off;
     }
 
-    void Mesh::save_optimized(std::span<uint8_t> data) const {
-        uint32_t off = 0;
+    bool is_current_gom(std::span<uint8_t> data) {
+        if (data.size() < sizeof(Header)) return false;
 
-        std::memcpy(data.data() + off, &material_instance, sizeof(Materials::gid));
-        off += sizeof(Materials::gid);
-        assert(off < data.size());
+        uint32_t file_magic;
+        std::memcpy(&file_magic, data.data(), sizeof(uint32_t));
+        return file_magic == magic;
+    }
 
-        std::memcpy(data.data() + off, &vertex_topology, sizeof(Topology));
-        off += sizeof(Topology);
-        assert(off < data.size());
+    // validates `data` and points `out` into it, only the mesh table gets allocated
+    bool view(Model& out, std::span<uint8_t> data) {
+        Header header;
+        std::memcpy(&header, data.data(), sizeof(Header));
 
-        std::memcpy(data.data() + off, &index_count, sizeof(uint32_t));
-        off += sizeof(uint32_t);
-        assert(off < data.size());
+        if (header.version < oldest_version || header.version > version) return false;
+        if (header.file_size != data.size()) return false;
+        if (XXH3_64bits(data.data() + sizeof(Header), data.size() - sizeof(Header)) != header.checksum) {
+            return false;
+        }
 
-        std::memcpy(data.data() + off, &vertex_count, sizeof(uint32_t));
-        off += sizeof(uint32_t);
-        assert(off < data.size());
+        // a valid checksum only means the file arrived as written, a broken writer can still point anywhere. 0 is a
+        // missing section and always fits
+        auto fits = [&](uint64_t offset, uint64_t size) {
+            return offset == 0 || (offset >= sizeof(Header) && offset <= data.size() && size <= data.size() - offset);
+        };
 
-        std::memcpy(data.data() + off, &indexed_tangents, sizeof(bool));
-        off += sizeof(bool);
-        assert(off < data.size());
+        auto entry_size = mesh_entry_size(header.version);
+        auto entry_stride = align_section(entry_size);
+        if (header.mesh_count != 0 && header.meshes_offset == 0) return false;
+        if (header.mesh_indices_count != 0 && (header.mesh_indexes_offset == 0 || header.mesh_transforms_offset == 0)) {
+            return false;
+        }
+        if (!fits(header.meshes_offset, (uint64_t)header.mesh_count * entry_stride) ||
+            !fits(header.mesh_indexes_offset, (uint64_t)header.mesh_indices_count * sizeof(uint32_t)) ||
+            !fits(header.mesh_transforms_offset, (uint64_t)header.mesh_indices_count * sizeof(glm::mat4))) {
+            return false;
+        }
+
+        auto at = [&](uint64_t offset) -> uint8_t* { return offset == 0 ? nullptr : data.data() + offset; };
+
+        for (uint32_t i = 0; i < header.mesh_indices_count; i++) {
+            uint32_t mesh_ix;
+            std::memcpy(&mesh_ix, data.data() + header.mesh_indexes_offset + i * sizeof(uint32_t), sizeof(uint32_t));
+            if (mesh_ix >= header.mesh_count) return false;
+        }
+
+        auto* entries_data = at(header.meshes_offset);
 
-        std::memcpy(data.data() + off, &bounding_box, sizeof(collisions::AABB));
+        // older entries are a prefix of the current one, the missing fields stay defaulted
+        std::vector<MeshEntry> entries(header.mesh_count);
+        for (uint32_t i = 0; i < header.mesh_count; i++) {
+            const auto& entry = entries[i];
+            std::memcpy(&entries[i], entries_data + i * entry_stride, entry_size);
+
+            if (entry.lod_count > model::max_lod_count) return false;
+            if (!fits(entry.gpu_data_offset, entry.gpu_data_size) ||
+                !fits(entry.meshlets_offset, (uint64_t)entry.meshlet_count * sizeof(model::Meshlet))) {
+                return false;
+            }
+
+            uint64_t tangent_count = entry.indexed_tangents ? entry.vertex_count : entry.index_count;
+            if (header.version >= encoded_version) {
+                // encoded arrays carry their own length, only their start has to be inside the file
+                for (auto offset : {entry.indices_offset, entry.positions_offset, entry.normals_offset,
+                                    entry.tangents_offset}) {
+                    if (!fits(offset, 1)) return false;
+                }
+                for (auto offset : entry.texcoords_offset) {
+                    if (!fits(offset, 1)) return false;
+                }
+            } else {
+                if (!fits(entry.indices_offset,
+                          ((uint64_t)entry.index_count + entry.lod_index_count) * sizeof(uint32_t)) ||
+                    !fits(entry.positions_offset, (uint64_t)entry.vertex_count * sizeof(glm::vec3)) ||
+                    !fits(entry.normals_offset, (uint64_t)entry.vertex_count * sizeof(glm::vec3)) ||
+                    !fits(entry.tangents_offset, tangent_count * sizeof(glm::vec4))) {
+                    return false;
+                }
+                for (auto offset : entry.texcoords_offset) {
+                    if (!fits(offset, (uint64_t)entry.vertex_count * sizeof(glm::vec2))) return false;
+                }
+            }
+        }
+
+        out.bounding_box = header.bounding_box;
+        out.mesh_count = header.mesh_count;
+        out.mesh_indices_count = header.mesh_indices_count;
+        out.mesh_indexes = (uint32_t*)at(header.mesh_indexes_offset);
+        out.mesh_transforms = (glm::mat4*)at(header.mesh_transforms_offset);
+
+        // the sizes of the encoded arrays aren't stored, each one runs up to the next section. the alignment
+        // padding that comes along is ignored by the decoder
+        std::vector<uint64_t> section_starts{header.meshes_offset, header.mesh_indexes_offset,
+                                             header.mesh_transforms_offset, data.size()};
+        if (header.version >= encoded_version) {
+            for (const auto& entry : entries) {
+                section_starts.insert(section_starts.end(), {entry.gpu_data_offset, entry.indices_offset,
+                                                             entry.positions_offset, entry.normals_offset,
+                                                             entry.tangents_offset});
+                section_starts.insert(section_starts.end(), entry.texcoords_offset.begin(),
+                                      entry.texcoords_offset.end());
+            }
+            std::sort(section_starts.begin(), section_starts.end());
+        }
+
+        auto encoded_at = [&](uint64_t offset) -> std::span<const uint8_t> {
+            if (offset == 0) return {};
+
+            auto end = *std::upper_bound(section_starts.begin(), section_starts.end(), offset);
+            return {data.data() + offset, end - offset};
+        };
+
+        out.meshes = (Mesh*)malloc(out.mesh_count * sizeof(Mesh));
+        for (uint32_t i = 0; i < out.mesh_count; i++) {
+            auto& entry = entries[i];
+            auto& mesh = out.meshes[i];
+            mesh = Mesh{};
+
+            mesh.material_instance = entry.material_instance;
+            mesh.vertex_topology = entry.vertex_topology;
+            mesh.index_count = entry.index_count;
+            mesh.vertex_count = entry.vertex_count;
+            mesh.indexed_tangents = entry.indexed_tangents != 0;
+            mesh.bounding_box = entry.bounding_box;
+
+            mesh.lod_count = entry.lod_count;
+            mesh.lods = entry.lods;
+            mesh.lod_index_count = entry.lod_index_count;
+            mesh.meshlet_count = entry.meshlet_count;
+            mesh.meshlets = (model::Meshlet*)at(entry.meshlets_offset);
+            mesh.compact_vertices = entry.compact_vertices != 0;
+
+            // the encoded arrays are only pointed at, `load` decodes them
+            if (header.version >= encoded_version) {
+                mesh.encoded = model::EncodedArrays{
+                    .indices = encoded_at(entry.indices_offset),
+                    .positions = encoded_at(entry.positions_offset),
+                    .normals = encoded_at(entry.normals_offset),
+                    .tangents = encoded_at(entry.tangents_offset),
+                };
+                for (std::size_t t = 0; t < mesh.texcoords.size(); t++) {
+                    mesh.encoded.texcoords[t] = encoded_at(entry.texcoords_offset[t]);
+                }
+            } else {
+                mesh.indices = (uint32_t*)at(entry.indices_offset);
+                mesh.positions = (glm::vec3*)at(entry.positions_offset);
+                mesh.normals = (glm::vec3*)at(entry.normals_offset);
+                mesh.tangents = (glm::vec4*)at(entry.tangents_offset);
+                for (std::size_t t = 0; t < mesh.texcoords.size(); t++) {
+                    mesh.texcoords[t] = (glm::vec2*)at(entry.texcoords_offset[t]);
+                }
+                if (mesh.lod_index_count != 0) mesh.lod_indices = mesh.indices + mesh.index_count;
+
+                uint32_t gpu_data_size;
+                entry.gpu_offset = mesh.calc_offset(0, &gpu_data_size);
+            }
+
+            mesh.short_indices = entry.gpu_offset.get_short_indices();
+            mesh.gpu_offset = entry.gpu_offset;
+            mesh.gpu_data = at(entry.gpu_data_offset);
+            mesh.gpu_data_size = (uint32_t)entry.gpu_data_size;
+        }
+
+        return true;
+    }
+
+    template <typename T> T* copy_array(const T* src, std::size_t count) {
+        if (src == nullptr) return nullptr;
+
+        auto* out = (T*)malloc(count * sizeof(T));
+        std::memcpy(out, src, count * sizeof(T));
+        return out;
+    }
+
+    // mallocs the arrays `view` left out of `mesh` and decodes them from `data`
+    bool decode(Mesh& mesh, std::span<uint8_t> data, uint32_t mesh_ix) {
+        Header header;
+        std::memcpy(&header, data.data(), sizeof(Header));
+
+        auto entry_size = mesh_entry_size(header.version);
+        MeshEntry entry{};
+        std::memcpy(&entry, data.data() + header.meshes_offset + mesh_ix * align_section(entry_size), entry_size);
+
+        bool ok = true;
+        auto decode_vertices = [&]<typename T>(T*& out, uint64_t offset, uint32_t count) {
+            if (offset == 0) return;
+
+            out = (T*)malloc(count * sizeof(T));
+            ok &= mesh_codec::decode_vertices(out, count, sizeof(T), data.subspan(offset));
+        };
+
+        if (entry.indices_offset != 0) {
+            std::vector<uint32_t> indices(mesh.index_count + mesh.lod_index_count);
+            ok &= mesh_codec::decode_indices(indices, data.subspan(entry.indices_offset));
+
+            mesh.indices = copy_array(indices.data(), mesh.index_count);
+            if (mesh.lod_index_count != 0) {
+                mesh.lod_indices = copy_array(indices.data() + mesh.index_count, mesh.lod_index_count);
+            }
+        }
+
+        decode_vertices(mesh.positions, entry.positions_offset, mesh.vertex_count);
+        decode_vertices(mesh.normals, entry.normals_offset, mesh.vertex_count);
+        decode_vertices(mesh.tangents, entry.tangents_offset,
+                        mesh.indexed_tangents ? mesh.vertex_count : mesh.index_count);
+        for (std::size_t t = 0; t < mesh.texcoords.size(); t++) {
+            decode_vertices(mesh.texcoords[t], entry.texcoords_offset[t], mesh.vertex_count);
+        }
+
+        return ok;
+    }
+
+    void load_legacy(Model& out, std::span<uint8_t> data) {
+        uint32_t off = 0;
+
+        std::memcpy(&out.bounding_box, data.data() + off, sizeof(collisions::AABB));
         off += sizeof(collisions::AABB);
         assert(off < data.size());
 
-        std::memcpy(data.data() + off, indices, index_count * sizeof(uint32_t));
-        off += index_count * sizeof(uint32_t);
+        std::memcpy(&out.mesh_indices_count, data.data() + off, sizeof(uint32_t));
+        off += sizeof(uint32_t);
         assert(off < data.size());
 
-        std::memcpy(data.data() + off, positions, vertex_count * sizeof(glm::vec3));
-        off += vertex_count * sizeof(glm::vec3);
+        out.mesh_indexes = (uint32_t*)malloc(sizeof(uint32_t) * out.mesh_indices_count);
+        std::memcpy(out.mesh_indexes, data.data() + off, sizeof(uint32_t) * out.mesh_indices_count);
+        off += sizeof(uint32_t) * out.mesh_indices_count;
         assert(off < data.size());
 
-        std::memset(data.data() + off, normals != nullptr, sizeof(bool));
-        off += sizeof(bool);
+        out.mesh_transforms = (glm::mat4*)malloc(sizeof(glm::mat4) * out.mesh_indices_count);
+        std::memcpy(out.mesh_transforms, data.data() + off, sizeof(glm::mat4) * out.mesh_indices_count);
+        off += sizeof(glm::mat4) * out.mesh_indices_count;
         assert(off < data.size());
 
-        std::memset(data.data() + off, tangents != nullptr, sizeof(bool));
-        off += sizeof(bool);
+        std::memcpy(&out.mesh_count, data.data() + off, sizeof(uint32_t));
+        off += sizeof(uint32_t);
         assert(off < data.size());
 
-        for (const auto& texcoord : texcoords) {
-            std::memset(data.data() + off, texcoord != nullptr, sizeof(bool));
-            off += sizeof(bool);
+        out.meshes = (Mesh*)malloc(out.mesh_count * sizeof(Mesh));
+        for (size_t mesh_ix = 0; mesh_ix < out.mesh_count; mesh_ix++) {
+            uint32_t mesh_offset;
+            std::memcpy(&mesh_offset, data.data() + off, sizeof(uint32_t));
+            off += sizeof(uint32_t);
             assert(off < data.size());
-        }
 
-        if (normals != nullptr) {
-            std::memcpy(data.data() + off, normals, vertex_count * sizeof(glm::vec3));
-            off += vertex_count * sizeof(glm::vec3);
-            assert(off < data.size());
+            assert(mesh_offset < data.size());
+            Mesh::load_optimized(out.meshes[mesh_ix], {data.data() + mesh_offset, data.size() - mesh_offset});
         }
+    }
+}
 
-        if (tangents != nullptr) {
-            auto size = (indexed_tangents ? vertex_count : index_count) * sizeof(glm::vec4);
-            std::memcpy(data.data() + off, tangents, size);
-            off += size;
-            assert(off < data.size());
-        }
+namespace engine::compact {
+    // has to match `load_vertex` in vertex_data.glsl
+    static constexpr uint32_t position_size = 8;
+    static constexpr uint32_t normal_size = 4;
+    static constexpr uint32_t tangent_size = 4;
+    static constexpr uint32_t texcoord_size = 4;
+
+    // half floats still resolve about a texel of a 1k texture up to here
+    static constexpr float max_texcoord = 2.0f;
+
+    // `position = min + quantized * scale`
+    struct PositionDecode {
+        glm::vec3 min;
+        glm::vec3 scale;
+    };
 
-        for (const auto& texcoord : texcoords) {
-            if (texcoord != nullptr) {
-                std::memcpy(data.data() + off, texcoord, vertex_count * sizeof(glm::vec2));
-                off += vertex_count * sizeof(glm::vec2);
-                assert(off <= data.size());
+    // 3 16 bit unorms relative to the bounds, the last 16 bits are unused
+    std::array<uint32_t, 2> encode_position(glm::vec3 position, const PositionDecode& decode) {
+        auto q = glm::uvec3{0};
+        for (int i = 0; i < 3; i++) {
+            if (decode.scale[i] > 0.0f) {
+                q[i] = (uint32_t)glm::clamp(std::round((position[i] - decode.min[i]) / decode.scale[i]), 0.0f, 65535.0f);
             }
         }
+
+        return {q.x | (q.y << 16), q.z};
+    }
+
+    // the unit sphere folded onto the [-1, 1] square
+    glm::vec2 octahedral(glm::vec3 n) {
+        n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if (n.z >= 0.0f) return glm::vec2{n};
+
+        auto sign = glm::vec2{n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f};
+        return (1.0f - glm::abs(glm::vec2{n.y, n.x})) * sign;
+    }
+
+    uint32_t encode_normal(glm::vec3 normal) {
+        if (glm::dot(normal, normal) == 0.0f) return 0;
+        return glm::packSnorm2x16(octahedral(normal));
+    }
+
+    // 2 15 bit snorms and the bitangent sign in the top bit
+    uint32_t encode_tangent(glm::vec4 tangent) {
+        auto xyz = glm::vec3{tangent};
+        auto e = glm::dot(xyz, xyz) == 0.0f ? glm::vec2{0.0f} : octahedral(xyz);
+
+        auto x = (int32_t)std::round(glm::clamp(e.x, -1.0f, 1.0f) * 16383.0f);
+        auto y = (int32_t)std::round(glm::clamp(e.y, -1.0f, 1.0f) * 16383.0f);
+        return ((uint32_t)x & 0x7FFFu) | (((uint32_t)y & 0x7FFFu) << 15) | (tangent.w < 0.0f ? 0x80000000u : 0u);
     }
 
+    uint32_t encode_texcoord(glm::vec2 texcoord) {
+        return glm::packHalf2x16(texcoord);
+    }
+}
+
+namespace engine {
     void Mesh::load_optimized(Mesh& out, std::span<uint8_t> data) {
         out = Mesh{};
 
@@ -178,50 +586,93 @@ namespace engine {
         }
     }
 
+    bool Mesh::can_compact_vertices() const {
+        for (const auto* texcoord : texcoords) {
+            if (texcoord == nullptr) continue;
+
+            for (uint32_t i = 0; i < vertex_count; i++) {
+                if (glm::any(glm::greaterThan(glm::abs(texcoord[i]), glm::vec2{compact::max_texcoord}))) return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool Mesh::can_short_indices() const {
+        return vertex_count < 65536;
+    }
+
+    uint32_t Mesh::gpu_indices_size() const {
+        uint32_t size = (index_count + lod_index_count) * (short_indices ? sizeof(uint16_t) : sizeof(uint32_t));
+        // keeps everything after them 4 byte aligned
+        return (size + 3) & ~3u;
+    }
+
     model::GPUOffset Mesh::calc_offset(uint32_t start_offset, uint32_t* total_size) const {
         uint32_t size = 0;
+        auto material_offset = models::gid{material_instance.gen(), material_instance.id()}.value; // TODO: fix shader code to use the proper Materials::gid
+
+        if (gpu_data != nullptr) {
+            auto offset = gpu_offset;
+            offset.start = start_offset;
+            offset.material_offset = material_offset;
+
+            *total_size = gpu_data_size;
+            return offset;
+        }
 
         model::GPUOffset offset{
             .start = start_offset,
-            .material_offset = models::gid{material_instance.gen(), material_instance.id()}.value, // TODO: fix shader code to use the proper Materials::gid
+            .material_offset = material_offset,
         };
         offset.set_indexed_tangetns(indexed_tangents);
+        offset.set_compact_vertices(compact_vertices);
+        offset.set_short_indices(short_indices && indices != nullptr);
+
+        uint32_t position_size = compact_vertices ? compact::position_size : sizeof(glm::vec3);
+        uint32_t normal_size = compact_vertices ? compact::normal_size : sizeof(glm::vec3);
+        uint32_t tangent_size = compact_vertices ? compact::tangent_size : sizeof(glm::vec4);
+        uint32_t texcoord_size = compact_vertices ? compact::texcoord_size : sizeof(glm::vec2);
 
         if (indices != nullptr) {
             offset.indices_offset = size;
-            size += sizeof(uint32_t) * index_count;
+            size += gpu_indices_size();
+            size += sizeof(model::Meshlet) * meshlet_count;
         }
 
         if (!indexed_tangents && tangents != nullptr) {
             offset.tangent_offset = size;
-            size += sizeof(glm::vec4) * index_count;
+            size += tangent_size * index_count;
         }
 
+        // the positions are first in the stride, so the shader finds the block right before `position_offset`
+        if (compact_vertices && positions != nullptr) size += sizeof(compact::PositionDecode);
+
         uint32_t stride = 0;
         uint32_t stride_start = size;
         if (positions != nullptr) {
             offset.position_offset = stride_start;
-            stride_start += sizeof(glm::vec3);
-            stride += sizeof(glm::vec3);
+            stride_start += position_size;
+            stride += position_size;
         }
 
         if (normals != nullptr) {
             offset.normal_offset = stride_start;
-            stride_start += sizeof(glm::vec3);
-            stride += sizeof(glm::vec3);
+            stride_start += normal_size;
+            stride += normal_size;
         }
 
         if (indexed_tangents && tangents != nullptr) {
             offset.tangent_offset = stride_start;
-            stride_start += sizeof(glm::vec4);
-            stride += sizeof(glm::vec4);
+            stride_start += tangent_size;
+            stride += tangent_size;
         }
 
         for (std::size_t i = 0; i < texcoords.size(); i++) {
             if (texcoords[i] != nullptr) {
                 offset.texcoords_offset[i] = stride_start;
-                stride_start += sizeof(glm::vec2);
-                stride += sizeof(glm::vec2);
+                stride_start += texcoord_size;
+                stride += texcoord_size;
             }
         }
 
@@ -232,141 +683,204 @@ namespace engine {
     }
 
     uint32_t Mesh::upload_data(uint8_t* buf) const {
+        if (gpu_data != nullptr) {
+            std::memcpy(buf, gpu_data, gpu_data_size);
+            return gpu_data_size;
+        }
+
         uint32_t total_size;
         auto offset = calc_offset(0, &total_size);
 
         if (offset.indices_offset != (uint32_t)-1) {
-            std::memcpy(buf + offset.indices_offset, indices, index_count * sizeof(uint32_t));
+            if (short_indices) {
+                auto* out = buf + offset.indices_offset;
+                for (uint32_t i = 0; i < index_count + lod_index_count; i++) {
+                    auto index = (uint16_t)(i < index_count ? indices[i] : lod_indices[i - index_count]);
+                    std::memcpy(out + i * sizeof(uint16_t), &index, sizeof(uint16_t));
+                }
+            } else {
+                std::memcpy(buf + offset.indices_offset, indices, index_count * sizeof(uint32_t));
+                if (lod_index_count != 0) {
+                    std::memcpy(buf + offset.indices_offset + index_count * sizeof(uint32_t), lod_indices,
+                                lod_index_count * sizeof(uint32_t));
+                }
+            }
+            if (meshlet_count != 0) {
+                std::memcpy(buf + offset.indices_offset + gpu_indices_size(), meshlets,
+                            meshlet_count * sizeof(model::Meshlet));
+            }
         }
 
+        // writes `count` elements of `src` `dst_stride` apart, encoded by `encode` for compact meshes
+        auto write = [&]<typename T, typename E>(uint32_t dst_offset, uint32_t dst_stride, const T* src,
+                                                 std::size_t count, E encode) {
+            auto buf_ = buf + dst_offset;
+            for (std::size_t i = 0; i < count; i++) {
+                if (compact_vertices) {
+                    auto encoded = encode(src[i]);
+                    std::memcpy(buf_, &encoded, sizeof(encoded));
+                } else {
+                    std::memcpy(buf_, &src[i], sizeof(T));
+                }
+                buf_ += dst_stride;
+            }
+        };
+
+        compact::PositionDecode position_decode{
+            .min = bounding_box.min,
+            .scale = (bounding_box.max - bounding_box.min) / 65535.0f,
+        };
+        auto encode_position = [&](glm::vec3 p) { return compact::encode_position(p, position_decode); };
+
         if (!indexed_tangents && offset.tangent_offset != (uint32_t)-1) {
-            std::memcpy(buf + offset.tangent_offset, tangents, index_count * sizeof(glm::vec4));
+            write(offset.tangent_offset, compact_vertices ? compact::tangent_size : sizeof(glm::vec4), tangents,
+                  index_count, compact::encode_tangent);
         }
 
         if (offset.position_offset != (uint32_t)-1) {
-            auto buf_ = buf + offset.position_offset;
-            for (std::size_t i = 0; i < vertex_count; i++) {
-                std::memcpy(buf_, &positions[i], sizeof(glm::vec3));
-                buf_ += offset.get_stride();
+            if (compact_vertices) {
+                std::memcpy(buf + offset.position_offset - sizeof(compact::PositionDecode), &position_decode,
+                            sizeof(compact::PositionDecode));
             }
+            write(offset.position_offset, offset.get_stride(), positions, vertex_count, encode_position);
         }
 
         if (offset.normal_offset != (uint32_t)-1) {
-            auto buf_ = buf + offset.normal_offset;
-            for (std::size_t i = 0; i < vertex_count; i++) {
-                std::memcpy(buf_, &normals[i], sizeof(glm::vec3));
-                buf_ += offset.get_stride();
-            }
+            write(offset.normal_offset, offset.get_stride(), normals, vertex_count, compact::encode_normal);
         }
 
         if (indexed_tangents && offset.tangent_offset != (uint32_t)-1) {
-            auto buf_ = buf + offset.tangent_offset;
-            for (std::size_t i = 0; i < vertex_count; i++) {
-                std::memcpy(buf_, &tangents[i], sizeof(glm::vec4));
-                buf_ += offset.get_stride();
-            }
+            write(offset.tangent_offset, offset.get_stride(), tangents, vertex_count, compact::encode_tangent);
         }
 
         for (std::size_t t = 0; t < texcoords.size(); t++) {
             if (offset.texcoords_offset[t] == (uint32_t)-1) continue;
 
-            auto buf_ = buf + offset.texcoords_offset[t];
-            for (std::size_t i = 0; i < vertex_count; i++) {
-                std::memcpy(buf_, &texcoords[t][i], sizeof(glm::vec2));
-                buf_ += offset.get_stride();
-            }
+            write(offset.texcoords_offset[t], offset.get_stride(), texcoords[t], vertex_count,
+                  compact::encode_texcoord);
         }
 
         return total_size;
     }
 
     uint32_t Model::get_save_size() const {
-        uint32_t total_size = sizeof(collisions::AABB) + sizeof(uint32_t) +
-                              mesh_indices_count * (sizeof(uint32_t) + sizeof(glm::mat4)) + sizeof(uint32_t) +
-                              mesh_count * sizeof(uint32_t);
-
-        for (size_t mesh_ix = 0; mesh_ix < mesh_count; mesh_ix++) {
-            total_size += meshes[mesh_ix].get_optimized_size();
-        }
-
-        return total_size;
+        gom::Header header;
+        std::vector<gom::MeshEntry> entries(mesh_count);
+        std::vector<gom::EncodedMesh> encoded(mesh_count);
+        return (uint32_t)gom::layout(*this, header, entries, encoded);
     }
 
     void Model::save(std::span<uint8_t> data) const {
-        uint32_t header_size = sizeof(collisions::AABB) + sizeof(uint32_t) +
-                               mesh_indices_count * (sizeof(uint32_t) + sizeof(glm::mat4)) + sizeof(uint32_t) +
-                               mesh_count * sizeof(uint32_t);
-        uint32_t off = 0;
-
-        std::memcpy(data.data() + off, &bounding_box, sizeof(collisions::AABB));
-        off += sizeof(collisions::AABB);
-        assert(off < data.size());
+        gom::Header header;
+        std::vector<gom::MeshEntry> entries(mesh_count);
+        std::vector<gom::EncodedMesh> encoded(mesh_count);
+        auto size = gom::layout(*this, header, entries, encoded);
+        assert(size <= data.size());
+
+        // padding is zeroed so the checksum only depends on the content
+        std::memset(data.data(), 0, size);
+        std::memcpy(data.data() + header.meshes_offset, entries.data(), entries.size() * sizeof(gom::MeshEntry));
+        std::memcpy(data.data() + header.mesh_indexes_offset, mesh_indexes, mesh_indices_count * sizeof(uint32_t));
+        std::memcpy(data.data() + header.mesh_transforms_offset, mesh_transforms,
+                    mesh_indices_count * sizeof(glm::mat4));
+
+        auto write = [&](uint64_t offset, const std::vector<uint8_t>& section) {
+            if (offset != 0) std::memcpy(data.data() + offset, section.data(), section.size());
+        };
 
-        std::memcpy(data.data() + off, &mesh_indices_count, sizeof(uint32_t));
-        off += sizeof(uint32_t);
-        assert(off < data.size());
+        for (uint32_t i = 0; i < mesh_count; i++) {
+            const auto& mesh = meshes[i];
+            const auto& entry = entries[i];
+            const auto& enc = encoded[i];
 
-        std::memcpy(data.data() + off, mesh_indexes, sizeof(uint32_t) * mesh_indices_count);
-        off += sizeof(uint32_t) * mesh_indices_count;
-        assert(off < data.size());
+            mesh.upload_data(data.data() + entry.gpu_data_offset);
 
-        std::memcpy(data.data() + off, mesh_transforms, sizeof(glm::mat4) * mesh_indices_count);
-        off += sizeof(glm::mat4) * mesh_indices_count;
-        assert(off < data.size());
+            write(entry.indices_offset, enc.indices);
+            write(entry.positions_offset, enc.positions);
+            write(entry.normals_offset, enc.normals);
+            write(entry.tangents_offset, enc.tangents);
+            for (std::size_t t = 0; t < mesh.texcoords.size(); t++) {
+                write(entry.texcoords_offset[t], enc.texcoords[t]);
+            }
+        }
 
-        std::memcpy(data.data() + off, &mesh_count, sizeof(uint32_t));
-        off += sizeof(uint32_t);
-        assert(off < data.size());
+        header.checksum = XXH3_64bits(data.data() + sizeof(gom::Header), size - sizeof(gom::Header));
+        std::memcpy(data.data(), &header, sizeof(gom::Header));
+    }
 
-        uint32_t mesh_offset = header_size;
-        for (size_t mesh_ix = 0; mesh_ix < mesh_count; mesh_ix++) {
-            const auto& mesh = meshes[mesh_ix];
-            mesh.save_optimized({data.data() + mesh_offset, data.size() - mesh_offset});
+    bool Model::load(Model& out, std::span<uint8_t> data) {
+        if (!gom::is_current_gom(data)) {
+            gom::load_legacy(out, data);
+            return true;
+        }
 
-            std::memcpy(data.data() + off, &mesh_offset, sizeof(uint32_t));
-            off += sizeof(uint32_t);
-            assert(off < data.size());
+        Model mapped{};
+        if (!gom::view(mapped, data)) return false;
 
-            mesh_offset += mesh.get_optimized_size();
-            assert(mesh_offset <= data.size());
-        }
-    }
+        gom::Header header;
+        std::memcpy(&header, data.data(), sizeof(gom::Header));
 
-    void Model::load(Model& out, std::span<uint8_t> data) {
-        uint32_t off = 0;
+        out = Model{
+            .bounding_box = mapped.bounding_box,
+            .mesh_count = mapped.mesh_count,
+            .meshes = mapped.meshes,
+            .mesh_indices_count = mapped.mesh_indices_count,
+            .mesh_indexes = gom::copy_array(mapped.mesh_indexes, mapped.mesh_indices_count),
+            .mesh_transforms = gom::copy_array(mapped.mesh_transforms, mapped.mesh_indices_count),
+        };
 
-        std::memcpy(&out.bounding_box, data.data() + off, sizeof(collisions::AABB));
-        off += sizeof(collisions::AABB);
-        assert(off < data.size());
+        bool ok = true;
+        for (uint32_t i = 0; i < out.mesh_count; i++) {
+            auto& mesh = out.meshes[i];
+            uint32_t tangent_count = mesh.indexed_tangents ? mesh.vertex_count : mesh.index_count;
+
+            mesh.meshlets = gom::copy_array(mesh.meshlets, mesh.meshlet_count);
+            if (header.version >= gom::encoded_version) {
+                ok &= gom::decode(mesh, data, i);
+            } else {
+                mesh.indices = gom::copy_array(mesh.indices, mesh.index_count);
+                mesh.lod_indices = gom::copy_array(mesh.lod_indices, mesh.lod_index_count);
+                mesh.positions = gom::copy_array(mesh.positions, mesh.vertex_count);
+                mesh.normals = gom::copy_array(mesh.normals, mesh.vertex_count);
+                mesh.tangents = gom::copy_array(mesh.tangents, tangent_count);
+                for (auto& texcoord : mesh.texcoords) {
+                    texcoord = gom::copy_array(texcoord, mesh.vertex_count);
+                }
+            }
 
-        std::memcpy(&out.mesh_indices_count, data.data() + off, sizeof(uint32_t));
-        off += sizeof(uint32_t);
-        assert(off < data.size());
+            mesh.gpu_data = nullptr;
+            mesh.gpu_data_size = 0;
+            mesh.encoded = {};
+        }
 
-        out.mesh_indexes = (uint32_t*)malloc(sizeof(uint32_t) * out.mesh_indices_count);
-        std::memcpy(out.mesh_indexes, data.data() + off, sizeof(uint32_t) * out.mesh_indices_count);
-        off += sizeof(uint32_t) * out.mesh_indices_count;
-        assert(off < data.size());
+        if (!ok) {
+            out.destroy();
+            out = Model{};
+            return false;
+        }
 
-        out.mesh_transforms = (glm::mat4*)malloc(sizeof(glm::mat4) * out.mesh_indices_count);
-        std::memcpy(out.mesh_transforms, data.data() + off, sizeof(glm::mat4) * out.mesh_indices_count);
-        off += sizeof(glm::mat4) * out.mesh_indices_count;
-        assert(off < data.size());
+        return true;
+    }
 
-        std::memcpy(&out.mesh_count, data.data() + off, sizeof(uint32_t));
-        off += sizeof(uint32_t);
-        assert(off < data.size());
+    bool Model::map(Model& out, const std::filesystem::path& path) {
+        auto file = util::map_file(path);
+        if (!file) return false;
 
-        out.meshes = (Mesh*)malloc(out.mesh_count * sizeof(Mesh));
-        for (size_t mesh_ix = 0; mesh_ix < out.mesh_count; mesh_ix++) {
-            uint32_t mesh_offset;
-            std::memcpy(&mesh_offset, data.data() + off, sizeof(uint32_t));
-            off += sizeof(uint32_t);
-            assert(off < data.size());
+        std::span<uint8_t> data{file->data, (std::size_t)file->size};
+        if (!gom::is_current_gom(data)) {
+            auto res = load(out, data);
+            util::unmap_file(*file);
+            return res;
+        }
 
-            assert(mesh_offset < data.size());
-            Mesh::load_optimized(out.meshes[mesh_ix], {data.data() + mesh_offset, data.size() - mesh_offset});
+        out = Model{};
+        if (!gom::view(out, data)) {
+            util::unmap_file(*file);
+            return false;
         }
+
+        out.mapping = *file;
+        return true;
     }
 }
 
@@ -392,8 +906,14 @@ namespace engine::model {
             m.mat_id = mesh.material_instance.dim();
             m.offset = ctx->offsets[mesh_ix];
             m.transform = ctx->model->mesh_transforms[mesh_ix];
-            m.vertex_count = mesh.indices != nullptr ? mesh.index_count : mesh.vertex_count;
+            m.vertex_count = m.offset.indices_offset != (uint32_t)-1 ? mesh.index_count : mesh.vertex_count;
             m.bounding_box = mesh.bounding_box;
+            m.lod_count = mesh.lod_count;
+            m.lods = mesh.lods;
+            m.meshlet_count = mesh.meshlet_count;
+            m.meshlet_offset = mesh.meshlet_count != 0
+                                   ? m.offset.start + m.offset.indices_offset + mesh.gpu_indices_size()
+                                   : (uint32_t)-1;
 
             std::memcpy(data, &m, sizeof(GPUMeshData));
             data += sizeof(GPUMeshData);
@@ -438,7 +958,8 @@ namespace engine::model {
             auto draw_cmd = DrawCommand{
                 .cmd =
                     VkDrawIndirectCommand{
-                        .vertexCount = mesh.indices != nullptr ? mesh.index_count : mesh.vertex_count,
+                        .vertexCount = ctx->offsets[mesh_ix].indices_offset != (uint32_t)-1 ? mesh.index_count
+                                                                                             : mesh.vertex_count,
                         .instanceCount = 1,
                         .firstVertex = 0,
                         .firstInstance = 0,
@@ -3,13 +3,17 @@
 #include "goliath/errors.hpp"
 #include "goliath/gpu_group.hpp"
 #include "goliath/mspc_queue.hpp"
-#include "goliath/thread_pool.hpp"
+#include "goliath/scheduler.hpp"
 #include "goliath/util.hpp"
 #include "models_.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <expected>
 #include <filesystem>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <vector>
 #include <vulkan/vulkan_core.h>
@@ -45,14 +49,34 @@ namespace engine::models {
     Textures* texs;
     Materials* mats;
 
-    std::vector<std::string> names{};
+    Registry registry{};
     std::vector<uint32_t> ref_counts{};
 
     std::vector<std::optional<engine::Model>> cpu_datas{};
     std::vector<UploadedModelData> gpu_datas{};
 
-    std::vector<uint8_t> generations{};
-    std::vector<bool> deleted{};
+    // per-slot state the io workers touch, slots are heap allocated so a worker can keep using one while
+    // `slots` grows
+    struct Slot {
+        // held while the slot's .gom is read or written
+        std::mutex io{};
+        // mirrors `registry.generations` for the workers
+        std::atomic<uint8_t> generation = 0;
+
+        // main thread only, set between `add` and the model's file being written
+        bool initializing = false;
+        // an acquire that came in while initializing, the load is started once the file exists
+        bool load_after_init = false;
+    };
+
+    std::vector<std::unique_ptr<Slot>> slots{};
+    // only guards the storage of `slots` and `cpu_datas`, taken exclusively when they grow
+    std::shared_mutex slots_lock{};
+
+    Slot* get_slot(uint32_t id) {
+        std::shared_lock lock{slots_lock};
+        return slots[id].get();
+    }
 
     struct task {
         enum Type {
@@ -66,59 +90,57 @@ namespace engine::models {
         Type type;
         gid gid;
         std::optional<std::variant<AddFn, Model>> add{};
+        // models an `Acquire` loads, sorted by id so reads of neighbouring files end up on the same worker
+        std::vector<models::gid> batch{};
     };
 
-    static constexpr std::size_t reload_queue_size = 16;
-    engine::MSPCQueue<gid, reload_queue_size> reload_queue{};
+    struct LoadedModel {
+        gid gid;
+        Model model;
+    };
 
-    static constexpr std::size_t gpu_queue_size = 64;
-    engine::MSPCQueue<gid, gpu_queue_size> gpu_queue{};
-    std::mutex gid_read{};
+    engine::SegmentedMSPCQueue<gid> reload_queue{};
+    engine::SegmentedMSPCQueue<LoadedModel> gpu_queue{};
+    engine::SegmentedMSPCQueue<gid> initialized_queue{};
 
-    std::vector<gid> initializing_models{};
-    static constexpr std::size_t initialized_queue_size = 32;
-    engine::MSPCQueue<gid, initialized_queue_size> initialized_queue{};
+    static constexpr std::size_t min_load_batch = 4;
 
-    bool is_initializing(gid gid) {
-        return std::find(initializing_models.begin(), initializing_models.end(), gid) != initializing_models.end();
-    }
+    void load_models(std::span<const gid> gids) {
+        std::vector<LoadedModel> loaded{};
+        loaded.reserve(gids.size());
 
-    bool load_model_data(gid gid) {
-        std::lock_guard lock{gid_read};
+        for (auto gid : gids) {
+            auto* slot = get_slot(gid.id());
+            std::lock_guard lock{slot->io};
 
-        if (generations[gid.id()] != gid.gen()) return false;
+            if (slot->generation.load(std::memory_order_acquire) != gid.gen()) continue;
 
-        uint32_t model_size;
-        auto* model_data = engine::util::read_file(models_directory / make_model_path(gid), &model_size);
-        if (model_data == nullptr) {
-            auto error = LoadError{
-                .model = gid,
-            };
-            errors::throw_err(errors::Models_Load, &error);
-            return false;
-        }
+            engine::Model model{};
+            if (!engine::Model::map(model, models_directory / make_model_path(gid))) {
+                auto error = LoadError{
+                    .model = gid,
+                };
+                errors::throw_err(errors::Models_Load, &error);
+                continue;
+            }
 
-        cpu_datas[gid.id()] = engine::Model{};
-        engine::Model::load(cpu_datas[gid.id()].value(), {model_data, model_size});
+            loaded.emplace_back(gid, model);
+        }
 
-        free(model_data);
-        return true;
+        // the whole batch is published at once, whether the models are still wanted is checked in `process_uploads`
+        gpu_queue.enqueue(std::span<const LoadedModel>{loaded});
     }
 
-    bool add_model(gid gid, Model model) {
-        std::lock_guard lock{gid_read};
+    bool save_model(gid gid, const Model& model) {
+        auto* slot = get_slot(gid.id());
+        std::lock_guard lock{slot->io};
 
-        if (generations[gid.id()] != gid.gen()) return false;
+        if (slot->generation.load(std::memory_order_acquire) != gid.gen()) return false;
 
         auto model_size = model.get_save_size();
         auto* data = (uint8_t*)malloc(model_size);
         model.save({data, model_size});
 
-        if (generations[gid.id()] != gid.gen()) {
-            free(data);
-            return false;
-        }
-
         engine::util::save_file(models_directory / make_model_path(gid), data, model_size);
 
         free(data);
@@ -126,28 +148,24 @@ namespace engine::models {
         return true;
     }
 
-    auto io_pool = engine::make_thread_pool([](task&& task) {
+    void run_task(task& task) {
         switch (task.type) {
             case task::ReLoad: reload_queue.enqueue(task.gid); break;
-            case task::Acquire:
-                while (is_initializing(task.gid)) {
-                    _mm_pause();
-                }
-
-                if (load_model_data(task.gid)) {
-                    gpu_queue.enqueue(task.gid);
-                }
-                break;
+            case task::Acquire: load_models(task.batch); break;
             case task::Add:
-                if (add_model(task.gid, std::get<Model>(*task.add))) {
+                if (save_model(task.gid, std::get<Model>(*task.add))) {
                     initialized_queue.enqueue(task.gid);
                 }
                 break;
             case task::AddCustom: {
+                auto* slot = get_slot(task.gid.id());
                 bool res = false;
                 {
-                    std::lock_guard lock{gid_read};
-                    res = std::get<AddFn>(*task.add)(task.gid, models_directory / make_model_path(task.gid));
+                    std::lock_guard lock{slot->io};
+                    if (slot->generation.load(std::memory_order_acquire) == task.gid.gen()) {
+                        res = std::get<AddFn>(*task.add)(task.gid,
+                                                         models_directory / make_model_path(task.gid));
+                    }
                 }
 
                 if (res) {
@@ -156,11 +174,40 @@ namespace engine::models {
                 break;
             }
             case task::Save: {
-                if (cpu_datas[task.gid.id()]) add_model(task.gid, *cpu_datas[task.gid.id()]);
+                std::optional<Model> model{};
+                {
+                    std::shared_lock lock{slots_lock};
+                    model = cpu_datas[task.gid.id()];
+                }
+
+                if (model) save_model(task.gid, *model);
                 break;
             }
         }
-    });
+    }
+
+    void enqueue(task task, scheduler::Priority priority) {
+        scheduler::submit([task = std::move(task)]() mutable { run_task(task); }, priority);
+    }
+
+    // splits `gids` into one `Acquire` per scheduler worker, batches never get smaller than `min_load_batch`
+    void enqueue_loads(std::vector<gid>& gids) {
+        if (gids.empty()) return;
+
+        std::sort(gids.begin(), gids.end(), [](auto a, auto b) { return a.id() < b.id(); });
+
+        std::size_t worker_count = scheduler::worker_count();
+        auto batch_size = std::max(min_load_batch, (gids.size() + worker_count - 1) / worker_count);
+        for (std::size_t start = 0; start < gids.size(); start += batch_size) {
+            auto end = std::min(gids.size(), start + batch_size);
+            enqueue(
+                task{
+                    .type = task::Acquire,
+                    .batch = std::vector<gid>{gids.begin() + start, gids.begin() + end},
+                },
+                scheduler::Priority::Normal);
+        }
+    }
 
     bool process_uploads() {
         if (!init_called) return false;
@@ -168,15 +215,14 @@ namespace engine::models {
         std::vector<gid> reload_gids{};
         reload_queue.drain(reload_gids);
 
-        std::vector<gid> upload_gids{};
-        gpu_queue.drain(upload_gids);
+        std::vector<LoadedModel> loaded_models{};
+        gpu_queue.drain(loaded_models);
 
         std::vector<gid> initialized_gids{};
         initialized_queue.drain(initialized_gids);
 
         for (const auto& gid : reload_gids) {
-            if (generations.size() <= gid.id() || generations[gid.id()] != gid.gen() || ref_counts[gid.id()] == 0 ||
-                deleted[gid.id()]) {
+            if (!registry.is_alive(gid) || ref_counts[gid.id()] == 0) {
                 continue;
             }
 
@@ -193,47 +239,53 @@ namespace engine::models {
             gpu_data.gpu = gpu;
         }
 
-        for (const auto& gid : upload_gids) {
-            if (generations[gid.id()] == gid.gen() && ref_counts[gid.id()] != 0 && !deleted[gid.id()]) {
-                for (const auto& mesh : std::span{cpu_datas[gid.id()]->meshes, cpu_datas[gid.id()]->mesh_count}) {
-                    mats->with_textures([](auto tex_gid) { texs->acquire({&tex_gid, 1}); }, mesh.material_instance);
-                }
+        for (auto& [gid, model] : loaded_models) {
+            // the model got released, removed or loaded twice by a release and re-acquire in between
+            if (!registry.is_alive(gid) || ref_counts[gid.id()] == 0 || cpu_datas[gid.id()]) {
+                model.destroy();
+                continue;
+            }
 
-                auto& cpu_data = *cpu_datas[gid.id()];
-                engine::gpu_group::begin();
-                auto [gpu, draw_buffer] = engine::model::upload(&cpu_data, gid.id());
-
-                auto& gpu_data = gpu_datas[gid.id()];
-                gpu_data.group = engine::gpu_group::end(false, VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT,
-                                                        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT |
-                                                            VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
-                                                            VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
-                                                        VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
-                gpu_data.draw_buffer = draw_buffer;
-                gpu_data.gpu = gpu;
+            cpu_datas[gid.id()] = model;
+            for (const auto& mesh : std::span{cpu_datas[gid.id()]->meshes, cpu_datas[gid.id()]->mesh_count}) {
+                mats->with_textures([](auto tex_gid) { texs->acquire({&tex_gid, 1}); }, mesh.material_instance);
             }
+
+            auto& cpu_data = *cpu_datas[gid.id()];
+            engine::gpu_group::begin();
+            auto [gpu, draw_buffer] = engine::model::upload(&cpu_data, gid.id());
+
+            auto& gpu_data = gpu_datas[gid.id()];
+            gpu_data.group = engine::gpu_group::end(false, VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT,
+                                                    VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT |
+                                                        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
+                                                        VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+                                                    VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+            gpu_data.draw_buffer = draw_buffer;
+            gpu_data.gpu = gpu;
         }
 
         bool initialized = false;
-        std::erase_if(initializing_models, [&](auto gid) {
-            auto found = std::find(initialized_gids.begin(), initialized_gids.end(), gid) != initialized_gids.end();
-            initialized |= found;
-            return found || generations[gid.id()] != gid.gen();
-        });
+        std::vector<gid> load_gids{};
+        for (auto gid : initialized_gids) {
+            if (registry.generations[gid.id()] != gid.gen()) continue;
 
-        initialized |= want_save;
-        want_save = false;
-        return initialized;
-    }
+            auto& slot = *slots[gid.id()];
+            if (!slot.initializing) continue;
 
-    std::optional<gid> find_empty_gid() {
-        for (uint32_t i = 0; i < deleted.size(); i++) {
-            if (deleted[i]) {
-                return gid{generations[i], i};
+            slot.initializing = false;
+            initialized = true;
+
+            if (slot.load_after_init) {
+                slot.load_after_init = false;
+                if (ref_counts[gid.id()] != 0 && !cpu_datas[gid.id()]) load_gids.emplace_back(gid);
             }
         }
+        enqueue_loads(load_gids);
 
-        return std::nullopt;
+        initialized |= want_save;
+        want_save = false;
+        return initialized;
     }
 
     void init(std::filesystem::path models_dir, Textures* textures, Materials* materials) {
@@ -246,7 +298,7 @@ namespace engine::models {
     void destroy() {
         if (!init_called) return;
 
-        for (size_t i = 0; i < names.size(); i++) {
+        for (size_t i = 0; i < registry.size(); i++) {
             if (cpu_datas[i]) {
                 cpu_datas[i]->destroy();
             }
@@ -255,51 +307,31 @@ namespace engine::models {
         }
     }
 
-    void load(const nlohmann::json& j) {
-        assert(init_called);
-
+    void Registry::load(const nlohmann::json& j) {
         std::vector<nlohmann::json> entries{};
         j.get_to(entries);
 
-        if (names.size() > 0) {
-            destroy();
-
-            names.clear();
-
-            ref_counts.clear();
-
-            cpu_datas.clear();
-            gpu_datas.clear();
-
-            generations.clear();
-
-            deleted.clear();
-        }
+        names.clear();
+        generations.clear();
+        deleted.clear();
+        free_ids.clear();
 
         for (uint32_t i = 0; i < entries.size(); i++) {
-            auto entry = entries[i];
+            auto& entry = entries[i];
 
             if (entry.contains("deleted")) {
                 names.emplace_back();
-                ref_counts.emplace_back(0);
-                cpu_datas.emplace_back();
-                gpu_datas.emplace_back();
-                generations.emplace_back(entry["gen"]);
                 deleted.emplace_back(true);
+                free_ids.emplace_back(i);
             } else {
                 names.emplace_back(std::move(entry["name"]));
-                ref_counts.emplace_back(0);
-                cpu_datas.emplace_back();
-                gpu_datas.emplace_back();
-                generations.emplace_back(entry["gen"]);
                 deleted.emplace_back(false);
             }
+            generations.emplace_back(entry["gen"]);
         }
     }
 
-    nlohmann::json save() {
-        assert(init_called);
-
+    nlohmann::json Registry::save() const {
         auto j = nlohmann::json::array();
 
         for (uint32_t i = 0; i < names.size(); i++) {
@@ -319,84 +351,118 @@ namespace engine::models {
         return j;
     }
 
-    gid add(Model model, std::string name) {
-        assert(init_called);
+    gid Registry::alloc(std::string name) {
+        if (free_ids.empty()) {
+            names.emplace_back(std::move(name));
+            generations.emplace_back(0);
+            deleted.emplace_back(false);
 
-        gid gid;
-        if (auto gid_ = find_empty_gid(); gid_) {
-            gid = *gid_;
-            uint8_t gid_gen = gid.gen();
+            return {0, size() - 1};
+        }
 
-            names[gid.id()] = std::move(name);
+        auto id = free_ids.back();
+        free_ids.pop_back();
 
-            ref_counts[gid.id()] = 0;
+        names[id] = std::move(name);
+        generations[id] += 1;
+        deleted[id] = false;
 
-            cpu_datas[gid.id()] = std::nullopt;
-            gpu_datas[gid.id()] = UploadedModelData{};
+        return {generations[id], id};
+    }
 
-            generations[gid.id()] += 1;
-            deleted[gid.id()] = false;
+    bool Registry::free(gid gid) {
+        if (!is_alive(gid)) return false;
 
-            gid = models::gid{generations[gid.id()], gid.id()};
-        } else {
-            std::lock_guard lock{gid_read};
+        names[gid.id()] = "";
+        generations[gid.id()] += 1;
+        deleted[gid.id()] = true;
+        free_ids.emplace_back(gid.id());
 
-            gid = {0, (uint32_t)names.size()};
+        return true;
+    }
 
-            names.emplace_back(std::move(name));
+    bool Registry::is_alive(gid gid) const {
+        return gid.id() < size() && generations[gid.id()] == gid.gen() && !deleted[gid.id()];
+    }
 
-            ref_counts.emplace_back(0);
+    void load(const nlohmann::json& j) {
+        assert(init_called);
 
-            cpu_datas.emplace_back(std::nullopt);
-            gpu_datas.emplace_back(UploadedModelData{});
+        std::unique_lock lock{slots_lock};
 
-            generations.emplace_back(0);
-            deleted.emplace_back(false);
+        if (registry.size() > 0) {
+            destroy();
+
+            ref_counts.clear();
+
+            cpu_datas.clear();
+            gpu_datas.clear();
+
+            slots.clear();
         }
 
-        initializing_models.emplace_back(gid);
-        io_pool.enqueue({task::Add, gid, model});
+        registry.load(j);
 
-        return gid;
+        for (uint32_t i = 0; i < registry.size(); i++) {
+            ref_counts.emplace_back(0);
+            cpu_datas.emplace_back();
+            gpu_datas.emplace_back();
+
+            slots.emplace_back(std::make_unique<Slot>());
+            slots.back()->generation.store(registry.generations[i], std::memory_order_relaxed);
+        }
     }
 
-    gid add(AddFn&& add_fn, std::string name) {
+    nlohmann::json save() {
         assert(init_called);
 
-        gid gid;
-        if (auto gid_ = find_empty_gid(); gid_) {
-            gid = *gid_;
-            uint8_t gid_gen = gid.gen();
+        return registry.save();
+    }
 
-            names[gid.id()] = std::move(name);
+    gid new_gid(std::string name) {
+        gid gid;
+        if (!registry.free_ids.empty()) {
+            gid = registry.alloc(std::move(name));
 
             ref_counts[gid.id()] = 0;
 
             cpu_datas[gid.id()] = std::nullopt;
             gpu_datas[gid.id()] = UploadedModelData{};
-
-            generations[gid.id()] += 1;
-            deleted[gid.id()] = false;
-
-            gid = models::gid{generations[gid.id()], gid.id()};
         } else {
-            std::lock_guard lock{gid_read};
-
-            gid = {0, (uint32_t)names.size()};
+            std::unique_lock lock{slots_lock};
 
-            names.emplace_back(std::move(name));
+            gid = registry.alloc(std::move(name));
 
             ref_counts.emplace_back(0);
 
             cpu_datas.emplace_back(std::nullopt);
             gpu_datas.emplace_back(UploadedModelData{});
 
-            generations.emplace_back(0);
-            deleted.emplace_back(false);
+            slots.emplace_back(std::make_unique<Slot>());
         }
 
-        initializing_models.emplace_back(gid);
-        io_pool.enqueue({task::AddCustom, gid, add_fn});
+        auto& slot = *slots[gid.id()];
+        slot.generation.store(gid.gen(), std::memory_order_release);
+        slot.initializing = true;
+        slot.load_after_init = false;
+
+        return gid;
+    }
+
+    gid add(Model model, std::string name) {
+        assert(init_called);
+
+        auto gid = new_gid(std::move(name));
+        enqueue({task::Add, gid, model}, scheduler::Priority::Low);
+
+        return gid;
+    }
+
+    gid add(AddFn&& add_fn, std::string name) {
+        assert(init_called);
+
+        auto gid = new_gid(std::move(name));
+        enqueue({task::AddCustom, gid, add_fn}, scheduler::Priority::Low);
 
         return gid;
     }
@@ -404,44 +470,40 @@ namespace engine::models {
     bool remove(gid gid) {
         assert(init_called);
 
-        if (generations[gid.id()] != gid.gen()) return false;
-        if (deleted[gid.id()]) return false;
+        if (!registry.free(gid)) return false;
 
-        deleted[gid.id()] = true;
-        generations[gid.id()] += 1;
+        auto& slot = *slots[gid.id()];
+        slot.generation.store(registry.generations[gid.id()], std::memory_order_release);
+        slot.initializing = false;
+        slot.load_after_init = false;
+
+        // waits for a worker still writing or reading the file
+        std::lock_guard lock{slot.io};
 
         auto model_path = models_directory / make_model_path(gid);
         if (std::filesystem::exists(model_path)) {
-            uint32_t model_size;
-            auto* model_data = util::read_file(models_directory / make_model_path(gid), &model_size);
-
-            Model model;
-            Model::load(model, {model_data, model_size});
+            Model model{};
+            if (Model::map(model, model_path)) {
+                for (size_t i = 0; i < model.mesh_count; i++) {
+                    auto& mesh = model.meshes[i];
 
-            for (size_t i = 0; i < model.mesh_count; i++) {
-                auto& mesh = model.meshes[i];
+                    auto mat_gid = mesh.material_instance;
 
-                auto mat_gid = mesh.material_instance;
+                    mats->release_instance(mat_gid);
+                }
 
-                mats->release_instance(mat_gid);
+                model.destroy();
             }
 
-            model.destroy();
-
             std::filesystem::remove(models_directory / make_model_path(gid));
         }
 
         if (cpu_datas[gid.id()]) cpu_datas[gid.id()]->destroy();
         gpu_datas[gid.id()].destroy();
 
-        names[gid.id()] = "";
-
         cpu_datas[gid.id()] = std::nullopt;
         gpu_datas[gid.id()] = UploadedModelData{};
 
-        std::erase_if(initializing_models,
-                      [&gid](auto igid) { return gid == igid || generations[igid.id()] != igid.gen(); });
-
         modified();
 
         return true;
@@ -450,15 +512,15 @@ namespace engine::models {
     std::expected<std::string*, Err> get_name(gid gid) {
         assert(init_called);
 
-        if (generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
+        if (registry.generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
 
-        return &names[gid.id()];
+        return &registry.names[gid.id()];
     }
 
     std::expected<engine::Model*, Err> get_cpu_model(gid gid) {
         assert(init_called);
 
-        if (generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
+        if (registry.generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
 
         auto& model = cpu_datas[gid.id()];
         return model ? &*model : nullptr;
@@ -467,7 +529,7 @@ namespace engine::models {
     std::expected<transport2::ticket, Err> get_ticket(gid gid) {
         assert(init_called);
 
-        if (generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
+        if (registry.generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
 
         return gpu_datas[gid.id()].group.ticket;
     }
@@ -475,7 +537,7 @@ namespace engine::models {
     std::expected<engine::Buffer, Err> get_draw_buffer(gid gid) {
         assert(init_called);
 
-        if (generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
+        if (registry.generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
 
         return gpu_datas[gid.id()].draw_buffer;
     }
@@ -483,7 +545,7 @@ namespace engine::models {
     std::expected<engine::GPUModel, Err> get_gpu_model(gid gid) {
         assert(init_called);
 
-        if (generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
+        if (registry.generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
 
         return gpu_datas[gid.id()].gpu;
     }
@@ -491,7 +553,7 @@ namespace engine::models {
     std::expected<engine::GPUGroup, Err> get_gpu_group(gid gid) {
         assert(init_called);
 
-        if (generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
+        if (registry.generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
 
         return gpu_datas[gid.id()].group;
     }
@@ -499,13 +561,13 @@ namespace engine::models {
     uint8_t get_generation(uint32_t ix) {
         assert(init_called);
 
-        return generations[ix];
+        return registry.generations[ix];
     }
 
     std::expected<LoadState, Err> is_loaded(gid gid) {
         assert(init_called);
 
-        if (generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
+        if (registry.generations[gid.id()] != gid.gen()) return std::unexpected(Err::BadGeneration);
 
         if (engine::transport2::is_ready(gpu_datas[gid.id()].group.ticket)) return LoadState::OnGPU;
         if (cpu_datas[gid.id()]) return LoadState::OnCPU;
@@ -515,17 +577,27 @@ namespace engine::models {
     void acquire(const gid* gids, uint32_t count) {
         assert(init_called);
 
+        std::vector<gid> load_gids{};
         for (size_t i = 0; i < count; i++) {
             auto gid = gids[i];
             if (gid == models::gid{}) continue;
-            if (generations[gid.id()] != gid.gen()) continue;
+            if (registry.generations[gid.id()] != gid.gen()) continue;
 
-            if (++ref_counts[gid.id()] != 1) return;
+            if (++ref_counts[gid.id()] != 1) continue;
 
             cpu_datas[gid.id()] = std::nullopt;
             gpu_datas[gid.id()] = {};
-            io_pool.enqueue({task::Acquire, gid});
+
+            auto& slot = *slots[gid.id()];
+            if (slot.initializing) {
+                slot.load_after_init = true;
+                continue;
+            }
+
+            load_gids.emplace_back(gid);
         }
+
+        enqueue_loads(load_gids);
     }
 
     void release(const gid* gids, uint32_t count) {
@@ -534,7 +606,7 @@ namespace engine::models {
         for (std::size_t i = 0; i < count; i++) {
             auto gid = gids[i];
             if (gid == models::gid{}) continue;
-            if (generations[gid.id()] != gid.gen()) continue;
+            if (registry.generations[gid.id()] != gid.gen()) continue;
             if (ref_counts[gid.id()] == 0 || --ref_counts[gid.id()] != 0) continue;
 
             if (cpu_datas[gid.id()]) {
@@ -551,7 +623,7 @@ namespace engine::models {
     }
 
     std::span<std::string> get_names() {
-        return names;
+        return registry.names;
     }
 
     void modified() {
@@ -559,24 +631,24 @@ namespace engine::models {
     }
 
     bool is_deleted(gid gid) {
-        if (generations[gid.id()] > gid.gen()) return true;
-        return deleted[gid.id()];
+        if (registry.generations[gid.id()] > gid.gen()) return true;
+        return registry.deleted[gid.id()];
     }
 
     void reupload(gid gid) {
         assert(init_called);
 
-        if (names.size() <= gid.id()) return;
-        if (generations[gid.id()] != gid.gen()) return;
+        if (registry.size() <= gid.id()) return;
+        if (registry.generations[gid.id()] != gid.gen()) return;
 
         gpu_datas[gid.id()].destroy();
         gpu_datas[gid.id()] = UploadedModelData{};
 
-        io_pool.enqueue({task::ReLoad, gid});
+        enqueue({task::ReLoad, gid}, scheduler::Priority::Normal);
     }
 
     void modified_cpu_data(gid gid) {
-        io_pool.enqueue({task::Save, gid});
+        enqueue({task::Save, gid}, scheduler::Priority::Low);
     }
 }
 
@@ -585,7 +657,7 @@ namespace engine::culling {
                                              uint32_t default_transform_offset) {
         assert(models::init_called);
 
-        if (models::generations[gid.id()] != gid.gen()) return std::unexpected(models::Err::BadGeneration);
+        if (models::registry.generations[gid.id()] != gid.gen()) return std::unexpected(models::Err::BadGeneration);
 
         auto& gpu = models::gpu_datas[gid.id()];
         engine::culling::flatten(gpu.group.data.address(), gpu.gpu.mesh_count, gpu.draw_buffer.address(),
@@ -593,4 +665,19 @@ namespace engine::culling {
 
         return {};
     }
+
+    std::expected<InstanceDescriptor, models::Err> describe(models::gid gid, uint32_t transform_offset) {
+        assert(models::init_called);
+
+        if (models::registry.generations[gid.id()] != gid.gen()) return std::unexpected(models::Err::BadGeneration);
+
+        auto& gpu = models::gpu_datas[gid.id()];
+        return InstanceDescriptor{
+            .group_addr = gpu.group.data.address(),
+            .draw_buffer_addr = gpu.draw_buffer.address(),
+            .draw_count = gpu.gpu.mesh_count,
+            .transform_offset = transform_offset,
+            .first_draw = 0,
+        };
+    }
 }
@@ -1,11 +1,49 @@
 #include "goliath/scenes.hpp"
+#include "goliath/culling.hpp"
+#include "goliath/engine.hpp"
 #include "goliath/models.hpp"
 #include "goliath/transport2.hpp"
 #include "goliath/util.hpp"
+#include <algorithm>
+#include <cstring>
 #include <glm/gtc/type_ptr.hpp>
 #include <vulkan/vulkan_core.h>
 
 namespace engine::scenes {
+    struct TransformRange {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    // one per frame in flight, a frame only writes the copy the GPU is done reading
+    struct TransformsBuffer {
+        Buffer buffer{};
+        transport2::ticket ticket{};
+        // in matrices, the buffer is only recreated once the transforms outgrow it
+        uint32_t capacity = 0;
+        // ranges of the scene's transforms that changed since this copy was last uploaded
+        std::vector<TransformRange> dirty{};
+
+        void destroy() {
+            transport2::unqueue(ticket);
+            if (buffer != Buffer{}) buffer.destroy();
+
+            buffer = Buffer{};
+            ticket = {};
+            capacity = 0;
+            dirty.clear();
+        }
+    };
+
+    struct DescriptorBuffer {
+        Buffer buffer{};
+        void* host = nullptr;
+        bool coherent = false;
+        // in descriptors
+        uint32_t capacity = 0;
+        uint32_t version = 0;
+    };
+
     struct Scene {
         std::vector<models::gid> used_models;
         std::vector<std::vector<size_t>> instances_of_used_models;
@@ -13,8 +51,13 @@ namespace engine::scenes {
         std::vector<models::gid> instance_models{};
         std::vector<glm::mat4> instance_transforms{};
 
-        transport2::ticket instance_transforms_buffer_ticket;
-        Buffer instance_transforms_buffer;
+        TransformsBuffer transforms_buffers[frames_in_flight]{};
+
+        // what the last scene flatten saw, a frame's buffer is only rewritten once it falls behind `descriptors_version`
+        std::vector<culling::InstanceDescriptor> instance_descriptors{};
+        uint32_t descriptors_version = 0;
+        uint32_t draw_count = 0;
+        DescriptorBuffer descriptor_buffers[frames_in_flight]{};
     };
 
     void to_json(nlohmann::json& j, const Scene& scene) {
@@ -78,9 +121,13 @@ namespace engine::scenes {
         const auto& used_models = scenes[scene_ix].used_models;
         auto rc = scene_ref_counts[scene_ix];
 
-        transport2::unqueue(scenes[scene_ix].instance_transforms_buffer_ticket);
-        scenes[scene_ix].instance_transforms_buffer.destroy();
-        scenes[scene_ix].instance_transforms_buffer = Buffer{};
+        for (auto& transforms : scenes[scene_ix].transforms_buffers) {
+            transforms.destroy();
+        }
+        for (auto& descriptors : scenes[scene_ix].descriptor_buffers) {
+            if (descriptors.buffer != Buffer{}) descriptors.buffer.destroy();
+            descriptors = DescriptorBuffer{};
+        }
         light_buffers[scene_ix].first.destroy();
         light_buffers[scene_ix].first = Buffer{};
 
@@ -132,9 +179,9 @@ namespace engine::scenes {
         scene_ref_counts[scene_ix]--;
 
         auto& scene = scenes[scene_ix];
-        scene.instance_transforms_buffer.destroy();
-        scene.instance_transforms_buffer = Buffer{};
-        scene.instance_transforms_buffer_ticket = {};
+        for (auto& transforms : scene.transforms_buffers) {
+            transforms.destroy();
+        }
         light_buffers[scene_ix].first.destroy();
         light_buffers[scene_ix].first = Buffer{};
         light_buffers[scene_ix].second = {};
@@ -150,6 +197,7 @@ namespace engine::scenes {
         scene.instance_models.emplace_back(model);
         scene.instance_transforms.emplace_back(transform);
         instance_namess[scene_ix].emplace_back(name);
+        mark_transforms_dirty(scene_ix, scene.instance_transforms.size() - 1, 1);
 
         update_buffers(scene_ix);
         want_save = true;
@@ -163,6 +211,8 @@ namespace engine::scenes {
         scene.instance_transforms.erase(scene.instance_transforms.begin() + instance_ix);
         scene.instance_models.erase(scene.instance_models.begin() + instance_ix);
         instance_namess[scene_ix].erase(instance_namess[scene_ix].begin() + instance_ix);
+        // everything after the removed instance moved down by one
+        mark_transforms_dirty(scene_ix, instance_ix, scene.instance_transforms.size() - instance_ix);
 
         for (auto& insts : scene.instances_of_used_models) {
             std::erase_if(insts, [&](auto& inst_ix) {
@@ -289,8 +339,12 @@ namespace engine::scenes {
     }
 
     Buffer get_instance_transforms_buffer(size_t scene_ix, transport2::ticket& ticket) {
-        ticket = scenes[scene_ix].instance_transforms_buffer_ticket;
-        return scenes[scene_ix].instance_transforms_buffer;
+        // changes made since this frame's copy was last written go out together
+        auto& transforms = scenes[scene_ix].transforms_buffers[get_current_frame()];
+        if (!transforms.dirty.empty()) upload_transforms(scene_ix);
+
+        ticket = transforms.ticket;
+        return transforms.buffer;
     }
 
     std::span<const models::gid> get_used_models(size_t scene_ix) {
@@ -327,26 +381,95 @@ namespace engine::scenes {
         want_save = true;
     }
 
-    void update_buffers(size_t scene_ix) {
+    void mark_transforms_dirty(size_t scene_ix, size_t first, size_t count) {
+        if (count == 0) return;
+
+        for (auto& transforms : scenes[scene_ix].transforms_buffers) {
+            transforms.dirty.emplace_back(TransformRange{(uint32_t)first, (uint32_t)count});
+        }
+    }
+
+    void set_instance_transforms(size_t scene_ix, size_t first, std::span<const glm::mat4> transforms) {
         auto& scene = scenes[scene_ix];
-        if (scene.instance_transforms.empty()) {
-            if (scene.instance_transforms_buffer != Buffer{}) scene.instance_transforms_buffer.destroy();
+        assert(first + transforms.size() <= scene.instance_transforms.size());
 
-            scene.instance_transforms_buffer = {};
-            scene.instance_transforms_buffer_ticket = {};
+        std::copy(transforms.begin(), transforms.end(), scene.instance_transforms.begin() + first);
+        mark_transforms_dirty(scene_ix, first, transforms.size());
+    }
+
+    void upload_transforms(size_t scene_ix) {
+        auto& scene = scenes[scene_ix];
+        auto count = (uint32_t)scene.instance_transforms.size();
+
+        // frames still in flight read the other copies, writing this one can't race them
+        auto frame = get_current_frame();
+        auto& transforms = scene.transforms_buffers[frame];
+
+        if (count == 0) {
+            transforms.destroy();
             return;
         }
 
-        scene.instance_transforms_buffer.destroy();
-        scene.instance_transforms_buffer =
-            Buffer::create(std::format("Scene `{}`'s transforms buffer", scene_names[scene_ix]).c_str(),
-                           scene.instance_transforms.size() * sizeof(glm::mat4),
-                           VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT, std::nullopt);
+        if (transforms.capacity < count) {
+            transforms.capacity = std::max({count, transforms.capacity * 2, 64u});
 
-        scene.instance_transforms_buffer_ticket =
-            transport2::upload(true, scene.instance_transforms.data(), std::nullopt,
-                               scene.instance_transforms_buffer.size(), scene.instance_transforms_buffer, 0,
-                               VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+            transforms.buffer.destroy();
+            transforms.buffer =
+                Buffer::create(std::format("Scene `{}`'s transforms buffer #{}", scene_names[scene_ix], frame).c_str(),
+                               transforms.capacity * sizeof(glm::mat4),
+                               VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_2_TRANSFER_DST_BIT, std::nullopt);
+
+            transforms.dirty.clear();
+            transforms.dirty.emplace_back(TransformRange{0, count});
+        }
+
+        if (transforms.dirty.empty()) return;
+
+        auto& ranges = transforms.dirty;
+        std::sort(ranges.begin(), ranges.end(), [](auto a, auto b) { return a.first < b.first; });
+
+        // a few clean matrices in between are cheaper to send along than another copy
+        static constexpr uint32_t merge_gap = 4;
+        std::vector<TransformRange> merged{};
+        for (auto range : ranges) {
+            if (range.first >= count) continue;
+            range.count = std::min(range.count, count - range.first);
+
+            if (!merged.empty() && range.first <= merged.back().first + merged.back().count + merge_gap) {
+                auto end = std::max(merged.back().first + merged.back().count, range.first + range.count);
+                merged.back().count = end - merged.back().first;
+            } else {
+                merged.emplace_back(range);
+            }
+        }
+        ranges.clear();
+
+        // copied, `instance_transforms` can reallocate before the upload is picked up
+        std::vector<transport2::BufferUpload> uploads{};
+        uploads.reserve(merged.size());
+        for (auto range : merged) {
+            auto size = range.count * (uint32_t)sizeof(glm::mat4);
+            auto* data = malloc(size);
+            std::memcpy(data, scene.instance_transforms.data() + range.first, size);
+
+            uploads.emplace_back(transport2::BufferUpload{
+                .src = data,
+                .own = free,
+                .size = size,
+                .dst = transforms.buffer,
+                .dst_offset = range.first * (uint32_t)sizeof(glm::mat4),
+                .dst_stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                .dst_access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+            });
+        }
+
+        std::vector<transport2::ticket> tickets(uploads.size());
+        transport2::upload(true, uploads, tickets);
+        transforms.ticket = tickets.back();
+    }
+
+    void update_buffers(size_t scene_ix) {
+        upload_transforms(scene_ix);
 
         auto& light_buf = light_buffers[scene_ix];
 
@@ -383,3 +506,92 @@ namespace engine::scenes {
         return Iterator{scene_ix};
     }
 }
+
+namespace engine::culling {
+    transport2::ticket flatten_scene(size_t scene_ix) {
+        auto& scene = scenes::scenes[scene_ix];
+
+        transport2::ticket ticket;
+        auto transforms = scenes::get_instance_transforms_buffer(scene_ix, ticket);
+
+        // cheap enough to redo every frame, it is only compared against what the gpu already has
+        std::vector<InstanceDescriptor> descriptors{};
+        descriptors.reserve(scene.instance_models.size());
+        uint32_t draw_count = 0;
+        for (uint32_t i = 0; i < scene.instance_models.size(); i++) {
+            auto mgid = scene.instance_models[i];
+            if (auto state = models::is_loaded(mgid); !state || *state != models::LoadState::OnGPU) continue;
+
+            auto descriptor = describe(mgid, i * (uint32_t)sizeof(glm::mat4));
+            if (!descriptor || descriptor->draw_count == 0) continue;
+
+            descriptor->first_draw = draw_count;
+            draw_count += descriptor->draw_count;
+            descriptors.emplace_back(*descriptor);
+        }
+
+        if (descriptors.size() != scene.instance_descriptors.size() ||
+            std::memcmp(descriptors.data(), scene.instance_descriptors.data(),
+                        descriptors.size() * sizeof(InstanceDescriptor)) != 0) {
+            scene.instance_descriptors = std::move(descriptors);
+            scene.draw_count = draw_count;
+            scene.descriptors_version++;
+        }
+
+        if (scene.instance_descriptors.empty()) return ticket;
+
+        auto count = (uint32_t)scene.instance_descriptors.size();
+        auto& descriptors_buffer = scene.descriptor_buffers[get_current_frame()];
+        if (descriptors_buffer.capacity < count) {
+            descriptors_buffer.capacity = std::max({count, descriptors_buffer.capacity * 2, 64u});
+
+            if (descriptors_buffer.buffer != Buffer{}) descriptors_buffer.buffer.destroy();
+            descriptors_buffer.buffer = Buffer::create(
+                std::format("Scene `{}`'s instance descriptors #{}", scenes::scene_names[scene_ix], get_current_frame())
+                    .c_str(),
+                descriptors_buffer.capacity * sizeof(InstanceDescriptor), VK_BUFFER_USAGE_2_STORAGE_BUFFER_BIT,
+                {{&descriptors_buffer.host, &descriptors_buffer.coherent}});
+            descriptors_buffer.version = scene.descriptors_version - 1;
+        }
+
+        if (descriptors_buffer.version != scene.descriptors_version) {
+            auto size = count * (uint32_t)sizeof(InstanceDescriptor);
+            std::memcpy(descriptors_buffer.host, scene.instance_descriptors.data(), size);
+            if (!descriptors_buffer.coherent) descriptors_buffer.buffer.flush_mapped(0, size);
+
+            descriptors_buffer.version = scene.descriptors_version;
+        }
+
+        bind_flatten_instances();
+        flatten_instances(descriptors_buffer.buffer.address(), count, scene.draw_count, transforms.address());
+
+        return ticket;
+    }
+
+    CullStats reference_cull(size_t scene_ix, const glm::mat4& view_proj) {
+        auto& scene = scenes::scenes[scene_ix];
+        auto frustum = frustum_from(view_proj);
+
+        CullStats stats{};
+        for (uint32_t i = 0; i < scene.instance_models.size(); i++) {
+            auto mgid = scene.instance_models[i];
+            if (auto state = models::is_loaded(mgid); !state || *state != models::LoadState::OnGPU) continue;
+
+            auto model = models::get_cpu_model(mgid);
+            if (!model || *model == nullptr) continue;
+
+            auto& m = **model;
+            for (uint32_t j = 0; j < m.mesh_indices_count; j++) {
+                auto mesh_ix = m.mesh_indexes[j];
+
+                stats.tested++;
+                if (!is_visible(frustum, scene.instance_transforms[i] * m.mesh_transforms[mesh_ix],
+                                m.meshes[mesh_ix].bounding_box)) {
+                    stats.culled++;
+                }
+            }
+        }
+
+        return stats;
+    }
+}
@@ -0,0 +1,305 @@
+#include "goliath/scheduler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace engine::scheduler {
+    static constexpr std::size_t priority_count = 3;
+
+    struct JobSlot {
+        // held while the job finishes and while another job registers itself as a dependent
+        std::mutex lock{};
+        // bumped when the job finishes, a `job` with an older generation is done
+        std::atomic<uint32_t> generation = 0;
+
+        JobFn fn{};
+        Priority priority = Priority::Normal;
+        // unfinished dependencies, plus one while `submit` is still registering them
+        std::atomic<uint32_t> pending = 0;
+        std::vector<uint32_t> dependents{};
+    };
+
+    // the owner pushes and pops at the back, everyone else steals from the front
+    struct Worker {
+        std::mutex lock{};
+        std::array<std::deque<uint32_t>, priority_count> queues{};
+    };
+
+    struct State {
+        static constexpr uint32_t slot_chunk_size = 1024;
+        static constexpr uint32_t max_slot_chunks = 4096;
+        // chunks are never moved or freed while the scheduler lives, so slots can be accessed without a lock
+        std::array<std::atomic<JobSlot*>, max_slot_chunks> slot_chunks{};
+
+        std::mutex slots_lock{};
+        uint32_t slot_count = 0;
+        std::vector<uint32_t> free_slots{};
+
+        std::vector<std::unique_ptr<Worker>> workers{};
+        std::vector<std::thread> threads{};
+        std::atomic<uint32_t> next_worker = 0;
+
+        std::atomic<bool> stop = false;
+        // bumped whenever a job gets queued, idle workers park on it
+        std::atomic<uint32_t> work_epoch = 0;
+        // bumped whenever a job finishes, `wait` parks on it
+        std::atomic<uint32_t> done_epoch = 0;
+
+        State();
+        ~State();
+    };
+
+    // index into `State::workers` of the calling thread, -1 outside of the workers
+    thread_local int32_t current_worker = -1;
+
+    void worker_loop(State& state, int32_t index);
+
+    State::State() {
+        // hardware_concurrency() may be 0 when it is unknown, keeps at least one worker without wrapping around
+        uint32_t count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        for (uint32_t i = 0; i < count; i++) {
+            workers.emplace_back(std::make_unique<Worker>());
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            threads.emplace_back([this, i] { worker_loop(*this, (int32_t)i); });
+        }
+    }
+
+    State::~State() {
+        stop.store(true, std::memory_order_release);
+        work_epoch.fetch_add(1, std::memory_order_release);
+        work_epoch.notify_all();
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        for (auto& chunk : slot_chunks) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+
+    State& get_state() {
+        static State state{};
+        return state;
+    }
+
+    JobSlot* get_slot(State& state, uint32_t id) {
+        auto* chunk = state.slot_chunks[id / State::slot_chunk_size].load(std::memory_order_acquire);
+        if (chunk == nullptr) return nullptr;
+
+        return &chunk[id % State::slot_chunk_size];
+    }
+
+    uint32_t alloc_slot(State& state) {
+        std::lock_guard lock{state.slots_lock};
+
+        if (!state.free_slots.empty()) {
+            auto id = state.free_slots.back();
+            state.free_slots.pop_back();
+            return id;
+        }
+
+        auto id = state.slot_count++;
+        auto chunk_ix = id / State::slot_chunk_size;
+        assert(chunk_ix < State::max_slot_chunks);
+
+        if (state.slot_chunks[chunk_ix].load(std::memory_order_relaxed) == nullptr) {
+            state.slot_chunks[chunk_ix].store(new JobSlot[State::slot_chunk_size], std::memory_order_release);
+        }
+
+        return id;
+    }
+
+    void free_slot(State& state, uint32_t id) {
+        std::lock_guard lock{state.slots_lock};
+        state.free_slots.emplace_back(id);
+    }
+
+    void schedule(State& state, uint32_t id) {
+        auto priority = (std::size_t)get_slot(state, id)->priority;
+
+        // jobs spawned by a worker stay on its deque, everything else is spread over the workers
+        auto index = current_worker >= 0
+                         ? (uint32_t)current_worker
+                         : state.next_worker.fetch_add(1, std::memory_order_relaxed) % state.workers.size();
+
+        auto& worker = *state.workers[index];
+        {
+            std::lock_guard lock{worker.lock};
+            worker.queues[priority].emplace_back(id);
+        }
+
+        state.work_epoch.fetch_add(1, std::memory_order_release);
+        state.work_epoch.notify_one();
+    }
+
+    // higher priorities are looked for across every worker before falling back to lower ones, only the first
+    // `priorities` levels are looked at
+    bool pop(State& state, uint32_t& id, std::size_t priorities) {
+        auto worker_count = state.workers.size();
+        auto start = current_worker >= 0 ? (std::size_t)current_worker : 0;
+
+        for (std::size_t priority = 0; priority < priorities; priority++) {
+            if (current_worker >= 0) {
+                auto& worker = *state.workers[current_worker];
+                std::lock_guard lock{worker.lock};
+
+                auto& queue = worker.queues[priority];
+                if (!queue.empty()) {
+                    id = queue.back();
+                    queue.pop_back();
+                    return true;
+                }
+            }
+
+            for (std::size_t i = 0; i < worker_count; i++) {
+                auto victim = (start + i) % worker_count;
+                if ((int32_t)victim == current_worker) continue;
+
+                auto& worker = *state.workers[victim];
+                std::lock_guard lock{worker.lock};
+
+                auto& queue = worker.queues[priority];
+                if (!queue.empty()) {
+                    id = queue.front();
+                    queue.pop_front();
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void finish(State& state, uint32_t id) {
+        auto& slot = *get_slot(state, id);
+
+        std::vector<uint32_t> dependents{};
+        {
+            std::lock_guard lock{slot.lock};
+            dependents = std::move(slot.dependents);
+            slot.dependents.clear();
+            slot.generation.fetch_add(1, std::memory_order_release);
+        }
+        free_slot(state, id);
+
+        for (auto dependent : dependents) {
+            if (get_slot(state, dependent)->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                schedule(state, dependent);
+            }
+        }
+
+        state.done_epoch.fetch_add(1, std::memory_order_release);
+        state.done_epoch.notify_all();
+    }
+
+    bool run_one(State& state, std::size_t priorities = priority_count) {
+        uint32_t id;
+        if (!pop(state, id, priorities)) return false;
+
+        auto fn = std::move(get_slot(state, id)->fn);
+        fn();
+        finish(state, id);
+
+        return true;
+    }
+
+    void worker_loop(State& state, int32_t index) {
+        current_worker = index;
+
+        while (!state.stop.load(std::memory_order_acquire)) {
+            auto epoch = state.work_epoch.load(std::memory_order_acquire);
+            if (run_one(state)) continue;
+
+            state.work_epoch.wait(epoch, std::memory_order_acquire);
+        }
+    }
+
+    uint32_t worker_count() {
+        return get_state().workers.size();
+    }
+
+    job submit(JobFn fn, Priority priority, std::span<const job> dependencies) {
+        auto& state = get_state();
+
+        auto id = alloc_slot(state);
+        auto& slot = *get_slot(state, id);
+        slot.fn = std::move(fn);
+        slot.priority = priority;
+        slot.pending.store(1, std::memory_order_relaxed);
+
+        for (auto dependency : dependencies) {
+            if (dependency == job{}) continue;
+
+            auto* dep_slot = get_slot(state, dependency.id());
+            if (dep_slot == nullptr) continue;
+
+            std::lock_guard lock{dep_slot->lock};
+            if (dep_slot->generation.load(std::memory_order_acquire) != dependency.gen()) continue;
+
+            slot.pending.fetch_add(1, std::memory_order_relaxed);
+            dep_slot->dependents.emplace_back(id);
+        }
+
+        // read before the job can be scheduled, it might finish and bump it right away
+        auto handle = job{slot.generation.load(std::memory_order_relaxed), id};
+        if (slot.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) schedule(state, id);
+
+        return handle;
+    }
+
+    bool is_done(job job) {
+        if (job == scheduler::job{}) return true;
+
+        auto* slot = get_slot(get_state(), job.id());
+        if (slot == nullptr) return true;
+
+        return slot->generation.load(std::memory_order_acquire) != job.gen();
+    }
+
+    void wait(job job) {
+        auto& state = get_state();
+
+        // low priority jobs are io that can wait on the main thread, other threads only help with the rest
+        auto priorities = current_worker >= 0 ? priority_count : (std::size_t)Priority::Low;
+
+        while (!is_done(job)) {
+            auto epoch = state.done_epoch.load(std::memory_order_acquire);
+            if (is_done(job)) return;
+            if (run_one(state, priorities)) continue;
+
+            state.done_epoch.wait(epoch, std::memory_order_acquire);
+        }
+    }
+
+    void wait(std::span<const job> jobs) {
+        for (auto job : jobs) {
+            wait(job);
+        }
+    }
+
+    void parallel_for(uint32_t count, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& fn,
+                      Priority priority) {
+        if (count == 0) return;
+        grain = std::max(grain, 1u);
+
+        std::vector<job> jobs{};
+        jobs.reserve((count + grain - 1) / grain);
+        for (uint32_t begin = grain; begin < count; begin += grain) {
+            auto end = std::min(count, begin + grain);
+            jobs.emplace_back(submit([&fn, begin, end] { fn(begin, end); }, priority));
+        }
+
+        fn(0, std::min(count, grain));
+        wait(jobs);
+    }
+}
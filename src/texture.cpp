@@ -4,6 +4,7 @@
 #include "goliath/synchronization.hpp"
 #include "goliath/transport2.hpp"
 #include "goliath/vma_ptrs.hpp"
+#include <algorithm>
 #include <vulkan/vulkan_core.h>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -227,7 +228,53 @@ namespace engine::gpu_image {
         vma_ptrs::create_image(&builder._image_info, &alloc_info, &gpu_img.image, &gpu_img.allocation, nullptr);
         vma_ptrs::set_name(gpu_img.allocation, name);
 
-        if (builder._img_data != nullptr) {
+        if (!builder._levels.empty()) {
+            for (const auto& level : builder._levels) {
+                VkExtent3D extent{
+                    .width = std::max(builder._width >> level.mip, 1u),
+                    .height = std::max(builder._height >> level.mip, 1u),
+                    .depth = 1,
+                };
+                VkImageSubresourceLayers layers{
+                    .aspectMask = builder._aspect_mask,
+                    .mipLevel = level.mip,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1,
+                };
+
+                if (level.staged) {
+                    *level.ticket = transport2::upload(builder._priority, builder._image_info.format, extent,
+                                                       *level.staged, gpu_img.image, layers,
+                                                       VkOffset3D{.x = 0, .y = 0, .z = 0}, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                       builder._new_image_layout, dst_stage, dst_access);
+                } else {
+                    *level.ticket = transport2::upload(builder._priority, builder._image_info.format, extent,
+                                                       level.data, level.own, gpu_img.image, layers,
+                                                       VkOffset3D{.x = 0, .y = 0, .z = 0}, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                       builder._new_image_layout, dst_stage, dst_access);
+                }
+            }
+        } else if (builder._staged) {
+            *builder._ticket = transport2::upload(builder._priority, builder._image_info.format,
+                                                  VkExtent3D{
+                                                      .width = builder._width,
+                                                      .height = builder._height,
+                                                      .depth = 1,
+                                                  },
+                                                  *builder._staged, gpu_img.image,
+                                                  VkImageSubresourceLayers{
+                                                      .aspectMask = builder._aspect_mask,
+                                                      .mipLevel = 0,
+                                                      .baseArrayLayer = 0,
+                                                      .layerCount = 1,
+                                                  },
+                                                  VkOffset3D{
+                                                      .x = 0,
+                                                      .y = 0,
+                                                      .z = 0,
+                                                  },
+                                                  VK_IMAGE_LAYOUT_UNDEFINED, builder._new_image_layout, dst_stage, dst_access);
+        } else if (builder._img_data != nullptr) {
             *builder._ticket = transport2::upload(builder._priority, builder._image_info.format,
                                                   VkExtent3D{
                                                       .width = builder._width,
@@ -1,22 +1,20 @@
 #include "goliath/textures.hpp"
+#include "goliath/engine.hpp"
 #include "goliath/errors.hpp"
 #include "goliath/mspc_queue.hpp"
 #include "goliath/samplers.hpp"
-#include "goliath/thread_pool.hpp"
+#include "goliath/scheduler.hpp"
 
 #include "xxHash/xxhash.h"
 
+#include <algorithm>
+#include <array>
 #include <cstring>
 #include <fstream>
 #include <mutex>
+#include <unordered_map>
 #include <vulkan/vulkan_core.h>
 
-struct Metadata {
-    uint32_t width;
-    uint32_t height;
-    VkFormat format;
-};
-
 namespace engine {
     std::filesystem::path make_texture_path(Textures::gid gid) {
         return std::format("{:02X}{:06X}.goi", (uint8_t)gid.gen(), gid.id());
@@ -30,17 +28,59 @@ namespace engine {
         gid.value = j;
     }
 
+    // a .goi file is `Metadata` followed by the payload of every mip level, smallest level first so the tail of the
+    // chain can be read and uploaded before the rest. block compressed levels are stored as rows of 4x4 blocks
     struct Metadata {
+        static constexpr uint32_t goi_magic = 0x32494F47; // "GOI2"
+
+        uint32_t magic = goi_magic;
         uint32_t width;
         uint32_t height;
         VkFormat format;
+        uint32_t mip_levels = 1;
+    };
+
+    // files written before mip chains existed start with just this and hold a single level
+    struct LegacyMetadata {
+        uint32_t width;
+        uint32_t height;
+        VkFormat format;
+    };
+
+    Metadata read_metadata(std::ifstream& file) {
+        uint32_t magic = 0;
+        file.read((char*)&magic, sizeof(uint32_t));
+        file.seekg(-(std::streamoff)sizeof(uint32_t), std::ios::cur);
+
+        if (magic == Metadata::goi_magic) {
+            Metadata metadata{};
+            file.read((char*)&metadata, sizeof(Metadata));
+            return metadata;
+        }
+
+        LegacyMetadata legacy{};
+        file.read((char*)&legacy, sizeof(LegacyMetadata));
+        return Metadata{
+            .width = legacy.width,
+            .height = legacy.height,
+            .format = legacy.format,
+        };
+    }
+
+    struct upload_level {
+        uint8_t* data;
+        uint32_t size;
+        // set when `data` points into the staging arena instead of a malloc'd buffer
+        std::optional<transport2::Reservation> staged;
     };
 
     struct upload_task {
+        static constexpr uint32_t max_mip_levels = 16;
+
         Textures::gid gid;
-        uint8_t* image_data;
-        uint32_t image_size;
         Metadata metadata;
+        // in file order, smallest level first
+        std::array<upload_level, max_mip_levels> levels;
     };
 
     struct task {
@@ -60,44 +100,56 @@ namespace engine {
             return new TexturesImpl{};
         }
 
-        static constexpr std::size_t upload_queue_size = 64;
-        MSPCQueue<upload_task, upload_queue_size> upload_queue{};
+        static constexpr std::size_t upload_segment_size = 64;
+        SegmentedMSPCQueue<upload_task, upload_segment_size> upload_queue{};
 
         std::vector<Textures::gid> initializing_textures{};
-        static constexpr std::size_t initialized_queue_size = 32;
-        MSPCQueue<Textures::gid, initialized_queue_size> initialized_queue{};
+        // the job writing each initializing texture's file, an acquire in the meantime runs after it
+        std::unordered_map<uint32_t, scheduler::job> add_jobs{};
+        SegmentedMSPCQueue<Textures::gid> initialized_queue{};
 
         std::mutex gid_read{};
 
-        bool is_initializing(Textures::gid gid) {
-            return std::find(initializing_textures.begin(), initializing_textures.end(), gid) !=
-                   initializing_textures.end();
-        }
-
-        void load_texture_data(Textures& texs, Textures::gid gid, uint8_t*& image_data, uint32_t& image_size,
-                               Metadata& metadata) {
-            std::lock_guard locK{gid_read};
+        bool load_texture_data(Textures& texs, upload_task& up_task) {
+            auto gid = up_task.gid;
 
-            if (texs.generations[gid.id()] != gid.gen()) return;
+            // only the lookup happens under `gid_read`, `reserve` below can wait on the main thread which takes it
+            // in `add`
+            std::ifstream file{};
+            {
+                std::lock_guard locK{gid_read};
+                if (texs.registry.generations[gid.id()] != gid.gen()) return false;
 
-            auto path = texs.texture_directory / make_texture_path(gid);
+                file.open(texs.texture_directory / make_texture_path(gid), std::ios::binary);
+            }
 
-            std::ifstream file{path, std::ios::binary | std::ios::ate};
-            auto size_signed = file.tellg();
-            if (size_signed < 0) {
+            if (!file) {
                 auto error = Textures::LoadError{
                     .gid = gid,
                 };
                 errors::throw_err(errors::Textures_Load, &error);
-                return;
+                return false;
             }
 
-            image_size = (uint32_t)size_signed - sizeof(Metadata);
-            image_data = (uint8_t*)malloc(image_size);
+            auto& metadata = up_task.metadata;
+            metadata = read_metadata(file);
+            assert(metadata.mip_levels > 0 && metadata.mip_levels <= upload_task::max_mip_levels);
 
-            file.seekg(0, std::ios::beg);
-            file.read((char*)&metadata, sizeof(Metadata));
-            file.read((char*)image_data, image_size);
+            for (uint32_t i = 0; i < metadata.mip_levels; i++) {
+                uint32_t mip = metadata.mip_levels - 1 - i;
+                uint32_t size = transport2::image_size(metadata.format, std::max(metadata.width >> mip, 1u),
+                                                       std::max(metadata.height >> mip, 1u));
+
+                // only the first level may wait for the arena, later ones would be waiting on our own reservations
+                auto& level = up_task.levels[i];
+                level.size = size;
+                level.staged = transport2::reserve(size, transport2::image_alignment(metadata.format), i == 0);
+                level.data = level.staged ? level.staged->data : (uint8_t*)malloc(size);
+
+                file.read((char*)level.data, size);
+            }
+
+            return true;
         }
 
         void add_texture(Textures& texs, Textures::gid gid, std::filesystem::path orig_path) {
@@ -113,6 +165,7 @@ namespace engine {
                     .width = img.width,
                     .height = img.height,
                     .format = img.format,
+                    .mip_levels = 1,
                 };
 
                 std::ofstream file{path, std::ios::binary};
@@ -124,32 +177,29 @@ namespace engine {
             }
         }
 
-        static decltype(auto) thread_pool() {
-            return make_thread_pool([](task&& task) {
-                switch (task.type) {
-                    case task::Acquire: {
-                        while (task.texs->impl->is_initializing(task.gid)) {
-                            _mm_pause();
-                        }
-
-                        upload_task up_task{
-                            .gid = task.gid,
-                        };
-                        task.texs->impl->load_texture_data(*task.texs, task.gid, up_task.image_data, up_task.image_size,
-                                                           up_task.metadata);
+        static void run_task(task& task) {
+            switch (task.type) {
+                case task::Acquire: {
+                    upload_task up_task{
+                        .gid = task.gid,
+                    };
+                    if (task.texs->impl->load_texture_data(*task.texs, up_task)) {
                         task.texs->impl->upload_queue.enqueue(up_task);
-                        break;
                     }
-                    case task::Add:
-                        task.texs->impl->add_texture(*task.texs, task.gid, task.orig_path);
-                        task.texs->impl->initialized_queue.enqueue(task.gid);
-                        break;
+                    break;
                 }
-            });
-        };
-    };
+                case task::Add:
+                    task.texs->impl->add_texture(*task.texs, task.gid, task.orig_path);
+                    task.texs->impl->initialized_queue.enqueue(task.gid);
+                    break;
+            }
+        }
 
-    auto io_pool = textures::TexturesImpl::thread_pool();
+        static scheduler::job enqueue(task task, scheduler::Priority priority,
+                                      std::span<const scheduler::job> dependencies = {}) {
+            return scheduler::submit([task = std::move(task)]() mutable { run_task(task); }, priority, dependencies);
+        }
+    };
 
     Textures::Textures(const char* textures_directry, size_t texture_capacity)
         : texture_directory(textures_directry), texture_pool(std::max<uint32_t>(texture_capacity, 1)),
@@ -157,40 +207,46 @@ namespace engine {
         auto data = (uint8_t*)malloc(4);
         std::memset(data, 0xFF, 4);
 
-        names.emplace_back("Default texture");
-        generations.emplace_back(0);
-        deleted.emplace_back(false);
-
         ref_counts.emplace_back(1);
         gpu_images.emplace_back();
         gpu_image_views.emplace_back();
-        sampler_prototypes.emplace_back();
         samplers.emplace_back(sampler::create({}));
 
         impl->upload_queue.enqueue(upload_task{
             .gid = {0, 0},
-            .image_data = data,
-            .image_size = 4,
             .metadata =
                 Metadata{
                     .width = 1,
                     .height = 1,
                     .format = VK_FORMAT_R8G8B8A8_UNORM,
                 },
+            .levels = {upload_level{
+                .data = data,
+                .size = 4,
+            }},
         });
     }
 
     Textures::~Textures() {
-        for (std::size_t i = 0; i < names.size(); i++) {
+        for (std::size_t i = 0; i < registry.size(); i++) {
             gpu_image::destroy(gpu_images[i]);
             gpu_image_view::destroy(gpu_image_views[i]);
         }
+        for (const auto& retired : retired_views) {
+            gpu_image_view::destroy(retired.view);
+        }
 
         texture_pool.destroy();
         delete impl;
     }
 
     void Textures::process_uploads() {
+        upload_frame++;
+        while (!retired_views.empty() && retired_views.front().frame <= upload_frame) {
+            gpu_image_view::destroy(retired_views.front().view);
+            retired_views.pop_front();
+        }
+
         std::vector<upload_task> upload_tasks{};
         impl->upload_queue.drain(upload_tasks);
 
@@ -200,17 +256,27 @@ namespace engine {
         if (upload_tasks.size() != 0) {
             for (const auto& up_task : upload_tasks) {
                 auto gid = up_task.gid;
-                if (generations[gid.id()] == gid.gen() && ref_counts[gid.id()] != 0 && !deleted[gid.id()]) {
-                    auto metadata = up_task.metadata;
-                    transport2::ticket ticket{};
-                    samplers[gid.id()] = sampler::create(sampler_prototypes[gid.id()]);
-                    auto image = gpu_image::upload(names[gid.id()].c_str(),
-                                                   GPUImageInfo{}
-                                                       .width(metadata.width)
-                                                       .height(metadata.height)
-                                                       .format(metadata.format)
-                                                       .data(up_task.image_data, free, ticket, false)
-                                                       .size(up_task.image_size)
+                const auto& metadata = up_task.metadata;
+                if (registry.is_alive(gid) && ref_counts[gid.id()] != 0) {
+                    std::array<transport2::ticket, upload_task::max_mip_levels> tickets{};
+                    samplers[gid.id()] = sampler::create(registry.sampler_prototypes[gid.id()]);
+
+                    auto image_info = GPUImageInfo{}
+                                          .width(metadata.width)
+                                          .height(metadata.height)
+                                          .format(metadata.format)
+                                          .mip_levels(metadata.mip_levels);
+                    // smallest level first, so the texture shows up as soon as the tail of the chain lands
+                    for (uint32_t i = 0; i < metadata.mip_levels; i++) {
+                        const auto& level = up_task.levels[i];
+                        uint32_t mip = metadata.mip_levels - 1 - i;
+
+                        if (level.staged) image_info.level(mip, *level.staged, tickets[i], false);
+                        else image_info.level(mip, level.data, free, tickets[i], false);
+                    }
+
+                    auto image = gpu_image::upload(registry.names[gid.id()].c_str(),
+                                                   std::move(image_info)
                                                        .new_layout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
                                                        .aspect_mask(VK_IMAGE_ASPECT_COLOR_BIT),
                                                    VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
@@ -218,24 +284,49 @@ namespace engine {
                                                        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
                                                    VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
 
-                    gpu_image_views[gid.id()] =
-                        gpu_image_view::create(GPUImageView{image}.aspect_mask(VK_IMAGE_ASPECT_COLOR_BIT));
+                    for (uint32_t i = 0; i < metadata.mip_levels; i++) {
+                        finalize_queue.emplace_back(PendingLevel{
+                            .ticket = tickets[i],
+                            .gid = gid,
+                            .image = image.image,
+                            .mip = metadata.mip_levels - 1 - i,
+                            .mip_levels = metadata.mip_levels,
+                        });
+                    }
                     gpu_images[gid.id()] = std::move(image);
-
-                    finalize_queue.emplace_back(ticket, gid);
+                } else {
+                    for (uint32_t i = 0; i < metadata.mip_levels; i++) {
+                        const auto& level = up_task.levels[i];
+                        if (level.staged) transport2::release(*level.staged);
+                        else free(level.data);
+                    }
                 }
             }
         }
 
-        while (finalize_queue.size() > 0 && transport2::is_ready(finalize_queue.front().first)) {
-            auto gid = finalize_queue.front().second;
+        // levels of a texture land in upload order, every one of them widens its view by one more detailed level
+        while (finalize_queue.size() > 0 && transport2::is_ready(finalize_queue.front().ticket)) {
+            auto level = finalize_queue.front();
+            finalize_queue.pop_front();
 
-            if (generations[gid.id()] == gid.gen() && ref_counts[gid.id()] != 0 && !deleted[gid.id()]) {
-                texture_pool.update(gid.id(), gpu_image_views[gid.id()], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                    samplers[gid.id()]);
+            auto gid = level.gid;
+            if (!registry.is_alive(gid) || ref_counts[gid.id()] == 0) continue;
+            if (gpu_images[gid.id()].image != level.image) continue;
+
+            // every frame in flight may still have the old view bound through the pool
+            if (gpu_image_views[gid.id()] != nullptr) {
+                retired_views.emplace_back(RetiredView{
+                    .frame = upload_frame + frames_in_flight,
+                    .view = gpu_image_views[gid.id()],
+                });
             }
+            gpu_image_views[gid.id()] = gpu_image_view::create(GPUImageView{gpu_images[gid.id()]}
+                                                                   .aspect_mask(VK_IMAGE_ASPECT_COLOR_BIT)
+                                                                   .base_mip_level(level.mip)
+                                                                   .level_count(level.mip_levels - level.mip));
 
-            finalize_queue.pop_front();
+            texture_pool.update(gid.id(), gpu_image_views[gid.id()], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                samplers[gid.id()]);
         }
 
         bool initialized = false;
@@ -243,6 +334,7 @@ namespace engine {
             auto found =
                 std::find(initialized_gids.begin(), initialized_gids.end(), gid) != initialized_gids.end();
             initialized |= found;
+            if (found) impl->add_jobs.erase(gid.id());
             return found;
         });
 
@@ -250,8 +342,8 @@ namespace engine {
     }
 
     void Textures::rebuild_pool() {
-        for (uint32_t gid = 0; gid < names.size(); gid++) {
-            if (deleted[gid]) continue;
+        for (uint32_t gid = 0; gid < registry.size(); gid++) {
+            if (registry.deleted[gid]) continue;
             if (ref_counts[gid] == 0) continue;
 
             texture_pool.update(gid, gpu_image_views[gid], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
@@ -279,54 +371,36 @@ namespace engine {
         j["sampler"].get_to(entry.sampler);
     }
 
-    void Textures::load(nlohmann::json j) {
+    void Textures::Registry::load(const nlohmann::json& j) {
         std::vector<JsonTextureEntry> entries = j;
 
         names.resize(1);
         generations.resize(1);
         deleted.resize(1);
-
-        ref_counts.resize(1);
-        gpu_images.resize(1);
-        gpu_image_views.resize(1);
+        free_ids.clear();
         sampler_prototypes.resize(1);
-        samplers.resize(1);
 
-        uint32_t id_counter = 1;
         for (auto&& entry : entries) {
             auto gid = entry.gid;
-            while (gid.id() > id_counter) {
+            while (gid.id() > size()) {
+                free_ids.emplace_back(size());
                 names.emplace_back();
                 generations.emplace_back(0);
                 deleted.emplace_back(true);
-
-                ref_counts.emplace_back(0);
-                gpu_images.emplace_back();
-                gpu_image_views.emplace_back();
                 sampler_prototypes.emplace_back();
-                samplers.emplace_back();
-
-                id_counter++;
             }
 
             names.emplace_back(std::move(entry.name));
             generations.emplace_back((uint8_t)gid.gen());
             deleted.emplace_back(false);
-
-            ref_counts.emplace_back(0);
-            gpu_images.emplace_back();
-            gpu_image_views.emplace_back();
             sampler_prototypes.emplace_back(entry.sampler);
-            samplers.emplace_back();
-
-            id_counter++;
         }
     }
 
-    nlohmann::json Textures::save() const {
+    nlohmann::json Textures::Registry::save() const {
         std::vector<JsonTextureEntry> entries{};
 
-        for (uint32_t i = 1; i < names.size(); i++) {
+        for (uint32_t i = 1; i < size(); i++) {
             if (deleted[i]) continue;
 
             entries.emplace_back(JsonTextureEntry{
@@ -339,120 +413,132 @@ namespace engine {
         return entries;
     }
 
-    Textures::gid Textures::add(std::filesystem::path path, std::string name, Sampler sampler) {
-        auto vk_sampler = sampler::create(sampler);
+    Textures::gid Textures::Registry::alloc(std::string name, Sampler sampler) {
+        if (free_ids.empty()) {
+            names.emplace_back(std::move(name));
+            generations.emplace_back(0);
+            deleted.emplace_back(false);
+            sampler_prototypes.emplace_back(sampler);
 
-        gid gid;
-        if (auto gid_ = find_empty_gid(); gid_) {
-            gid = *gid_;
-            uint8_t gid_gen = gid.gen();
-            uint8_t gid_id = gid.id();
+            return {0, size() - 1};
+        }
 
-            names[gid.id()] = std::move(name);
-            generations[gid.id()]++;
-            deleted[gid.id()] = false;
+        auto id = free_ids.back();
+        free_ids.pop_back();
 
-            ref_counts[gid.id()] = 0;
-            gpu_images[gid.id()] = GPUImage{};
-            gpu_image_views[gid.id()] = nullptr;
-            sampler_prototypes[gid.id()] = sampler;
-            samplers[gid.id()] = vk_sampler;
+        names[id] = std::move(name);
+        generations[id]++;
+        deleted[id] = false;
+        sampler_prototypes[id] = sampler;
 
-            gid = {generations[gid.gen()], gid.id()};
-        } else {
-            std::lock_guard lock{impl->gid_read};
+        return {generations[id], id};
+    }
 
-            if (auto cap = texture_pool.get_capacity(); cap <= names.size()) {
-                texture_pool.destroy();
-                texture_pool = TexturePool{(uint32_t)(cap * 1.5)};
-                rebuild_pool();
-            }
+    bool Textures::Registry::free(Textures::gid gid) {
+        if (gid.id() == 0 || !is_alive(gid)) return false;
 
-            gid = {0, (uint32_t)names.size()};
+        names[gid.id()] = "";
+        generations[gid.id()]++;
+        deleted[gid.id()] = true;
+        free_ids.emplace_back(gid.id());
+        sampler_prototypes[gid.id()] = {};
 
-            names.emplace_back(std::move(name));
-            generations.emplace_back(0);
-            deleted.emplace_back(false);
+        return true;
+    }
 
-            ref_counts.emplace_back(0);
-            gpu_images.emplace_back();
-            gpu_image_views.emplace_back();
-            sampler_prototypes.emplace_back(sampler);
-            samplers.emplace_back(vk_sampler);
-        }
+    bool Textures::Registry::is_alive(Textures::gid gid) const {
+        return gid.id() < size() && generations[gid.id()] == gid.gen() && !deleted[gid.id()];
+    }
 
-        impl->initializing_textures.emplace_back(gid);
-        io_pool.enqueue({task::Add, this, gid, path});
+    void Textures::load(nlohmann::json j) {
+        registry.load(j);
 
-        return gid;
+        ref_counts.resize(1);
+        gpu_images.resize(1);
+        gpu_image_views.resize(1);
+        samplers.resize(1);
+
+        ref_counts.resize(registry.size(), 0);
+        gpu_images.resize(registry.size());
+        gpu_image_views.resize(registry.size());
+        samplers.resize(registry.size());
     }
 
-    Textures::gid Textures::add(std::span<uint8_t> image, uint32_t width, uint32_t height, VkFormat format,
-                                std::string name, Sampler sampler) {
+    nlohmann::json Textures::save() const {
+        return registry.save();
+    }
+
+    Textures::gid Textures::new_gid(std::string name, Sampler sampler) {
         auto vk_sampler = sampler::create(sampler);
 
-        gid gid;
-        if (auto gid_ = find_empty_gid(); gid_) {
-            gid = *gid_;
-            names[gid.id()] = std::move(name);
-            generations[gid.id()]++;
-            deleted[gid.id()] = false;
+        if (!registry.free_ids.empty()) {
+            auto gid = registry.alloc(std::move(name), sampler);
 
             ref_counts[gid.id()] = 0;
             gpu_images[gid.id()] = GPUImage{};
             gpu_image_views[gid.id()] = nullptr;
-            sampler_prototypes[gid.id()] = sampler;
             samplers[gid.id()] = vk_sampler;
 
-            gid = {generations[gid.id()], gid.id()};
-        } else {
-            std::lock_guard lock{impl->gid_read};
+            return gid;
+        }
 
-            if (auto cap = texture_pool.get_capacity(); cap <= names.size()) {
-                texture_pool.destroy();
-                texture_pool = TexturePool{(uint32_t)(cap * 1.5)};
-                rebuild_pool();
-            }
+        std::lock_guard lock{impl->gid_read};
 
-            gid = {0, (uint32_t)names.size()};
+        if (auto cap = texture_pool.get_capacity(); cap <= registry.size()) {
+            texture_pool.destroy();
+            texture_pool = TexturePool{(uint32_t)(cap * 1.5)};
+            rebuild_pool();
+        }
 
-            names.emplace_back(std::move(name));
-            generations.emplace_back(0);
-            deleted.emplace_back(false);
+        auto gid = registry.alloc(std::move(name), sampler);
 
-            ref_counts.emplace_back(0);
-            gpu_images.emplace_back();
-            gpu_image_views.emplace_back();
-            sampler_prototypes.emplace_back(sampler);
-            samplers.emplace_back(vk_sampler);
-        }
+        ref_counts.emplace_back(0);
+        gpu_images.emplace_back();
+        gpu_image_views.emplace_back();
+        samplers.emplace_back(vk_sampler);
+
+        return gid;
+    }
+
+    Textures::gid Textures::add(std::filesystem::path path, std::string name, Sampler sampler) {
+        auto gid = new_gid(std::move(name), sampler);
+
+        impl->initializing_textures.emplace_back(gid);
+        impl->add_jobs[gid.id()] =
+            textures::TexturesImpl::enqueue({task::Add, this, gid, path}, scheduler::Priority::Low);
 
-        auto path = texture_directory / make_texture_path(gid);
+        return gid;
+    }
+
+    Textures::gid Textures::add(std::span<uint8_t> image, uint32_t width, uint32_t height, VkFormat format,
+                                std::string name, Sampler sampler, uint32_t mip_levels) {
+        auto gid = new_gid(std::move(name), sampler);
+
+        write(texture_directory / make_texture_path(gid), image, width, height, format, mip_levels);
+
+        impl->initializing_textures.emplace_back(gid);
+        impl->initialized_queue.enqueue(gid);
+
+        return gid;
+    }
+
+    void Textures::write(const std::filesystem::path& path, std::span<const uint8_t> image, uint32_t width,
+                         uint32_t height, VkFormat format, uint32_t mip_levels) {
         Metadata metadata{
             .width = width,
             .height = height,
             .format = format,
+            .mip_levels = mip_levels,
         };
 
         std::ofstream file{path, std::ios::binary};
         file.write((const char*)&metadata, sizeof(Metadata));
         file.write((const char*)image.data(), image.size());
         file.flush();
-
-        impl->initializing_textures.emplace_back(gid);
-        impl->initialized_queue.enqueue(gid);
-
-        return gid;
     }
 
     bool Textures::remove(gid gid) {
-        if (gid == Textures::gid{0, 0}) return false;
-
-        if (generations[gid.id()] != gid.gen()) return false;
-        if (deleted[gid.id()]) return false;
-
-        deleted[gid.id()] = true;
-        generations[gid.id()]++;
+        if (!registry.free(gid)) return false;
 
         std::filesystem::remove(texture_directory / make_texture_path(gid));
 
@@ -460,10 +546,8 @@ namespace engine {
         gpu_image_view::destroy(gpu_image_views[gid.id()]);
         sampler::destroy(samplers[gid.id()]);
 
-        names[gid.id()] = "";
         gpu_images[gid.id()] = GPUImage{};
         gpu_image_views[gid.id()] = nullptr;
-        sampler_prototypes[gid.id()] = {};
         samplers[gid.id()] = nullptr;
 
         modified();
@@ -472,42 +556,42 @@ namespace engine {
     }
 
     std::expected<std::string*, textures::Err> Textures::get_name(gid gid) {
-        if (generations[gid.id()] != gid.gen()) return std::unexpected(textures::Err::BadGeneration);
+        if (registry.generations[gid.id()] != gid.gen()) return std::unexpected(textures::Err::BadGeneration);
 
-        return &names[gid.id()];
+        return &registry.names[gid.id()];
     }
 
     std::expected<VkImage, textures::Err> Textures::get_image(gid gid) {
-        if (generations[gid.id()] != gid.gen()) return std::unexpected(textures::Err::BadGeneration);
+        if (registry.generations[gid.id()] != gid.gen()) return std::unexpected(textures::Err::BadGeneration);
 
         return gpu_images[gid.id()].image;
     }
 
     std::expected<VkImageView, textures::Err> Textures::get_image_view(gid gid) {
-        if (generations[gid.id()] != gid.gen()) return std::unexpected(textures::Err::BadGeneration);
+        if (registry.generations[gid.id()] != gid.gen()) return std::unexpected(textures::Err::BadGeneration);
 
         return gpu_image_views[gid.id()];
     }
 
     std::expected<VkSampler, textures::Err> Textures::get_sampler(gid gid) {
-        if (generations[gid.id()] != gid.gen()) return std::unexpected(textures::Err::BadGeneration);
+        if (registry.generations[gid.id()] != gid.gen()) return std::unexpected(textures::Err::BadGeneration);
 
         return samplers[gid.id()];
     }
 
     std::expected<Sampler, textures::Err> Textures::get_sampler_prototype(gid gid) {
-        if (generations[gid.id()] != gid.gen()) return std::unexpected(textures::Err::BadGeneration);
+        if (registry.generations[gid.id()] != gid.gen()) return std::unexpected(textures::Err::BadGeneration);
 
-        return sampler_prototypes[gid.id()];
+        return registry.sampler_prototypes[gid.id()];
     }
 
     uint8_t Textures::get_generation(uint32_t ix) const {
-        return generations[ix];
+        return registry.generations[ix];
     }
 
     bool Textures::is_deleted(gid gid) const {
-        if (generations[gid.gen()] > gid.gen()) return true;
-        return deleted[gid.id()];
+        if (registry.generations[gid.id()] > gid.gen()) return true;
+        return registry.deleted[gid.id()];
     }
 
     void Textures::acquire(std::span<const gid> gids) {
@@ -515,14 +599,17 @@ namespace engine {
             auto gid = gids[i];
             if (gid.gen() == 0 && gid.id() == 0) continue;
             if (gid == Textures::gid{}) continue;
-            if (generations[gid.id()] != gid.gen()) continue;
+            if (registry.generations[gid.id()] != gid.gen()) continue;
             if (++ref_counts[gid.id()] != 1) continue;
 
             set_default_texture(gid);
 
             gpu_images[gid.id()] = GPUImage{};
             gpu_image_views[gid.id()] = nullptr;
-            io_pool.enqueue({task::Acquire, this, gid});
+            scheduler::job add_job{};
+            if (auto it = impl->add_jobs.find(gid.id()); it != impl->add_jobs.end()) add_job = it->second;
+
+            textures::TexturesImpl::enqueue({task::Acquire, this, gid}, scheduler::Priority::Normal, {&add_job, 1});
         }
     }
 
@@ -531,7 +618,7 @@ namespace engine {
             auto gid = gids[i];
             if (gid.gen() == 0 && gid.id() == 0) continue;
             if (gid == Textures::gid{}) continue;
-            if (generations[gid.id()] != gid.gen()) continue;
+            if (registry.generations[gid.id()] != gid.gen()) continue;
             if (ref_counts[gid.id()] == 0 || --ref_counts[gid.id()] != 0) continue;
 
             gpu_image::destroy(gpu_images[gid.id()]);
@@ -549,7 +636,7 @@ namespace engine {
     }
 
     std::span<std::string> Textures::get_names() {
-        return names;
+        return registry.names;
     }
 
     bool Textures::want_to_save() {
@@ -11,6 +11,7 @@
 #include <deque>
 #include <emmintrin.h>
 #include <mutex>
+#include <numeric>
 #include <thread>
 #include <variant>
 #include <vector>
@@ -35,42 +36,94 @@ FormatInfo get_format_info(VkFormat format) {
         case VK_FORMAT_R16G16_UNORM: return {1, 1, 4};
         case VK_FORMAT_R16G16B16_UNORM: return {1, 1, 6};
         case VK_FORMAT_R16G16B16A16_UNORM: return {1, 1, 8};
-        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: return {4, 4, 8};
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK: return {4, 4, 8};
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK: return {4, 4, 16};
         case VK_FORMAT_R32G32B32_SFLOAT:
         case VK_FORMAT_R32G32B32_UINT: return {1, 1, 12};
         default: fprintf(stderr, "invalid format: %d", format); assert(false && "Unsupported format");
     }
 }
 
+// amount of blocks needed to cover `texels`
+uint32_t block_count(uint32_t texels, uint32_t block_size) {
+    return (texels + block_size - 1) / block_size;
+}
+
 namespace engine::transport2 {
     State* state;
 
-    bool is_timeline_ready(uint64_t timeline);
+    TicketSlot& ticket_slot(uint32_t id) {
+        return state->ticket_chunks[id / State::ticket_chunk_size].load(std::memory_order_acquire)[id % State::ticket_chunk_size];
+    }
 
     void release_ticket(uint32_t id) {
-        state->ticket_timelines[id].first++;
-        state->ticket_timelines[id].second = 0;
-
-        state->free_tickets.emplace_back(state->ticket_timelines[id].first, id);
+        auto& slot = ticket_slot(id);
+        slot.generation.fetch_add(1, std::memory_order_release);
+        slot.timeline.store(0, std::memory_order_release);
+
+        uint64_t head = state->free_tickets.load(std::memory_order_relaxed);
+        uint64_t new_head;
+        do {
+            slot.next_free.store((uint32_t)head, std::memory_order_relaxed);
+            new_head = id | ((head >> 32) + 1) << 32;
+        } while (!state->free_tickets.compare_exchange_weak(head, new_head, std::memory_order_release,
+                                                            std::memory_order_relaxed));
     }
 
-    ticket get_free_ticket() {
-        std::lock_guard lock{state->ticket_mutex};
+    // advances the completion frontier with a single semaphore query and releases every ticket finished before it,
+    // skipped when another thread is already polling
+    void poll_tickets() {
+        std::unique_lock lock{state->ticket_releases_lock, std::try_to_lock};
+        if (!lock.owns_lock()) return;
+
+        uint64_t completed;
+        VK_CHECK(vkGetSemaphoreCounterValue(device(), state->timeline_semaphore, &completed));
+        state->finished_timeline.store(completed, std::memory_order_release);
 
-        for (uint32_t i = 0; i < state->ticket_timelines.size(); i++) {
-            if (state->ticket_timelines[i].second == 0 || !is_timeline_ready(state->ticket_timelines[i].second)) continue;
+        while (!state->ticket_releases.empty() && state->ticket_releases.front().first <= completed) {
+            for (auto id : state->ticket_releases.front().second) {
+                release_ticket(id);
+            }
+            state->ticket_releases.pop_front();
+        }
+    }
 
-            release_ticket(i);
+    ticket get_free_ticket() {
+        poll_tickets();
+
+        uint64_t head = state->free_tickets.load(std::memory_order_acquire);
+        while ((uint32_t)head != State::no_free_ticket) {
+            uint32_t id = (uint32_t)head;
+            uint64_t new_head = ticket_slot(id).next_free.load(std::memory_order_relaxed) | ((head >> 32) + 1) << 32;
+            if (state->free_tickets.compare_exchange_weak(head, new_head, std::memory_order_acquire,
+                                                          std::memory_order_acquire)) {
+                return ticket{ticket_slot(id).generation.load(std::memory_order_relaxed), id};
+            }
         }
 
-        if (!state->free_tickets.empty()) {
-            auto ticket = state->free_tickets.back();
-            state->free_tickets.pop_back();
-            return ticket;
+        uint32_t id = state->ticket_count.fetch_add(1, std::memory_order_relaxed);
+        uint32_t chunk = id / State::ticket_chunk_size;
+        assert(chunk < State::max_ticket_chunks && "Ran out of transport tickets");
+
+        if (state->ticket_chunks[chunk].load(std::memory_order_acquire) == nullptr) {
+            TicketSlot* expected = nullptr;
+            auto* slots = new TicketSlot[State::ticket_chunk_size]{};
+            if (!state->ticket_chunks[chunk].compare_exchange_strong(expected, slots, std::memory_order_acq_rel)) {
+                delete[] slots;
+            }
         }
 
-        state->ticket_timelines.emplace_back(0, 0);
-        return ticket{0, (uint32_t)state->ticket_timelines.size() - 1};
+        return ticket{0, id};
     }
 
     size_t task::required_size() const {
@@ -81,10 +134,22 @@ namespace engine::transport2 {
                     return dst.src_size;
                 } else {
                     auto info = get_format_info(dst.format);
-                    assert(info.blockWidth == 1 && info.blockHeight == 1 && "Compressed formats not supported right now");
+                    return block_count(dst.extent.width, info.blockWidth) *
+                           block_count(dst.extent.height, info.blockHeight) * info.bytesPerBlock;
+                }
+            },
+            dst);
+    }
 
-                    const uint32_t texel_size = info.bytesPerBlock;
-                    return dst.extent.width * dst.extent.height * texel_size;
+    uint32_t task::staging_alignment() const {
+        return std::visit(
+            [&](auto&& dst) -> uint32_t {
+                using Dst = std::decay_t<decltype(dst)>;
+                if constexpr (std::same_as<BufferDst, Dst>) {
+                    return 16;
+                } else {
+                    // bufferOffset has to be a multiple of the texel block size and of 4 on transfer queues
+                    return std::lcm(16u, get_format_info(dst.format).bytesPerBlock);
                 }
             },
             dst);
@@ -100,15 +165,13 @@ namespace engine::transport2 {
                     uint8_t* real_src = (uint8_t*)src + src_offset;
 
                     auto info = get_format_info(dst.format);
-                    assert(info.blockWidth == 1 && info.blockHeight == 1 && "Compressed formats not supported right now");
 
-                    const uint32_t texel_size = info.bytesPerBlock;
+                    // rows are rows of blocks, for uncompressed formats a block is a single texel
+                    const auto packed_row_length = block_count(dst.extent.width, info.blockWidth) * info.bytesPerBlock;
+                    const auto src_row_length = block_count(dst.src_row_length, info.blockWidth) * info.bytesPerBlock;
 
-                    const auto packed_row_length = dst.extent.width * texel_size;
-
-                    for (size_t i = 0; i < dst.extent.height; i++) {
-                        std::memcpy(out + i * packed_row_length, real_src + i * (dst.src_row_length * texel_size),
-                                    packed_row_length);
+                    for (size_t i = 0; i < block_count(dst.extent.height, info.blockHeight); i++) {
+                        std::memcpy(out + i * packed_row_length, real_src + i * src_row_length, packed_row_length);
                     }
                 }
             },
@@ -128,7 +191,8 @@ namespace engine::transport2 {
                     rest[0].ticket_id = ticket_id;
                     rest[0].owning = owning;
                     rest[0].last = last;
-                    rest[0].src_offset = budget;
+                    rest[0].finishes_ticket = finishes_ticket;
+                    rest[0].src_offset = src_offset + budget;
                     rest[0].dst_stage = dst_stage;
                     rest[0].dst_access = dst_access;
 
@@ -142,15 +206,13 @@ namespace engine::transport2 {
                     ticket_id = get_free_ticket().id();
                     owning = std::nullopt;
                     last = false;
+                    finishes_ticket = true;
                     dst.src_size = budget;
 
                     return false;
                 } else {
                     auto info = get_format_info(dst.format);
-                    assert(info.blockWidth == 1 && info.blockHeight == 1 && "Compressed formats not supported right now");
-
-                    const uint32_t texel_size = info.bytesPerBlock;
-                    if (budget < texel_size) return true;
+                    if (budget < info.bytesPerBlock) return true;
 
                     rest.emplace_back();
                     rest.emplace_back();
@@ -168,16 +230,25 @@ namespace engine::transport2 {
                     rest[1].ticket_id = ticket_id;
                     rest[1].owning = owning;
                     rest[1].last = last;
+                    rest[1].finishes_ticket = finishes_ticket;
                     rest[1].dst_stage = dst_stage;
                     rest[1].dst_access = dst_access;
 
                     ticket_id = get_free_ticket().id();
                     owning = std::nullopt;
                     last = false;
+                    finishes_ticket = true;
 
-                    uint32_t max_texels = budget / texel_size;
-                    uint32_t w = std::min<uint32_t>(dst.extent.width, std::sqrt(max_texels));
-                    uint32_t h = std::min<uint32_t>(dst.extent.height, max_texels / w);
+                    // slices are cut on block boundaries, only the ones touching the image's edge can end with a
+                    // partial block
+                    uint32_t max_blocks = budget / info.bytesPerBlock;
+                    uint32_t w_blocks =
+                        std::min<uint32_t>(block_count(dst.extent.width, info.blockWidth), std::sqrt(max_blocks));
+                    uint32_t h_blocks =
+                        std::min<uint32_t>(block_count(dst.extent.height, info.blockHeight), max_blocks / w_blocks);
+
+                    uint32_t w = std::min(dst.extent.width, w_blocks * info.blockWidth);
+                    uint32_t h = std::min(dst.extent.height, h_blocks * info.blockHeight);
 
                     uint32_t w1 = dst.extent.width - w;
                     uint32_t h1 = h;
@@ -185,7 +256,9 @@ namespace engine::transport2 {
                     uint32_t w2 = w + w1;
                     uint32_t h2 = dst.extent.height - h;
 
-                    rest[0].src_offset = (h1 * dst.extent.width + w1) * texel_size;
+                    const uint32_t src_row_size = block_count(dst.src_row_length, info.blockWidth) * info.bytesPerBlock;
+
+                    rest[0].src_offset = src_offset + w_blocks * info.bytesPerBlock;
                     std::get<ImageDst>(rest[0].dst).offset = VkOffset3D{
                         .x = dst.offset.x + (int32_t)w,
                         .y = dst.offset.y,
@@ -202,7 +275,7 @@ namespace engine::transport2 {
                         .y = dst.offset.y + (int32_t)h,
                         .z = dst.offset.z,
                     };
-                    rest[1].src_offset = (h1 * dst.extent.width + w1) * texel_size;
+                    rest[1].src_offset = src_offset + h_blocks * src_row_size;
                     std::get<ImageDst>(rest[1].dst).extent = VkExtent3D{
                         .width = w2,
                         .height = h2,
@@ -214,17 +287,14 @@ namespace engine::transport2 {
 
                     assert(!((h1 == 0 || w1 == 0) && (h2 == 0 || w2 == 0)));
                     if (h1 == 0 || w1 == 0) {
-                        std::lock_guard lock{state->ticket_mutex};
-
                         release_ticket(rest[0].ticket_id);
                         rest.erase(rest.begin());
                     } else if (h2 == 0 || w2 == 0) {
-                        std::lock_guard lock{state->ticket_mutex};
-
                         release_ticket(rest[0].ticket_id);
                         rest[0].ticket_id = rest[1].ticket_id;
                         rest[0].owning = rest[1].owning;
                         rest[0].last = rest[1].last;
+                        rest[0].finishes_ticket = rest[1].finishes_ticket;
 
                         rest.pop_back();
                     }
@@ -306,9 +376,10 @@ namespace engine::transport2 {
                             VkImageSubresourceRange{
                                 .aspectMask = dst.subresource.aspectMask,
                                 .baseMipLevel = dst.subresource.mipLevel,
-                                .levelCount = dst.subresource.baseArrayLayer - dst.initial_base_array_layer + 1,
+                                .levelCount = 1,
                                 .baseArrayLayer = dst.initial_base_array_layer,
-                                .layerCount = dst.subresource.layerCount,
+                                .layerCount = dst.subresource.baseArrayLayer + dst.subresource.layerCount -
+                                              dst.initial_base_array_layer,
                             },
                     });
 
@@ -328,9 +399,10 @@ namespace engine::transport2 {
                             VkImageSubresourceRange{
                                 .aspectMask = dst.subresource.aspectMask,
                                 .baseMipLevel = dst.subresource.mipLevel,
-                                .levelCount = dst.subresource.baseArrayLayer - dst.initial_base_array_layer + 1,
+                                .levelCount = 1,
                                 .baseArrayLayer = dst.initial_base_array_layer,
-                                .layerCount = dst.subresource.layerCount,
+                                .layerCount = dst.subresource.baseArrayLayer + dst.subresource.layerCount -
+                                              dst.initial_base_array_layer,
                             },
                     });
                 }
@@ -338,53 +410,263 @@ namespace engine::transport2 {
             dst);
     }
 
-    bool is_timeline_ready(uint64_t timeline) {
-        if (state->finished_timeline >= timeline) return true;
+    void wake_worker() {
+        state->work_epoch.fetch_add(1, std::memory_order_release);
+        state->work_epoch.notify_one();
+    }
+
+    void wait_for_work(uint32_t epoch) {
+        uint32_t spin_count = state->spin_count.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < spin_count; i++) {
+            if (state->work_epoch.load(std::memory_order_acquire) != epoch) return;
+            _mm_pause();
+        }
+
+        if (state->idle_mode.load(std::memory_order_relaxed) == IdleMode::Spin) return;
+        state->work_epoch.wait(epoch, std::memory_order_acquire);
+    }
+
+    void record_transition(task& t) {
+        if (!std::holds_alternative<task::ImageDst>(t.dst)) return;
+
+        auto& dst = std::get<task::ImageDst>(t.dst);
+        if (dst.transition_layer_count == 0) return;
+
+        state->transport_queue_image_barriers.emplace_back(VkImageMemoryBarrier2{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .pNext = nullptr,
+            .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+            .srcAccessMask = VK_ACCESS_2_NONE,
+            .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            .oldLayout = dst.transition_from,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .image = dst.image,
+            .subresourceRange =
+                VkImageSubresourceRange{
+                    .aspectMask = dst.subresource.aspectMask,
+                    .baseMipLevel = dst.subresource.mipLevel,
+                    .levelCount = 1,
+                    .baseArrayLayer = dst.initial_base_array_layer,
+                    .layerCount = dst.transition_layer_count,
+                },
+        });
+        dst.transition_layer_count = 0;
+    }
+
+    // expects `full_upload_lock` to be held, the lanes only have a single consumer
+    void drain_lanes() {
+        std::vector<task> drained{};
+        state->priority_lane.drain(drained);
+        for (auto& t : drained) {
+            record_transition(t);
+        }
+        state->pending_tasks.insert(state->pending_tasks.begin(), drained.begin(), drained.end());
+
+        drained.clear();
+        state->normal_lane.drain(drained);
+        for (auto& t : drained) {
+            record_transition(t);
+        }
+        state->pending_tasks.insert(state->pending_tasks.end(), drained.begin(), drained.end());
+    }
+
+    uint32_t align_up(uint32_t value, uint32_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
 
+    void wait_timeline(uint64_t timeline) {
         VkSemaphoreWaitInfo info{};
         info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
         info.semaphoreCount = 1;
         info.pSemaphores = &state->timeline_semaphore;
         info.pValues = &timeline;
 
-        auto res = vkWaitSemaphores(device(), &info, 0);
-        if (res == VK_SUCCESS) {
-            state->finished_timeline = std::max(timeline, state->finished_timeline);
-            return true;
-        } else {
-            return false;
+        VK_CHECK(vkWaitSemaphores(device(), &info, UINT64_MAX));
+    }
+
+    uint64_t completed_timeline() {
+        uint64_t value;
+        VK_CHECK(vkGetSemaphoreCounterValue(device(), state->timeline_semaphore, &value));
+        return value;
+    }
+
+    // all of the staging functions expect `state->staging.lock` to be held
+    void retire_staging(uint64_t completed_timeline) {
+        auto& ring = state->staging;
+        while (!ring.allocations.empty()) {
+            auto& allocation = ring.allocations.front();
+            if (!allocation.committed || allocation.timeline > completed_timeline) break;
+
+            ring.tail = allocation.end;
+            ring.allocations.pop_front();
+            ring.first_allocation++;
+        }
+    }
+
+    // the timeline the oldest allocation waits on, std::nullopt if it's a reservation that wasn't submitted yet
+    std::optional<uint64_t> oldest_staging_timeline() {
+        auto& ring = state->staging;
+        if (ring.allocations.empty() || !ring.allocations.front().committed) return std::nullopt;
+
+        return ring.allocations.front().timeline;
+    }
+
+    struct StagingPlacement {
+        uint32_t offset;
+        uint32_t padding;
+        uint32_t available;
+    };
+
+    // finds the biggest contiguous aligned range in the ring, either after the head or after wrapping to the start
+    StagingPlacement staging_placement(uint32_t alignment) {
+        auto& ring = state->staging;
+        // nothing is in flight, start over from the beginning of the arena for free
+        if (ring.head == ring.tail) ring.head = ring.tail = (ring.head + ring.size - 1) / ring.size * ring.size;
+
+        uint32_t free = ring.size - (uint32_t)(ring.head - ring.tail);
+        uint32_t pos = (uint32_t)(ring.head % ring.size);
+
+        StagingPlacement here{.offset = align_up(pos, alignment), .padding = 0, .available = 0};
+        here.padding = here.offset - pos;
+        if (here.offset < ring.size && here.padding < free) {
+            here.available = std::min(ring.size - here.offset, free - here.padding);
         }
+
+        if (pos == 0) return here;
+
+        StagingPlacement wrapped{.offset = 0, .padding = ring.size - pos, .available = 0};
+        if (wrapped.padding < free) wrapped.available = free - wrapped.padding;
+
+        return wrapped.available > here.available ? wrapped : here;
+    }
+
+    uint64_t staging_allocate(StagingPlacement placement, uint32_t size) {
+        auto& ring = state->staging;
+        assert(size <= placement.available);
+
+        ring.head += placement.padding + size;
+        ring.allocations.emplace_back(StagingAllocation{.end = ring.head});
+
+        return ring.first_allocation + ring.allocations.size() - 1;
+    }
+
+    void staging_commit(uint64_t allocation, uint64_t timeline) {
+        auto& ring = state->staging;
+        assert(allocation >= ring.first_allocation);
+
+        auto& alloc = ring.allocations[allocation - ring.first_allocation];
+        alloc.committed = true;
+        alloc.timeline = timeline;
     }
 
     void thread() {
-        while (!state->stop_worker) {
-            std::lock_guard lock{state->full_upload_lock};
+        while (!state->stop_worker.load(std::memory_order_acquire)) {
+            // the epoch has to be read before draining the lanes, otherwise a submission in between is missed
+            uint32_t epoch = state->work_epoch.load(std::memory_order_acquire);
 
-            state->task_queue_lock.lock();
-            auto& task_queue = state->task_queues[state->current_task_queue];
-            state->current_task_queue = (state->current_task_queue + 1) % state->task_queues.size();
-            state->task_queue_lock.unlock();
+            std::unique_lock lock{state->full_upload_lock};
+            drain_lanes();
 
-            if (task_queue.empty()) {
-                _mm_pause();
+            if (state->pending_tasks.empty()) {
+                lock.unlock();
+                wait_for_work(epoch);
                 continue;
             }
 
-            auto& cmd_buf = state->cmd_bufs[state->current_cmd_buf];
-            auto& cmd_buf_fence = state->cmd_buf_fences[state->current_cmd_buf];
-            auto& transport_graphics_semaphore = state->transport_graphics_semaphores[state->current_cmd_buf];
-            auto& staging_buffer = state->staging_buffers[state->current_cmd_buf];
-            auto& staging_buffer_ptr = state->staging_buffer_ptrs[state->current_cmd_buf];
-            state->current_cmd_buf = (state->current_cmd_buf + 1) % state->cmd_bufs.size();
+            auto& task_queue = state->pending_tasks;
+
+            auto& submission = state->submissions[state->current_submission];
+
+            // the slot's binary semaphore and command buffer are free once the batch that used them signaled the timeline
+            if (submission.timeline != 0) wait_timeline(submission.timeline);
+
+            {
+                std::lock_guard ring_lock{state->staging.lock};
+                retire_staging(completed_timeline());
+            }
+
+            std::vector<task> tasks;
+            std::vector<uint32_t> task_offsets;
+            std::vector<uint64_t> task_allocations;
+            uint32_t batch_size = 0;
+            while (!task_queue.empty() && batch_size < state->batch_budget) {
+                if (task_queue.front().staged) {
+                    auto& t = task_queue.front();
+                    tasks.emplace_back(t);
+                    task_offsets.emplace_back(t.staging_offset);
+                    task_allocations.emplace_back(t.staging_allocation);
+                    task_queue.pop_front();
+                    continue;
+                }
+
+                std::unique_lock ring_lock{state->staging.lock};
+                auto placement = staging_placement(task_queue.front().staging_alignment());
+                uint32_t budget = std::min(placement.available, state->batch_budget - batch_size);
+
+                if (budget < task_queue.front().required_size()) {
+                    std::vector<task> rest_tasks{};
+                    if (budget < State::min_split_size || task_queue.front().split(budget, rest_tasks)) {
+                        if (!tasks.empty()) break;
+
+                        // nothing recorded yet and the arena is full, the oldest allocation has to be freed first
+                        auto oldest = oldest_staging_timeline();
+                        ring_lock.unlock();
+                        if (!oldest) {
+                            // it's a reservation, its staged task may already be queued behind the blocked one.
+                            // staged tasks need no arena space, submitting them is what frees the oldest allocation
+                            for (auto it = task_queue.begin(); it != task_queue.end();) {
+                                if (!it->staged) {
+                                    it++;
+                                    continue;
+                                }
+
+                                tasks.emplace_back(*it);
+                                task_offsets.emplace_back(it->staging_offset);
+                                task_allocations.emplace_back(it->staging_allocation);
+                                it = task_queue.erase(it);
+                            }
+                            break;
+                        }
+
+                        wait_timeline(*oldest);
+                        ring_lock.lock();
+                        retire_staging(*oldest);
+                        continue;
+                    }
+
+                    task_queue.insert(task_queue.begin() + 1, rest_tasks.begin(), rest_tasks.end());
+                }
+
+                auto& t = task_queue.front();
+                uint32_t size = (uint32_t)t.required_size();
+                task_allocations.emplace_back(staging_allocate(placement, size));
+                ring_lock.unlock();
+
+                t.upload(state->staging.ptr + placement.offset);
+                if (state->staging.flush) state->staging.buffer.flush_mapped(placement.offset, size);
 
-            VK_CHECK(vkWaitForFences(device(), 1, &cmd_buf_fence, true, UINT64_MAX));
-            VK_CHECK(vkResetFences(device(), 1, &cmd_buf_fence));
-            VK_CHECK(vkResetCommandBuffer(cmd_buf, 0));
+                batch_size += size;
+                tasks.emplace_back(t);
+                task_offsets.emplace_back(placement.offset);
+                task_queue.pop_front();
+            }
+
+            if (tasks.empty()) {
+                // only blocked on reservations that haven't been handed to `upload` or `release` yet, both of them
+                // bump the epoch
+                lock.unlock();
+                wait_for_work(epoch);
+                continue;
+            }
+
+            state->current_submission = (state->current_submission + 1) % state->submissions.size();
+            VK_CHECK(vkResetCommandBuffer(submission.cmd_buf, 0));
 
             VkCommandBufferBeginInfo begin_info{};
             begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
             begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-            VK_CHECK(vkBeginCommandBuffer(cmd_buf, &begin_info));
+            VK_CHECK(vkBeginCommandBuffer(submission.cmd_buf, &begin_info));
 
             if (!state->transport_queue_buffer_barriers.empty() || !state->transport_queue_image_barriers.empty()) {
                 VkDependencyInfo dep_info{};
@@ -394,44 +676,14 @@ namespace engine::transport2 {
                 dep_info.pBufferMemoryBarriers = state->transport_queue_buffer_barriers.data();
                 dep_info.imageMemoryBarrierCount = state->transport_queue_image_barriers.size();
                 dep_info.pImageMemoryBarriers = state->transport_queue_image_barriers.data();
-                vkCmdPipelineBarrier2(cmd_buf, &dep_info);
+                vkCmdPipelineBarrier2(submission.cmd_buf, &dep_info);
 
                 state->transport_queue_buffer_barriers.clear();
                 state->transport_queue_image_barriers.clear();
             }
 
-            std::vector<task> tasks;
-            uint32_t size = 0;
-            while (!task_queue.empty()) {
-                auto& t = task_queue.front();
-
-                auto budget = state->staging_buffer_size - size;
-                if (budget == 0) break;
-                if (budget < t.required_size()) {
-                    std::vector<task> rest_tasks{};
-                    if (task_queue[0].split(budget, rest_tasks)) continue;
-
-                    task_queue.insert(task_queue.begin() + 1, rest_tasks.begin(), rest_tasks.end());
-                    t = task_queue[0];
-                }
-
-                t.upload((uint8_t*)staging_buffer_ptr + size);
-
-                size += t.required_size();
-                if (std::holds_alternative<task::BufferDst>(t.dst)) {
-                    auto dst = std::get<task::BufferDst>(t.dst);
-                }
-                tasks.emplace_back(t);
-                task_queue.pop_front();
-            }
-
-            if (state->flush_staging_buffer) staging_buffer.flush_mapped(0, state->staging_buffer_size);
-
-            std::vector<std::variant<VkBufferMemoryBarrier2, VkImageMemoryBarrier2>> graphics_barriers;
-            uint32_t upload_offset = 0;
-            for (auto& task : tasks) {
-                task.upload(cmd_buf, staging_buffer, upload_offset);
-                upload_offset += task.required_size();
+            for (size_t i = 0; i < tasks.size(); i++) {
+                tasks[i].upload(submission.cmd_buf, state->staging.buffer, task_offsets[i]);
             }
 
             if (!state->transport_queue_buffer_barriers.empty() || !state->transport_queue_image_barriers.empty()) {
@@ -441,26 +693,21 @@ namespace engine::transport2 {
                 dep_info.pBufferMemoryBarriers = state->transport_queue_buffer_barriers.data();
                 dep_info.imageMemoryBarrierCount = state->transport_queue_image_barriers.size();
                 dep_info.pImageMemoryBarriers = state->transport_queue_image_barriers.data();
-                vkCmdPipelineBarrier2(cmd_buf, &dep_info);
+                vkCmdPipelineBarrier2(submission.cmd_buf, &dep_info);
 
                 state->transport_queue_buffer_barriers.clear();
                 state->transport_queue_image_barriers.clear();
             }
 
-            VK_CHECK(vkEndCommandBuffer(cmd_buf));
+            VK_CHECK(vkEndCommandBuffer(submission.cmd_buf));
 
             VkCommandBufferSubmitInfo cmd_info{};
             cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
-            cmd_info.commandBuffer = cmd_buf;
+            cmd_info.commandBuffer = submission.cmd_buf;
 
-            // VkSemaphoreSubmitInfo signal_info{};
-            // signal_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-            // signal_info.semaphore = timeline_semaphore;
-            // signal_info.stageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
-            // signal_info.value = ++timeline_counter;
             VkSemaphoreSubmitInfo signal_info{};
             signal_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
-            signal_info.semaphore = transport_graphics_semaphore;
+            signal_info.semaphore = submission.transport_graphics_semaphore;
             signal_info.stageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
 
             VkSubmitInfo2 submit_info{};
@@ -471,13 +718,13 @@ namespace engine::transport2 {
             submit_info.signalSemaphoreInfoCount = 1;
             submit_info.pSignalSemaphoreInfos = &signal_info;
 
-            VK_CHECK(vkQueueSubmit2(engine::state->transport_queue, 1, &submit_info, cmd_buf_fence));
+            VK_CHECK(vkQueueSubmit2(engine::state->transport_queue, 1, &submit_info, nullptr));
 
             synchronization::submit_from_another_thread(state->graphics_queue_buffer_barriers, state->graphics_queue_image_barriers,
                                                         {},
                                                         VkSemaphoreSubmitInfo{
                                                             .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-                                                            .semaphore = transport_graphics_semaphore,
+                                                            .semaphore = submission.transport_graphics_semaphore,
                                                             .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
                                                         },
                                                         VkSemaphoreSubmitInfo{
@@ -490,23 +737,44 @@ namespace engine::transport2 {
             state->graphics_queue_buffer_barriers.clear();
             state->graphics_queue_image_barriers.clear();
 
+            submission.timeline = state->timeline_counter;
             {
-                std::lock_guard lock{state->ticket_mutex};
-                for (auto& task : tasks) {
-                    state->ticket_timelines[task.ticket_id].second = state->timeline_counter;
+                std::lock_guard ring_lock{state->staging.lock};
+                for (auto allocation : task_allocations) {
+                    staging_commit(allocation, state->timeline_counter);
                 }
             }
+
+            std::vector<uint32_t> finished_tickets{};
+            for (auto& task : tasks) {
+                auto& slot = ticket_slot(task.ticket_id);
+                slot.timeline.store(state->timeline_counter, std::memory_order_release);
+                slot.timeline.notify_all();
+
+                if (task.finishes_ticket) finished_tickets.emplace_back(task.ticket_id);
+            }
+
+            {
+                std::lock_guard lock{state->ticket_releases_lock};
+                state->ticket_releases.emplace_back(state->timeline_counter, std::move(finished_tickets));
+            }
         }
     }
 
-    void init() {
+    void init(Config config) {
+        assert(config.max_in_flight > 0 && "transport2 needs at least one batch in flight");
+        assert(config.staging_arena_size / config.max_in_flight >= State::min_split_size &&
+               "staging arena too small for the requested amount of in-flight batches");
+
         state = new State{};
+        state->idle_mode = config.idle_mode;
+        state->spin_count = config.spin_count;
+        state->batch_budget = config.staging_arena_size / config.max_in_flight;
 
-        for (size_t i = 0; i < state->staging_buffers.size(); i++) {
-            state->staging_buffers[i] =
-                Buffer::create(std::format("Transport buffer #{}", i).c_str(), state->staging_buffer_size,
-                               VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT, {{&state->staging_buffer_ptrs[i], &state->flush_staging_buffer}});
-        }
+        state->staging.size = config.staging_arena_size;
+        state->staging.buffer =
+            Buffer::create("Transport staging arena", state->staging.size, VK_BUFFER_USAGE_2_TRANSFER_SRC_BIT,
+                           {{(void**)&state->staging.ptr, &state->staging.flush}});
 
         VkCommandPoolCreateInfo pool_info{};
         pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
@@ -519,18 +787,6 @@ namespace engine::transport2 {
         cmd_buf_alloc_info.commandBufferCount = 1;
         cmd_buf_alloc_info.commandPool = state->cmd_pool;
         cmd_buf_alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        for (auto& cmd_buf : state->cmd_bufs) {
-            VK_CHECK(vkAllocateCommandBuffers(device(), &cmd_buf_alloc_info, &cmd_buf));
-        }
-
-        VkFenceCreateInfo fence_info{};
-        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fence_info.pNext = nullptr;
-        fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        for (auto& fence : state->cmd_buf_fences) {
-            VK_CHECK(vkCreateFence(device(), &fence_info, nullptr, &fence));
-        }
 
         VkSemaphoreTypeCreateInfo semaphore_type{};
         semaphore_type.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
@@ -544,66 +800,73 @@ namespace engine::transport2 {
         vkCreateSemaphore(device(), &semaphore_info, nullptr, &state->timeline_semaphore);
 
         semaphore_info.pNext = nullptr;
-        for (auto& semaphore : state->transport_graphics_semaphores) {
-            vkCreateSemaphore(device(), &semaphore_info, nullptr, &semaphore);
+        state->submissions.resize(config.max_in_flight);
+        for (auto& submission : state->submissions) {
+            VK_CHECK(vkAllocateCommandBuffers(device(), &cmd_buf_alloc_info, &submission.cmd_buf));
+            vkCreateSemaphore(device(), &semaphore_info, nullptr, &submission.transport_graphics_semaphore);
         }
 
         state->worker = std::thread{thread};
     }
 
     void destroy() {
-        state->stop_worker = true;
+        state->stop_worker.store(true, std::memory_order_release);
+        wake_worker();
         state->worker.join();
 
-        for (auto buf : state->staging_buffers) {
-            buf.destroy();
+        for (auto& chunk : state->ticket_chunks) {
+            delete[] chunk.load(std::memory_order_relaxed);
         }
-        vkDestroyCommandPool(device(), state->cmd_pool, nullptr);
 
-        for (auto& fence : state->cmd_buf_fences) {
-            vkDestroyFence(device(), fence, nullptr);
-        }
+        state->staging.buffer.destroy();
+        vkDestroyCommandPool(device(), state->cmd_pool, nullptr);
 
         vkDestroySemaphore(device(), state->timeline_semaphore, nullptr);
-        for (auto semaphore : state->transport_graphics_semaphores) {
-            vkDestroySemaphore(device(), semaphore, nullptr);
+        for (auto& submission : state->submissions) {
+            vkDestroySemaphore(device(), submission.transport_graphics_semaphore, nullptr);
         }
 
         delete state;
     }
 
+    void set_idle_mode(IdleMode mode, uint32_t spin_count) {
+        state->idle_mode.store(mode, std::memory_order_relaxed);
+        state->spin_count.store(spin_count, std::memory_order_relaxed);
+        wake_worker();
+    }
+
     bool is_ready(ticket t) {
         if (t == ticket{}) return false;
-        std::lock_guard lock{state->ticket_mutex};
-        auto [gen, timeline] = state->ticket_timelines[t.id()];
+        auto& slot = ticket_slot(t.id());
 
-        if (t.gen() < gen) return true;
+        if (t.gen() < slot.generation.load(std::memory_order_acquire)) return true;
+        uint64_t timeline = slot.timeline.load(std::memory_order_acquire);
         if (timeline == 0) return false;
+        if (timeline <= state->finished_timeline.load(std::memory_order_acquire)) return true;
 
-        return is_timeline_ready(timeline);
+        poll_tickets();
+        return t.gen() < slot.generation.load(std::memory_order_acquire) ||
+               timeline <= state->finished_timeline.load(std::memory_order_acquire);
     }
 
     VkSemaphoreSubmitInfo wait_on(std::span<ticket> tickets) {
         uint64_t largest_timeline_value = 0;
         for (auto t : tickets) {
             if (t == ticket{}) continue;
+            auto& slot = ticket_slot(t.id());
 
-            {
-                std::lock_guard lock{state->ticket_mutex};
-                if (state->ticket_timelines[t.id()].first > t.gen()) continue;
-            }
-
-            bool spin = false;
-            do {
-                std::lock_guard lock{state->ticket_mutex};
-                spin = state->ticket_timelines[t.id()].second == 0;
-            } while (spin);
+            uint64_t timeline;
+            while (true) {
+                if (slot.generation.load(std::memory_order_acquire) > t.gen()) break;
 
-            {
-                std::lock_guard lock{state->ticket_mutex};
-                if (state->ticket_timelines[t.id()].first > t.gen()) continue;
+                timeline = slot.timeline.load(std::memory_order_acquire);
+                if (timeline != 0) {
+                    largest_timeline_value = std::max(largest_timeline_value, timeline);
+                    break;
+                }
 
-                largest_timeline_value = std::max(largest_timeline_value, state->ticket_timelines[t.id()].second);
+                // woken up by the worker submitting the ticket or by it being released
+                slot.timeline.wait(0, std::memory_order_acquire);
             }
         }
 
@@ -614,6 +877,73 @@ namespace engine::transport2 {
                                      .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT};
     }
 
+    MSPCQueue<task, State::lane_size>& lane(bool priority) {
+        return priority ? state->priority_lane : state->normal_lane;
+    }
+
+    void enqueue(bool priority, const task& task) {
+        lane(priority).enqueue(task);
+        wake_worker();
+    }
+
+    void enqueue(bool priority, std::span<const task> tasks) {
+        lane(priority).enqueue(tasks);
+        wake_worker();
+    }
+
+    std::optional<Reservation> reserve(uint32_t size, uint32_t alignment, bool wait) {
+        auto& ring = state->staging;
+        if (size > ring.size) return std::nullopt;
+
+        while (true) {
+            std::optional<uint64_t> oldest;
+            {
+                std::lock_guard lock{ring.lock};
+                retire_staging(completed_timeline());
+
+                auto placement = staging_placement(alignment);
+                if (placement.available >= size) {
+                    auto allocation = staging_allocate(placement, size);
+                    return Reservation{
+                        .data = ring.ptr + placement.offset,
+                        .offset = placement.offset,
+                        .size = size,
+                        .allocation = allocation,
+                    };
+                }
+
+                if (!wait) return std::nullopt;
+                oldest = oldest_staging_timeline();
+            }
+
+            if (oldest) wait_timeline(*oldest);
+            else std::this_thread::yield();
+        }
+    }
+
+    void release(Reservation reservation) {
+        {
+            std::lock_guard lock{state->staging.lock};
+            staging_commit(reservation.allocation, 0);
+        }
+
+        // the worker might be parked on this reservation
+        wake_worker();
+    }
+
+    uint32_t image_alignment(VkFormat format) {
+        return std::lcm(16u, get_format_info(format).bytesPerBlock);
+    }
+
+    uint32_t image_size(VkFormat format, uint32_t width, uint32_t height) {
+        auto info = get_format_info(format);
+        return block_count(width, info.blockWidth) * block_count(height, info.blockHeight) * info.bytesPerBlock;
+    }
+
+    void flush_reservation(const Reservation& reservation) {
+        if (state->staging.flush) state->staging.buffer.flush_mapped(reservation.offset, reservation.size);
+    }
+
     ticket upload(bool priority, void* src, std::optional<FreeFn*> own, uint32_t size, VkBuffer dst,
                   uint32_t dst_offset, VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access) {
         auto ticket = get_free_ticket();
@@ -634,15 +964,67 @@ namespace engine::transport2 {
             .dst_stage = dst_stage,
             .dst_access = dst_access,
         };
+        enqueue(priority, task);
 
-        {
-            std::lock_guard lock{state->task_queue_lock};
-            auto& task_queue = state->task_queues[state->current_task_queue];
+        return ticket;
+    }
+
+    void upload(bool priority, std::span<const BufferUpload> uploads, std::span<ticket> tickets) {
+        assert(tickets.size() >= uploads.size());
+
+        std::vector<task> tasks{};
+        tasks.reserve(uploads.size());
+        for (size_t i = 0; i < uploads.size(); i++) {
+            const auto& up = uploads[i];
+            tickets[i] = get_free_ticket();
 
-            if (priority) task_queue.emplace_front(task);
-            else task_queue.emplace_back(task);
+            tasks.emplace_back(task{
+                .dst =
+                    task::BufferDst{
+                        .src_size = up.size,
+                        .buffer = up.dst,
+                        .offset = up.dst_offset,
+                        .initial_offset = up.dst_offset,
+                    },
+                .src = up.src,
+                .src_offset = 0,
+                .ticket_id = tickets[i].id(),
+                .owning = up.own,
+                .last = true,
+                .dst_stage = up.dst_stage,
+                .dst_access = up.dst_access,
+            });
         }
 
+        enqueue(priority, tasks);
+    }
+
+    ticket upload(bool priority, Reservation src, VkBuffer dst, uint32_t dst_offset, VkPipelineStageFlags2 dst_stage,
+                  VkAccessFlags2 dst_access) {
+        auto ticket = get_free_ticket();
+        flush_reservation(src);
+
+        task task = {
+            .dst =
+                task::BufferDst{
+                    .src_size = src.size,
+                    .buffer = dst,
+                    .offset = dst_offset,
+                    .initial_offset = dst_offset,
+                },
+            .src = nullptr,
+            .src_offset = 0,
+            .ticket_id = ticket.id(),
+            .owning = std::nullopt,
+            .last = true,
+            .dst_stage = dst_stage,
+            .dst_access = dst_access,
+            .staged = true,
+            .staging_offset = src.offset,
+            .staging_allocation = src.allocation,
+        };
+        enqueue(priority, task);
+
         return ticket;
     }
 
@@ -651,29 +1033,6 @@ namespace engine::transport2 {
                   VkImageLayout dst_layout, VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access) {
         auto ticket = get_free_ticket();
 
-        {
-            std::lock_guard lock{state->full_upload_lock};
-            state->transport_queue_image_barriers.emplace_back(VkImageMemoryBarrier2{
-                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-                .pNext = nullptr,
-                .srcStageMask = VK_PIPELINE_STAGE_2_NONE,
-                .srcAccessMask = VK_ACCESS_2_NONE,
-                .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
-                .oldLayout = current_layout,
-                .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                .image = dst,
-                .subresourceRange =
-                    VkImageSubresourceRange{
-                        .aspectMask = dst_layers.aspectMask,
-                        .baseMipLevel = dst_layers.mipLevel,
-                        .levelCount = 1,
-                        .baseArrayLayer = dst_layers.baseArrayLayer,
-                        .layerCount = dst_layers.layerCount,
-                    },
-            });
-        }
-
         std::vector<task> tasks{};
         tasks.reserve(dst_layers.layerCount);
 
@@ -698,68 +1057,93 @@ namespace engine::transport2 {
 
                         .format = format,
                         .new_layout = dst_layout,
+
+                        .transition_layer_count = i == 0 ? dst_layers.layerCount : 0,
+                        .transition_from = current_layout,
                     },
                 .src = src,
                 .src_offset = 0,
                 .ticket_id = ticket.id(),
                 .owning = own,
                 .last = i == (dst_layers.layerCount - 1),
+                .finishes_ticket = i == (dst_layers.layerCount - 1),
                 .dst_stage = dst_stage,
                 .dst_access = dst_access,
             });
         }
 
-        {
-            std::lock_guard lock{state->task_queue_lock};
-            auto& task_queue = state->task_queues[state->current_task_queue];
-
-            if (priority) {
-                task_queue.insert(task_queue.begin(), tasks.rbegin(), tasks.rend());
-            } else {
-                task_queue.insert(task_queue.end(), tasks.begin(), tasks.end());
-            }
-        }
+        enqueue(priority, tasks);
 
         return ticket;
     }
 
-    void unqueue(ticket t, bool free) {
-        {
-            std::lock_guard lock{state->task_queue_lock};
-            auto& task_queue = state->task_queues[state->current_task_queue];
+    ticket upload(bool priority, VkFormat format, VkExtent3D dimension, Reservation src, VkImage dst,
+                  VkImageSubresourceLayers dst_layers, VkOffset3D dst_offset, VkImageLayout current_layout,
+                  VkImageLayout dst_layout, VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access) {
+        auto ticket = get_free_ticket();
+        flush_reservation(src);
 
-            for (size_t i = 0; i < task_queue.size(); i++) {
-                if (task_queue[i].ticket_id != t.id()) continue;
-                if (state->ticket_timelines[t.id()].first != t.gen()) return;
+        // the layers are already packed in the arena, so a single copy covers all of them
+        task task = {
+            .dst =
+                task::ImageDst{
+                    .image = dst,
+                    .subresource = dst_layers,
+                    .initial_base_array_layer = dst_layers.baseArrayLayer,
 
-                auto task = task_queue[i];
-                task_queue.erase(task_queue.begin() + i);
+                    .offset = dst_offset,
+                    .extent = dimension,
 
-                if (free && task.owning) {
-                    (*task.owning)(task.src);
-                }
-                return;
+                    .src_row_length = dimension.width,
+
+                    .format = format,
+                    .new_layout = dst_layout,
+
+                    .transition_layer_count = dst_layers.layerCount,
+                    .transition_from = current_layout,
+                },
+            .src = nullptr,
+            .src_offset = 0,
+            .ticket_id = ticket.id(),
+            .owning = std::nullopt,
+            .last = true,
+            .dst_stage = dst_stage,
+            .dst_access = dst_access,
+            .staged = true,
+            .staging_offset = src.offset,
+            .staging_allocation = src.allocation,
+        };
+        enqueue(priority, task);
+
+        return ticket;
+    }
+
+    void drop_task(const task& task, bool free) {
+        if (task.staged) {
+            {
+                std::lock_guard lock{state->staging.lock};
+                staging_commit(task.staging_allocation, 0);
             }
+            wake_worker();
+        } else if (free && task.owning) {
+            (*task.owning)(task.src);
         }
+    }
 
-        {
-            std::lock_guard lock1{state->full_upload_lock};
-            std::lock_guard lock2{state->task_queue_lock};
-
-            auto& task_queue = state->task_queues[(state->current_task_queue + 1) % state->task_queues.size()];
+    void unqueue(ticket t, bool free) {
+        std::lock_guard lock{state->full_upload_lock};
+        drain_lanes();
 
-            for (size_t i = 0; i < task_queue.size(); i++) {
-                if (task_queue[i].ticket_id != t.id()) continue;
-                if (state->ticket_timelines[t.id()].first != t.gen()) return;
+        auto& task_queue = state->pending_tasks;
+        for (size_t i = 0; i < task_queue.size(); i++) {
+            if (task_queue[i].ticket_id != t.id()) continue;
+            if (ticket_slot(t.id()).generation.load(std::memory_order_acquire) != t.gen()) return;
 
-                auto task = task_queue[i];
-                task_queue.erase(task_queue.begin() + i);
+            auto task = task_queue[i];
+            task_queue.erase(task_queue.begin() + i);
 
-                if (free && task.owning) {
-                    (*task.owning)(task.src);
-                }
-                return;
-            }
+            drop_task(task, free);
+            return;
         }
     }
 
@@ -770,7 +1154,7 @@ namespace engine::transport2 {
     }
 
     uint64_t get_timeline(ticket t) {
-        return state->ticket_timelines[t.id()].second;
+        return ticket_slot(t.id()).timeline.load(std::memory_order_acquire);
     }
 
     void* get_internal_state() {
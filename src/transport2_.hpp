@@ -1,7 +1,10 @@
 #pragma once
 
 #include "goliath/buffer.hpp"
+#include "goliath/mspc_queue.hpp"
 #include "goliath/transport2.hpp"
+#include <array>
+#include <atomic>
 #include <deque>
 #include <mutex>
 #include <thread>
@@ -30,6 +33,11 @@ namespace engine::transport2 {
 
             VkFormat format;
             VkImageLayout new_layout;
+
+            // when non-zero, the worker transitions this many layers from `transition_from` to TRANSFER_DST_OPTIMAL
+            // as soon as it picks the task up
+            uint32_t transition_layer_count = 0;
+            VkImageLayout transition_from = VK_IMAGE_LAYOUT_UNDEFINED;
         };
 
         std::variant<BufferDst, ImageDst> dst;
@@ -38,16 +46,61 @@ namespace engine::transport2 {
         uint32_t ticket_id;
         std::optional<FreeFn*> owning;
         bool last;
+        // unset for every layer but the last one of an image upload, they share the ticket with it
+        bool finishes_ticket = true;
 
         VkPipelineStageFlagBits2 dst_stage;
         VkAccessFlagBits2 dst_access;
 
+        // staged tasks already live in the staging arena at `staging_offset`, they are never copied or split
+        bool staged = false;
+        uint32_t staging_offset = 0;
+        uint64_t staging_allocation = 0;
+
         size_t required_size() const;
+        uint32_t staging_alignment() const;
         void upload(uint8_t* out);
         bool split(uint32_t budget, std::vector<task>& rest);
         void upload(VkCommandBuffer cmd_buf, VkBuffer src_buf, uint32_t src_buf_offset);
     };
 
+    struct TicketSlot {
+        std::atomic<uint32_t> generation = 0;
+        // 0 until the ticket's last task was submitted
+        std::atomic<uint64_t> timeline = 0;
+        std::atomic<uint32_t> next_free = 0;
+    };
+
+    struct StagingAllocation {
+        uint64_t end;
+        // reservations stay uncommitted until the worker submits them, a committed allocation with a 0 timeline
+        // was released without being uploaded
+        bool committed = false;
+        uint64_t timeline = 0;
+    };
+
+    struct StagingRing {
+        std::mutex lock{};
+
+        Buffer buffer{};
+        uint8_t* ptr = nullptr;
+        bool flush = false;
+        uint32_t size = 0;
+
+        // both are monotonic byte counters, `head - tail` is the amount of bytes still in flight
+        uint64_t head = 0;
+        uint64_t tail = 0;
+        // every allocation in arena order, space is only reclaimed up to the oldest allocation still in use
+        uint64_t first_allocation = 0;
+        std::deque<StagingAllocation> allocations{};
+    };
+
+    struct Submission {
+        VkCommandBuffer cmd_buf;
+        VkSemaphore transport_graphics_semaphore;
+        uint64_t timeline = 0;
+    };
+
     struct State {
         std::mutex full_upload_lock{};
 
@@ -57,35 +110,51 @@ namespace engine::transport2 {
         std::vector<VkBufferMemoryBarrier2> graphics_queue_buffer_barriers{};
         std::vector<VkImageMemoryBarrier2> graphics_queue_image_barriers{};
 
-        bool stop_worker = false;
+        std::atomic<bool> stop_worker = false;
         std::thread worker;
 
-        std::mutex ticket_mutex{};
-        std::vector<std::pair<uint64_t, uint64_t>> ticket_timelines{};
-        std::vector<ticket> free_tickets{};
+        // bumped on every submission and dropped reservation, the worker parks on it when there is nothing it can
+        // upload
+        std::atomic<uint32_t> work_epoch = 0;
+        std::atomic<IdleMode> idle_mode = IdleMode::Park;
+        std::atomic<uint32_t> spin_count = 4096;
+
+        static constexpr uint32_t ticket_chunk_size = 4096;
+        static constexpr uint32_t max_ticket_chunks = 1024;
+        static constexpr uint32_t no_free_ticket = 0xFFFFFFFFu;
+        // chunks are never moved or freed before `destroy`, so slots can be accessed without a lock
+        std::array<std::atomic<TicketSlot*>, max_ticket_chunks> ticket_chunks{};
+        std::atomic<uint32_t> ticket_count = 0;
+        // index of the first free slot in the low 32 bits, an ABA tag in the high 32 bits
+        std::atomic<uint64_t> free_tickets = no_free_ticket;
+
+        std::mutex ticket_releases_lock{};
+        // (timeline, tickets that are finished once it's reached), ordered by timeline
+        std::deque<std::pair<uint64_t, std::vector<uint32_t>>> ticket_releases{};
+        std::atomic<uint64_t> finished_timeline = 0;
 
         uint64_t timeline_counter = 0;
-        uint64_t finished_timeline = 0;
         VkSemaphore timeline_semaphore;
 
         VkCommandPool cmd_pool;
-        uint32_t current_cmd_buf = 0;
-        std::array<VkCommandBuffer, 2> cmd_bufs;
-        std::array<VkFence, 2> cmd_buf_fences;
-        std::array<VkSemaphore, 2> transport_graphics_semaphores;
+        uint32_t current_submission = 0;
+        std::vector<Submission> submissions{};
 
-        static constexpr uint32_t staging_buffer_size = 8000000;
-        std::array<Buffer, 2> staging_buffers{};
-        std::array<void*, 2> staging_buffer_ptrs{};
-        bool flush_staging_buffer = false;
+        // splitting a task into slices smaller than this isn't worth it, the worker waits for the ring instead
+        static constexpr uint32_t min_split_size = 64 * 1024;
+        uint32_t batch_budget = 0;
+        StagingRing staging{};
 
-        uint32_t current_task_queue = 0;
-        std::array<std::deque<task>, 2> task_queues{};
-        std::mutex task_queue_lock{};
+        // producers only ever touch the lanes, the worker drains them into `pending_tasks` with `full_upload_lock`
+        // held, priority tasks in front of everything else
+        static constexpr std::size_t lane_size = 1024;
+        MSPCQueue<task, lane_size> priority_lane{};
+        MSPCQueue<task, lane_size> normal_lane{};
+        std::deque<task> pending_tasks{};
 
         std::mutex graphics_barriers_lock{};
     };
 
-    void init();
+    void init(Config config);
     void destroy();
 }
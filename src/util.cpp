@@ -4,6 +4,16 @@
 #include <expected>
 #include <fstream>
 
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace engine::rendering {
     bool in_block = false;
     bool close = false;
@@ -63,8 +73,81 @@ uint8_t* engine::util::read_file(const std::filesystem::path& path, uint32_t* si
 }
 
 void engine::util::save_file(const std::filesystem::path& path, uint8_t* data, uint32_t size) {
-    std::ofstream file{path, std::ios::binary};
-    file.write((const char*)data, size);
+    // written next to `path` and renamed over it, so mappings of the old file stay valid
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream file{tmp_path, std::ios::binary};
+        file.write((const char*)data, size);
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp_path, ec);
+        std::ofstream file{path, std::ios::binary};
+        file.write((const char*)data, size);
+    }
+}
+
+std::optional<engine::util::MappedFile> engine::util::map_file(const std::filesystem::path& path) {
+    MappedFile file{};
+#ifdef _WIN32
+    HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return std::nullopt;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+        CloseHandle(handle);
+        return std::nullopt;
+    }
+
+    HANDLE mapping = CreateFileMappingW(handle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    CloseHandle(handle);
+    if (mapping == nullptr) return std::nullopt;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (data == nullptr) {
+        CloseHandle(mapping);
+        return std::nullopt;
+    }
+
+    file.data = (uint8_t*)data;
+    file.size = (uint64_t)size.QuadPart;
+    file._handle = mapping;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return std::nullopt;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return std::nullopt;
+    }
+
+    void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return std::nullopt;
+
+    file.data = (uint8_t*)data;
+    file.size = (uint64_t)st.st_size;
+#endif
+
+    return file;
+}
+
+void engine::util::unmap_file(MappedFile& file) {
+    if (file.data == nullptr) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(file.data);
+    CloseHandle((HANDLE)file._handle);
+#else
+    munmap(file.data, (size_t)file.size);
+#endif
+
+    file = MappedFile{};
 }
 
 std::expected<nlohmann::json, engine::util::ReadJsonErr> engine::util::read_json(const std::filesystem::path& path) {
@@ -9,6 +9,7 @@ namespace engine::vma_ptrs {
         decltype(vmaDestroyBuffer)* destroy_buffer;
         decltype(vmaDestroyImage)* destroy_image;
         decltype(vmaFlushAllocation)* flush_alloc;
+        decltype(vmaInvalidateAllocation)* invalidate_alloc;
         decltype(vmaSetAllocationName)* set_name;
         decltype(vmaGetMemoryTypeProperties)* get_memory_type_properties;
     };
@@ -22,6 +23,7 @@ namespace engine::vma_ptrs {
         state->destroy_buffer = vmaDestroyBuffer;
         state->destroy_image = vmaDestroyImage;
         state->flush_alloc = vmaFlushAllocation;
+        state->invalidate_alloc = vmaInvalidateAllocation;
         state->set_name = vmaSetAllocationName;
         state->get_memory_type_properties = vmaGetMemoryTypeProperties;
     }
@@ -52,6 +54,10 @@ namespace engine::vma_ptrs {
         VK_CHECK(state->flush_alloc(allocator(), alloc, offset, size));
     }
 
+    void invalidate_alloc(VmaAllocation alloc, VkDeviceSize offset, VkDeviceSize size) {
+        VK_CHECK(state->invalidate_alloc(allocator(), alloc, offset, size));
+    }
+
     void set_name(VmaAllocation alloc, const char* name) {
         state->set_name(allocator(), alloc, name);
     }